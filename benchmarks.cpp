@@ -0,0 +1,808 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+#include <benchmark/benchmark.h>
+
+#include "set.h"
+#include "pool_allocator.h"
+#include "btree_set.h"
+#include "flat_set.h"
+#include "concurrent_set.h"
+#include "persistent_set.h"
+#include "serialization.h"
+#include "mapped_set.h"
+#include "index_set.h"
+#include "lean_set.h"
+
+using default_set = set<int>;
+using pooled_set = set<int, std::less<int>, pool_allocator<int>>;
+
+/*
+* Counts the bytes the container holds, so bytes per element can be reported.
+*/
+template <typename T>
+struct byte_counting_allocator {
+	using value_type = T;
+
+	static inline std::size_t bytes = 0;
+
+	byte_counting_allocator() = default;
+
+	template <typename U>
+	byte_counting_allocator(byte_counting_allocator<U> const&) noexcept
+	{}
+
+	T * allocate(std::size_t n) {
+		byte_counting_allocator<char>::bytes += n * sizeof(T);
+		return std::allocator<T>().allocate(n);
+	}
+
+	void deallocate(T * p, std::size_t n) noexcept {
+		byte_counting_allocator<char>::bytes -= n * sizeof(T);
+		std::allocator<T>().deallocate(p, n);
+	}
+
+	template <typename U>
+	friend bool operator==(byte_counting_allocator const&, byte_counting_allocator<U> const&) noexcept {
+		return true;
+	}
+
+	template <typename U>
+	friend bool operator!=(byte_counting_allocator const&, byte_counting_allocator<U> const&) noexcept {
+		return false;
+	}
+};
+
+using counted_set = set<int, std::less<int>, byte_counting_allocator<int>>;
+using counted_btree_set = btree_set<int, std::less<int>, byte_counting_allocator<int>>;
+using counted_flat_set = flat_set<int, std::less<int>, byte_counting_allocator<int>>;
+using counted_index_set = index_set<int, std::less<int>, byte_counting_allocator<int>>;
+using counted_lean_set = lean_set<int, std::less<int>, byte_counting_allocator<int>>;
+using instrumented_set = set<int, std::less<int>, byte_counting_allocator<int>, counting_stats>;
+
+std::vector<int> shuffled_keys(std::size_t n, unsigned seed = 1) {
+	std::vector<int> keys(n);
+	for (std::size_t i = 0; i < n; i++)
+		keys[i] = static_cast<int>(i);
+	std::shuffle(keys.begin(), keys.end(), std::mt19937(seed));
+	return keys;
+}
+
+/*
+* Fill the set, then repeatedly erase a random present key and insert a fresh one.
+*/
+template <typename Set>
+void BM_insert_erase_churn(benchmark::State &state) {
+	std::size_t n = static_cast<std::size_t>(state.range(0));
+	std::vector<int> keys = shuffled_keys(2 * n);
+	Set s;
+	for (std::size_t i = 0; i < n; i++)
+		s.insert(keys[i]);
+
+	std::size_t out = 0, in = n;
+	for (auto _ : state) {
+		s.erase(s.find(keys[out]));
+		s.insert(keys[in]);
+		std::swap(keys[out], keys[in]);
+		out = (out + 1) % n;
+		in = n + (in + 1 - n) % n;
+	}
+	state.SetItemsProcessed(state.iterations() * 2);
+}
+
+template <typename Set>
+void BM_build_and_clear(benchmark::State &state) {
+	std::size_t n = static_cast<std::size_t>(state.range(0));
+	std::vector<int> keys = shuffled_keys(n);
+	Set s;
+	for (auto _ : state) {
+		for (int k : keys)
+			s.insert(k);
+		s.clear();
+	}
+	state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(n));
+}
+
+/*
+* Ordered-queue use: take the smallest element, push a later one.
+*/
+void BM_ordered_queue(benchmark::State &state) {
+	std::size_t n = static_cast<std::size_t>(state.range(0));
+	std::vector<int> keys = shuffled_keys(n);
+	set<int> s(keys.begin(), keys.end());
+	int next = static_cast<int>(n);
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(s.front());
+		s.pop_front();
+		s.insert(next++);
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+
+set<int> every_nth(std::size_t n, int step, int offset = 0) {
+	std::vector<int> keys;
+	keys.reserve(n);
+	for (std::size_t i = 0; i < n; i++)
+		keys.push_back(offset + static_cast<int>(i) * step);
+	return set<int>(assume_sorted_unique, keys.begin(), keys.end());
+}
+
+/*
+* Small filter (range(1) keys) against a large index (range(0) keys).
+*/
+void BM_intersection_std_iterators(benchmark::State &state) {
+	set<int> index = every_nth(state.range(0), 1);
+	set<int> filter = every_nth(state.range(1), static_cast<int>(state.range(0) / state.range(1)), 1);
+	for (auto _ : state) {
+		std::vector<int> out;
+		std::set_intersection(filter.begin(), filter.end(), index.begin(), index.end(), std::back_inserter(out));
+		benchmark::DoNotOptimize(out.data());
+	}
+}
+
+void BM_intersection_lookup(benchmark::State &state) {
+	set<int> index = every_nth(state.range(0), 1);
+	set<int> filter = every_nth(state.range(1), static_cast<int>(state.range(0) / state.range(1)), 1);
+	for (auto _ : state) {
+		set<int> out = set_intersection(filter, index);
+		benchmark::DoNotOptimize(out.size());
+	}
+}
+
+void BM_intersection_in_place(benchmark::State &state) {
+	set<int> index = every_nth(state.range(0), 1);
+	set<int> filter = every_nth(state.range(1), static_cast<int>(state.range(0) / state.range(1)), 1);
+	for (auto _ : state) {
+		state.PauseTiming();
+		set<int> lhs(filter), rhs(index);
+		state.ResumeTiming();
+		set<int> out = set_intersection(std::move(lhs), std::move(rhs));
+		benchmark::DoNotOptimize(out.size());
+		state.PauseTiming();
+		out.clear();
+		state.ResumeTiming();
+	}
+}
+
+void BM_union_std_iterators(benchmark::State &state) {
+	set<int> a = every_nth(state.range(0), 2), b = every_nth(state.range(1), 3);
+	for (auto _ : state) {
+		std::vector<int> out;
+		std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(out));
+		benchmark::DoNotOptimize(out.data());
+	}
+}
+
+void BM_union_in_place(benchmark::State &state) {
+	set<int> a = every_nth(state.range(0), 2), b = every_nth(state.range(1), 3);
+	for (auto _ : state) {
+		state.PauseTiming();
+		set<int> lhs(a), rhs(b);
+		state.ResumeTiming();
+		set<int> out = set_union(std::move(lhs), std::move(rhs));
+		benchmark::DoNotOptimize(out.size());
+		state.PauseTiming();
+		out.clear();
+		state.ResumeTiming();
+	}
+}
+
+/*
+* Random point lookups, half of them misses, over a set of range(0) keys.
+*/
+template <typename Set>
+void BM_lookup(benchmark::State &state) {
+	std::size_t n = static_cast<std::size_t>(state.range(0));
+	std::size_t before = byte_counting_allocator<char>::bytes;
+	std::vector<int> keys = shuffled_keys(n);
+	for (int &k : keys)
+		k *= 2;
+	Set s(keys.begin(), keys.end());
+	state.counters["bytes_per_element"] = double(byte_counting_allocator<char>::bytes - before) / double(n);
+
+	std::vector<int> probes = shuffled_keys(2 * n, 2);
+	probes.resize(std::min<std::size_t>(probes.size(), 1 << 20));
+	std::size_t i = 0, found = 0;
+	for (auto _ : state) {
+		found += s.contains(probes[i]);
+		if (++i == probes.size())
+			i = 0;
+	}
+	benchmark::DoNotOptimize(found);
+	state.SetItemsProcessed(state.iterations());
+}
+
+void BM_frozen_lookup(benchmark::State &state) {
+	std::size_t n = static_cast<std::size_t>(state.range(0));
+	std::vector<int> keys = shuffled_keys(n);
+	for (int &k : keys)
+		k *= 2;
+	frozen_set<int> f = set<int>(keys.begin(), keys.end()).freeze();
+	state.counters["bytes_per_element"] = double(f.memory_usage()) / double(n);
+
+	std::vector<int> probes = shuffled_keys(2 * n, 2);
+	probes.resize(std::min<std::size_t>(probes.size(), 1 << 20));
+	std::size_t i = 0, found = 0;
+	for (auto _ : state) {
+		found += f.contains(probes[i]);
+		if (++i == probes.size())
+			i = 0;
+	}
+	benchmark::DoNotOptimize(found);
+	state.SetItemsProcessed(state.iterations());
+}
+
+/*
+* The baseline concurrent_set replaces: one set behind one mutex.
+*/
+struct locked_set {
+	bool contains(int x) const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return s.contains(x);
+	}
+
+	bool insert(int x) {
+		std::lock_guard<std::mutex> lock(mutex);
+		return s.insert(x).second;
+	}
+
+	bool erase(int x) {
+		std::lock_guard<std::mutex> lock(mutex);
+		auto it = s.find(x);
+		if (it == s.end())
+			return false;
+		s.erase(it);
+		return true;
+	}
+
+	mutable std::mutex mutex;
+	set<int> s;
+};
+
+/*
+* Every thread looks up random keys in a shared set of 1e6 even keys;
+* thread 0 additionally inserts or erases an odd key on every iteration.
+*/
+template <typename Shared>
+void BM_concurrent_reads(benchmark::State &state) {
+	static Shared shared;
+	static std::once_flag filled;
+	std::call_once(filled, [] {
+		for (int i = 0; i < 2000000; i += 2)
+			shared.insert(i);
+	});
+
+	std::mt19937 gen(static_cast<unsigned>(state.thread_index()));
+	bool writer = state.thread_index() == 0;
+	std::size_t found = 0;
+	for (auto _ : state) {
+		found += shared.contains(static_cast<int>(gen() % 2000000));
+		if (writer) {
+			int x = static_cast<int>(gen() % 1000000) * 2 + 1;
+			if (gen() & 1)
+				shared.insert(x);
+			else
+				shared.erase(x);
+		}
+	}
+	benchmark::DoNotOptimize(found);
+	state.SetItemsProcessed(state.iterations());
+}
+
+/*
+* Takes a point-in-time copy of an n-element set and then inserts a random
+* odd key into the original; persistent_set shares the tree and copies only
+* the path the insert touches.
+*/
+template <typename Set>
+void BM_snapshot_then_update(benchmark::State &state) {
+	int n = static_cast<int>(state.range(0));
+	Set s;
+	for (int i = 0; i < n; i++)
+		s.insert(2 * i);
+	std::mt19937 gen(16);
+	for (auto _ : state) {
+		Set snapshot(s);
+		int x = static_cast<int>(gen() % n) * 2 + 1;
+		s.insert(x);
+		benchmark::DoNotOptimize(snapshot.size());
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+
+/*
+* Bulk build from an unsorted batch with duplicates, and union of two
+* disjoint halves, on a pool of state.range(1) threads.
+*/
+void BM_parallel_build(benchmark::State &state) {
+	std::size_t n = static_cast<std::size_t>(state.range(0));
+	std::vector<int> keys = shuffled_keys(n);
+	thread_pool pool(static_cast<std::size_t>(state.range(1)));
+	for (auto _ : state) {
+		set<int> s(pool, keys.begin(), keys.end());
+		benchmark::DoNotOptimize(s.size());
+		state.PauseTiming();
+		s.clear();
+		state.ResumeTiming();
+	}
+	state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(n));
+}
+
+void BM_parallel_union(benchmark::State &state) {
+	std::size_t n = static_cast<std::size_t>(state.range(0));
+	std::vector<int> keys = shuffled_keys(n);
+	thread_pool pool(static_cast<std::size_t>(state.range(1)));
+	for (auto _ : state) {
+		state.PauseTiming();
+		set<int> a(keys.begin(), keys.begin() + n / 2);
+		set<int> b(keys.begin() + n / 2, keys.end());
+		state.ResumeTiming();
+		set<int> u = set_union(pool, std::move(a), std::move(b));
+		benchmark::DoNotOptimize(u.size());
+		state.PauseTiming();
+		u.clear();
+		state.ResumeTiming();
+	}
+	state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(n));
+}
+
+/*
+* Looks up requests of 256 random keys, half of them present, one find()
+* at a time or through find_batch().
+*/
+template <bool Batched>
+void BM_find_requests(benchmark::State &state) {
+	std::size_t n = static_cast<std::size_t>(state.range(0));
+	std::vector<int> keys = shuffled_keys(n);
+	for (int &k : keys)
+		k *= 2;
+	set<int> s(keys.begin(), keys.end());
+
+	const std::size_t request = 256;
+	std::vector<int> probes = shuffled_keys(2 * n, 2);
+	probes.resize(std::max(request, std::min<std::size_t>(probes.size(), 1 << 20) / request * request));
+	std::vector<set<int>::const_iterator> results(request);
+	std::size_t offset = 0, found = 0;
+	for (auto _ : state) {
+		auto first = probes.begin() + static_cast<std::ptrdiff_t>(offset);
+		if (Batched) {
+			s.find_batch(first, first + request, results.begin());
+		}
+		else {
+			for (std::size_t i = 0; i < request; i++)
+				results[i] = s.find(first[i]);
+		}
+		found += results[request - 1] != s.end();
+		offset = (offset + request) % probes.size();
+	}
+	benchmark::DoNotOptimize(found);
+	state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(request));
+}
+
+/*
+* Expiry of time-ordered keys: the set holds a sliding window of n keys,
+* and each iteration appends n / 10 new ones and drops the oldest n / 10,
+* with erase_range or one erase(const_iterator) at a time.
+*/
+template <bool Ranged>
+void BM_expire_window(benchmark::State &state) {
+	int n = static_cast<int>(state.range(0));
+	int batch = n / 10;
+	set<int> s;
+	for (int i = 0; i < n; i++)
+		s.insert(s.end(), i);
+	int oldest = 0;
+	for (auto _ : state) {
+		state.PauseTiming();
+		for (int i = 0; i < batch; i++)
+			s.insert(s.end(), oldest + n + i);
+		state.ResumeTiming();
+		if (Ranged) {
+			s.erase_range(oldest, oldest + batch);
+		}
+		else {
+			for (auto it = s.begin(); it != s.end() && *it < oldest + batch; )
+				it = s.erase(it);
+		}
+		oldest += batch;
+	}
+	state.SetItemsProcessed(state.iterations() * batch);
+}
+
+/*
+* Restart path: rebuild an n-element set from a dump, against inserting
+* the same sorted keys one at a time.
+*/
+template <bool FromDump>
+void BM_load(benchmark::State &state) {
+	std::size_t n = static_cast<std::size_t>(state.range(0));
+	std::vector<int> keys = shuffled_keys(n);
+	std::sort(keys.begin(), keys.end());
+	std::vector<char> dump;
+	serialize(set<int>(assume_sorted_unique, keys.begin(), keys.end()), dump);
+	for (auto _ : state) {
+		set<int> s;
+		if (FromDump) {
+			deserialize(dump.data(), dump.size(), s);
+		}
+		else {
+			for (int k : keys)
+				s.insert(k);
+		}
+		benchmark::DoNotOptimize(s.size());
+		state.PauseTiming();
+		s.clear();
+		state.ResumeTiming();
+	}
+	state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(n));
+	state.counters["dump_bytes_per_element"] = double(dump.size()) / double(n);
+}
+
+/*
+* Opens an n-element mapped_set file read-only and looks up 1000 keys; the
+* open cost does not depend on n. Compare with BM_load<true>.
+*/
+void BM_mapped_open(benchmark::State &state) {
+	std::size_t n = static_cast<std::size_t>(state.range(0));
+	std::string path = "myset_bench_" + std::to_string(n) + ".map";
+	std::remove(path.c_str());
+	{
+		mapped_set<int> writer(path, map_mode::read_write);
+		for (int k : shuffled_keys(n))
+			writer.insert(k);
+		writer.sync();
+	}
+	std::vector<int> probes = shuffled_keys(1000, 3);
+	for (auto _ : state) {
+		mapped_set<int> reader(path, map_mode::read_only);
+		std::size_t found = 0;
+		for (int k : probes)
+			found += reader.contains(k);
+		benchmark::DoNotOptimize(found);
+	}
+	std::remove(path.c_str());
+}
+
+/*
+* Baseline suite: every operation below runs against set and std::set for
+* each key type, key order and size, under names of the form
+* suite/<container>/<key>/<operation>/<order>/<n>, so that two JSON reports
+* (--benchmark_out=<file> --benchmark_out_format=json) can be diffed, or
+* one filtered with --benchmark_filter=suite/set/int/ for a quick run.
+*
+* Keys are even numbers, so a lookup of id * 2 + 1 always misses. The key
+* order is the order in which keys are inserted, looked up or erased:
+* ascending, uniformly shuffled, or Zipf-distributed (theta 0.99) over a
+* shuffled key space, so the hot keys are spread over the whole tree.
+*/
+enum class key_order { sequential, random, zipf };
+
+struct pod64 {
+	std::uint64_t key;
+	char payload[56];
+
+	friend bool operator<(pod64 const &a, pod64 const &b) {
+		return a.key < b.key;
+	}
+};
+
+static_assert(sizeof(pod64) == 64, "pod64 must be 64 bytes");
+
+template <typename K>
+K make_key(std::uint64_t id);
+
+template <>
+int make_key<int>(std::uint64_t id) {
+	return static_cast<int>(id);
+}
+
+template <>
+std::uint64_t make_key<std::uint64_t>(std::uint64_t id) {
+	return id;
+}
+
+// Long enough to defeat the small string optimization, like most real keys.
+template <>
+std::string make_key<std::string>(std::uint64_t id) {
+	char buf[32];
+	std::snprintf(buf, sizeof(buf), "user:%016llu", static_cast<unsigned long long>(id));
+	return buf;
+}
+
+template <>
+pod64 make_key<pod64>(std::uint64_t id) {
+	pod64 key;
+	key.key = id;
+	std::memset(key.payload, static_cast<int>(id & 0xff), sizeof(key.payload));
+	return key;
+}
+
+/*
+* Zipf sampler over [0, n) from Gray et al., "Quickly generating
+* billion-record synthetic databases"; rank 0 is the most frequent.
+*/
+struct zipf_distribution {
+	zipf_distribution(std::uint64_t n, double theta = 0.99) : n_(n), theta_(theta) {
+		zeta_n_ = zeta(n);
+		alpha_ = 1 / (1 - theta);
+		eta_ = (1 - std::pow(2.0 / double(n), 1 - theta)) / (1 - zeta(2) / zeta_n_);
+	}
+
+	template <typename Gen>
+	std::uint64_t operator()(Gen &gen) {
+		double u = std::uniform_real_distribution<double>(0, 1)(gen);
+		double uz = u * zeta_n_;
+		if (uz < 1)
+			return 0;
+		if (uz < 1 + std::pow(0.5, theta_))
+			return std::min<std::uint64_t>(1, n_ - 1);
+		auto rank = static_cast<std::uint64_t>(double(n_) * std::pow(eta_ * u - eta_ + 1, alpha_));
+		return std::min(rank, n_ - 1);
+	}
+
+private:
+	double zeta(std::uint64_t n) const {
+		double sum = 0;
+		for (std::uint64_t i = 1; i <= n; i++)
+			sum += 1 / std::pow(double(i), theta_);
+		return sum;
+	}
+
+	std::uint64_t n_;
+	double theta_, zeta_n_, alpha_, eta_;
+};
+
+/*
+* count key ids from [0, n) in the given order; only the Zipf order repeats ids.
+*/
+std::vector<std::uint64_t> key_ids(std::size_t n, std::size_t count, key_order order, unsigned seed) {
+	std::vector<std::uint64_t> ids(count);
+	std::mt19937_64 gen(seed);
+	if (order == key_order::sequential) {
+		for (std::size_t i = 0; i < count; i++)
+			ids[i] = i % n;
+		return ids;
+	}
+	std::vector<std::uint64_t> perm(n);
+	for (std::size_t i = 0; i < n; i++)
+		perm[i] = i;
+	std::shuffle(perm.begin(), perm.end(), gen);
+	if (order == key_order::random) {
+		for (std::size_t i = 0; i < count; i++)
+			ids[i] = perm[i % n];
+		return ids;
+	}
+	zipf_distribution zipf(n);
+	for (std::size_t i = 0; i < count; i++)
+		ids[i] = perm[zipf(gen)];
+	return ids;
+}
+
+template <typename K>
+std::vector<K> suite_keys(std::size_t n, std::size_t count, key_order order, unsigned seed, std::uint64_t offset = 0) {
+	std::vector<K> keys;
+	keys.reserve(count);
+	for (std::uint64_t id : key_ids(n, count, order, seed))
+		keys.push_back(make_key<K>(id * 2 + offset));
+	return keys;
+}
+
+// Point operations cycle through at most this many precomputed probes.
+constexpr std::size_t suite_probes = 1 << 20;
+
+template <typename Set>
+Set suite_fill(std::size_t n, key_order order) {
+	Set s;
+	for (auto const &k : suite_keys<typename Set::value_type>(n, n, order, 1))
+		s.insert(k);
+	return s;
+}
+
+template <typename Set>
+void BM_suite_insert(benchmark::State &state, key_order order) {
+	std::size_t n = static_cast<std::size_t>(state.range(0));
+	auto keys = suite_keys<typename Set::value_type>(n, n, order, 1);
+	for (auto _ : state) {
+		Set s;
+		for (auto const &k : keys)
+			s.insert(k);
+		benchmark::DoNotOptimize(s.size());
+		state.PauseTiming();
+		s.clear();
+		state.ResumeTiming();
+	}
+	state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(n));
+}
+
+template <typename Set>
+void BM_suite_find(benchmark::State &state, key_order order) {
+	std::size_t n = static_cast<std::size_t>(state.range(0));
+	Set s = suite_fill<Set>(n, key_order::random);
+	auto probes = suite_keys<typename Set::value_type>(n, std::min(n, suite_probes), order, 2);
+	std::size_t i = 0, found = 0;
+	for (auto _ : state) {
+		found += s.find(probes[i]) != s.end();
+		if (++i == probes.size())
+			i = 0;
+	}
+	benchmark::DoNotOptimize(found);
+	state.SetItemsProcessed(state.iterations());
+}
+
+template <typename Set>
+void BM_suite_lower_bound(benchmark::State &state, key_order order) {
+	std::size_t n = static_cast<std::size_t>(state.range(0));
+	Set s = suite_fill<Set>(n, key_order::random);
+	auto probes = suite_keys<typename Set::value_type>(n, std::min(n, suite_probes), order, 2, 1);
+	std::size_t i = 0, found = 0;
+	for (auto _ : state) {
+		found += s.lower_bound(probes[i]) != s.end();
+		if (++i == probes.size())
+			i = 0;
+	}
+	benchmark::DoNotOptimize(found);
+	state.SetItemsProcessed(state.iterations());
+}
+
+/*
+* Erases n keys in the given order from a set of n keys built in random
+* order; under the Zipf order most of them are repeats and miss.
+*/
+template <typename Set>
+void BM_suite_erase(benchmark::State &state, key_order order) {
+	std::size_t n = static_cast<std::size_t>(state.range(0));
+	Set full = suite_fill<Set>(n, key_order::random);
+	auto keys = suite_keys<typename Set::value_type>(n, n, order, 2);
+	for (auto _ : state) {
+		state.PauseTiming();
+		Set s(full);
+		state.ResumeTiming();
+		for (auto const &k : keys)
+			s.erase(k);
+		benchmark::DoNotOptimize(s.size());
+	}
+	state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(n));
+}
+
+// For the whole-set operations the order is the one the set was built in,
+// which decides how its nodes are laid out in memory.
+template <typename Set>
+void BM_suite_iterate(benchmark::State &state, key_order order) {
+	std::size_t n = static_cast<std::size_t>(state.range(0));
+	Set s = suite_fill<Set>(n, order);
+	for (auto _ : state)
+		for (auto const &k : s)
+			benchmark::DoNotOptimize(&k);
+	state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(s.size()));
+}
+
+template <typename Set>
+void BM_suite_copy(benchmark::State &state, key_order order) {
+	std::size_t n = static_cast<std::size_t>(state.range(0));
+	Set s = suite_fill<Set>(n, order);
+	for (auto _ : state) {
+		std::optional<Set> copy(s);
+		benchmark::DoNotOptimize(copy->size());
+		state.PauseTiming();
+		copy.reset();
+		state.ResumeTiming();
+	}
+	state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(s.size()));
+}
+
+template <typename Set>
+void BM_suite_clear(benchmark::State &state, key_order order) {
+	std::size_t n = static_cast<std::size_t>(state.range(0));
+	Set full = suite_fill<Set>(n, order);
+	for (auto _ : state) {
+		state.PauseTiming();
+		Set s(full);
+		state.ResumeTiming();
+		s.clear();
+		benchmark::DoNotOptimize(s.size());
+	}
+	state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(full.size()));
+}
+
+template <typename Set>
+void register_suite(std::string const &prefix) {
+	using operation = void (*)(benchmark::State &, key_order);
+	std::pair<char const *, operation> const operations[] = {
+		{ "insert", &BM_suite_insert<Set> },
+		{ "find", &BM_suite_find<Set> },
+		{ "erase", &BM_suite_erase<Set> },
+		{ "lower_bound", &BM_suite_lower_bound<Set> },
+		{ "iterate", &BM_suite_iterate<Set> },
+		{ "copy", &BM_suite_copy<Set> },
+		{ "clear", &BM_suite_clear<Set> },
+	};
+	std::pair<char const *, key_order> const orders[] = {
+		{ "sequential", key_order::sequential },
+		{ "random", key_order::random },
+		{ "zipf", key_order::zipf },
+	};
+	for (auto const &op : operations)
+		for (auto const &order : orders)
+			benchmark::RegisterBenchmark((prefix + "/" + op.first + "/" + order.first).c_str(), op.second, order.second)
+				->RangeMultiplier(10)->Range(1000, 10000000)->ArgName("n");
+}
+
+template <typename K>
+void register_suite_for(std::string const &key) {
+	register_suite<set<K>>("suite/set/" + key);
+	register_suite<std::set<K>>("suite/std_set/" + key);
+}
+
+int register_suites() {
+	register_suite_for<int>("int");
+	register_suite_for<std::uint64_t>("uint64");
+	register_suite_for<std::string>("string");
+	register_suite_for<pod64>("pod64");
+	return 0;
+}
+
+template <typename Set>
+void BM_random_insert(benchmark::State &state) {
+	std::size_t n = static_cast<std::size_t>(state.range(0));
+	std::vector<int> keys = shuffled_keys(n);
+	for (auto _ : state) {
+		Set s;
+		for (int k : keys)
+			s.insert(k);
+		benchmark::DoNotOptimize(s.size());
+		state.PauseTiming();
+		s.clear();
+		state.ResumeTiming();
+	}
+	state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(n));
+}
+
+BENCHMARK(BM_ordered_queue)->RangeMultiplier(10)->Range(1000, 1000000);
+BENCHMARK(BM_intersection_std_iterators)->Args({ 1000000, 100 })->Args({ 1000000, 10000 });
+BENCHMARK(BM_intersection_lookup)->Args({ 1000000, 100 })->Args({ 1000000, 10000 });
+BENCHMARK(BM_intersection_in_place)->Args({ 1000000, 100 })->Args({ 1000000, 10000 })->Iterations(20);
+BENCHMARK(BM_union_std_iterators)->Args({ 1000000, 100 })->Args({ 100000, 100000 });
+BENCHMARK(BM_union_in_place)->Args({ 1000000, 100 })->Args({ 100000, 100000 })->Iterations(20);
+
+BENCHMARK_TEMPLATE(BM_insert_erase_churn, default_set)->RangeMultiplier(10)->Range(1000, 1000000);
+BENCHMARK_TEMPLATE(BM_insert_erase_churn, pooled_set)->RangeMultiplier(10)->Range(1000, 1000000);
+BENCHMARK_TEMPLATE(BM_build_and_clear, default_set)->RangeMultiplier(10)->Range(1000, 1000000);
+BENCHMARK_TEMPLATE(BM_build_and_clear, pooled_set)->RangeMultiplier(10)->Range(1000, 1000000);
+
+BENCHMARK_TEMPLATE(BM_lookup, counted_set)->RangeMultiplier(10)->Range(10000, 100000000);
+BENCHMARK_TEMPLATE(BM_lookup, counted_btree_set)->RangeMultiplier(10)->Range(10000, 100000000);
+BENCHMARK_TEMPLATE(BM_lookup, counted_flat_set)->RangeMultiplier(10)->Range(10000, 100000000);
+BENCHMARK_TEMPLATE(BM_lookup, counted_index_set)->RangeMultiplier(10)->Range(10000, 100000000);
+BENCHMARK_TEMPLATE(BM_lookup, counted_lean_set)->RangeMultiplier(10)->Range(10000, 100000000);
+BENCHMARK_TEMPLATE(BM_lookup, instrumented_set)->RangeMultiplier(10)->Range(10000, 100000000);
+BENCHMARK(BM_frozen_lookup)->RangeMultiplier(10)->Range(10000, 100000000);
+BENCHMARK_TEMPLATE(BM_concurrent_reads, concurrent_set<int>)->ThreadRange(1, 64)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_concurrent_reads, locked_set)->ThreadRange(1, 64)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_random_insert, counted_set)->RangeMultiplier(10)->Range(10000, 100000000)->Iterations(3);
+BENCHMARK_TEMPLATE(BM_random_insert, counted_btree_set)->RangeMultiplier(10)->Range(10000, 100000000)->Iterations(3);
+BENCHMARK_TEMPLATE(BM_random_insert, counted_index_set)->RangeMultiplier(10)->Range(10000, 100000000)->Iterations(3);
+BENCHMARK_TEMPLATE(BM_random_insert, counted_lean_set)->RangeMultiplier(10)->Range(10000, 100000000)->Iterations(3);
+BENCHMARK_TEMPLATE(BM_snapshot_then_update, set<int>)->RangeMultiplier(10)->Range(1000, 1000000);
+BENCHMARK_TEMPLATE(BM_snapshot_then_update, persistent_set<int>)->RangeMultiplier(10)->Range(1000, 1000000);
+BENCHMARK(BM_parallel_build)->ArgsProduct({ { 1000000, 50000000 }, { 1, 2, 4, 8, 16 } })->UseRealTime()->Iterations(3);
+BENCHMARK(BM_parallel_union)->ArgsProduct({ { 1000000, 10000000 }, { 1, 2, 4, 8, 16 } })->UseRealTime()->Iterations(3);
+BENCHMARK_TEMPLATE(BM_find_requests, false)->RangeMultiplier(10)->Range(10000, 10000000);
+BENCHMARK_TEMPLATE(BM_find_requests, true)->RangeMultiplier(10)->Range(10000, 10000000);
+BENCHMARK_TEMPLATE(BM_expire_window, false)->RangeMultiplier(10)->Range(10000, 1000000);
+BENCHMARK_TEMPLATE(BM_expire_window, true)->RangeMultiplier(10)->Range(10000, 1000000);
+BENCHMARK_TEMPLATE(BM_load, false)->RangeMultiplier(10)->Range(10000, 10000000)->Iterations(3);
+BENCHMARK_TEMPLATE(BM_load, true)->RangeMultiplier(10)->Range(10000, 10000000)->Iterations(3);
+BENCHMARK(BM_mapped_open)->RangeMultiplier(10)->Range(10000, 10000000)->Iterations(20);
+
+static int suites_registered = register_suites();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,849 @@
+#ifndef BTREE_SET_H
+#define BTREE_SET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <cassert>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/*
+* B-tree with the same lookup, iteration and modification surface as set<T>.
+* Each node holds as many keys as fit in target_node_bytes, so a lookup
+* touches one node (a few cache lines) per level instead of one per key.
+*
+* Unlike set<T>, elements move between nodes: insert and erase invalidate
+* all iterators, and node handles, split/join are not offered.
+*/
+template <typename T, typename Compare = std::less<T>, typename Alloc = std::allocator<T>>
+struct btree_set {
+
+private:
+
+	static constexpr std::size_t target_node_bytes = 256;
+
+	struct leaf_node;
+	struct internal_node;
+
+	struct node_header {
+		internal_node * parent;
+		std::uint16_t position;
+		std::uint16_t count;
+		bool leaf;
+	};
+
+public:
+
+	static constexpr std::size_t node_slots = std::max<std::size_t>(3,
+		(target_node_bytes - sizeof(node_header)) / sizeof(T));
+
+private:
+
+	static constexpr std::size_t min_slots = (node_slots - 1) / 2;
+
+	struct leaf_node : node_header {
+		alignas(T) unsigned char storage[node_slots * sizeof(T)];
+
+		T * value(std::size_t i) {
+			return std::launder(reinterpret_cast<T*>(storage) + i);
+		}
+	};
+
+	struct internal_node : leaf_node {
+		leaf_node * children[node_slots + 1];
+	};
+
+	using leaf_allocator = typename std::allocator_traits<Alloc>::template rebind_alloc<leaf_node>;
+	using internal_allocator = typename std::allocator_traits<Alloc>::template rebind_alloc<internal_node>;
+	using leaf_traits = std::allocator_traits<leaf_allocator>;
+	using internal_traits = std::allocator_traits<internal_allocator>;
+
+	leaf_node * root_;
+	leaf_node * leftmost_;
+	leaf_node * rightmost_;
+	std::size_t size_;
+	Compare comp_;
+	leaf_allocator alloc_;
+
+public:
+
+	using key_type = T;
+	using value_type = T;
+	using size_type = std::size_t;
+	using key_compare = Compare;
+	using value_compare = Compare;
+	using allocator_type = typename std::allocator_traits<Alloc>::template rebind_alloc<T>;
+
+	btree_set()
+		: root_(nullptr), leftmost_(nullptr), rightmost_(nullptr), size_(0), comp_(), alloc_()
+	{}
+
+	explicit btree_set(Compare const &comp, Alloc const &alloc = Alloc())
+		: root_(nullptr), leftmost_(nullptr), rightmost_(nullptr), size_(0), comp_(comp), alloc_(alloc)
+	{}
+
+	template <typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+	btree_set(InputIt first, InputIt last)
+		: btree_set()
+	{
+		insert(first, last);
+	}
+
+	btree_set(btree_set const &other)
+		: root_(nullptr), leftmost_(nullptr), rightmost_(nullptr), size_(0), comp_(other.comp_)
+		, alloc_(leaf_traits::select_on_container_copy_construction(other.alloc_))
+	{
+		clone_from(other);
+	}
+
+	btree_set(btree_set &&other) noexcept
+		: root_(other.root_), leftmost_(other.leftmost_), rightmost_(other.rightmost_), size_(other.size_)
+		, comp_(std::move(other.comp_)), alloc_(std::move(other.alloc_))
+	{
+		other.root_ = other.leftmost_ = other.rightmost_ = nullptr;
+		other.size_ = 0;
+	}
+
+	/*
+	* Copies into nodes from this set's allocator, or from rhs's when it
+	* propagates on copy assignment.
+	*/
+	btree_set& operator=(btree_set const &rhs) {
+		if (this != &rhs) {
+			constexpr bool propagate = leaf_traits::propagate_on_container_copy_assignment::value;
+			btree_set tmp(rhs.comp_, propagate ? rhs.get_allocator() : get_allocator());
+			tmp.clone_from(rhs);
+			clear();
+			if (propagate)
+				alloc_ = tmp.alloc_;
+			take_nodes(tmp);
+		}
+		return *this;
+	}
+
+	/*
+	* Steals rhs's nodes when the allocator propagates or the two compare
+	* equal, and moves the elements one by one otherwise.
+	*/
+	btree_set& operator=(btree_set &&rhs) noexcept(leaf_traits::propagate_on_container_move_assignment::value
+		|| leaf_traits::is_always_equal::value) {
+		if (this == &rhs)
+			return *this;
+		if (leaf_traits::propagate_on_container_move_assignment::value || alloc_ == rhs.alloc_) {
+			clear();
+			if (leaf_traits::propagate_on_container_move_assignment::value)
+				alloc_ = std::move(rhs.alloc_);
+			take_nodes(rhs);
+		}
+		else {
+			btree_set tmp(rhs.comp_, get_allocator());
+			tmp.template clone_from<true>(rhs);
+			rhs.clear();
+			clear();
+			take_nodes(tmp);
+		}
+		return *this;
+	}
+
+	~btree_set() {
+		clear();
+	}
+
+	void swap(btree_set &other) noexcept {
+		using std::swap;
+		swap(root_, other.root_);
+		swap(leftmost_, other.leftmost_);
+		swap(rightmost_, other.rightmost_);
+		swap(size_, other.size_);
+		swap(comp_, other.comp_);
+		if (leaf_traits::propagate_on_container_swap::value)
+			swap(alloc_, other.alloc_);
+	}
+
+	allocator_type get_allocator() const {
+		return allocator_type(alloc_);
+	}
+
+	key_compare key_comp() const {
+		return comp_;
+	}
+
+	value_compare value_comp() const {
+		return comp_;
+	}
+
+	/*
+	* === === === === === === === === === === === === === === ===
+	*                      I T E R A T O R S
+	* === === === === === === === === === === === === === === ===
+	*/
+
+	template <typename U>
+	class Iterator {
+	public:
+		friend struct btree_set;
+
+		using difference_type = std::ptrdiff_t;
+		using value_type = U;
+		using pointer = U * ;
+		using reference = U & ;
+		using iterator_category = std::bidirectional_iterator_tag;
+
+		Iterator() : node_(nullptr), pos_(0)
+		{}
+
+		pointer operator->() const {
+			return node_->value(pos_);
+		}
+
+		reference operator*() const {
+			return *node_->value(pos_);
+		}
+
+		Iterator& operator++() {
+			if (node_->leaf) {
+				if (++pos_ < node_->count)
+					return *this;
+				Iterator save = *this;
+				while (pos_ == node_->count && node_->parent != nullptr) {
+					pos_ = node_->position;
+					node_ = node_->parent;
+				}
+				if (pos_ == node_->count)
+					*this = save;
+			}
+			else {
+				node_ = child(node_, pos_ + 1);
+				while (!node_->leaf)
+					node_ = child(node_, 0);
+				pos_ = 0;
+			}
+			return *this;
+		}
+
+		Iterator operator++(int) {
+			auto tmp(*this);
+			++(*this);
+			return tmp;
+		}
+
+		Iterator& operator--() {
+			if (node_->leaf) {
+				if (pos_ > 0) {
+					--pos_;
+					return *this;
+				}
+				while (pos_ == 0 && node_->parent != nullptr) {
+					pos_ = node_->position;
+					node_ = node_->parent;
+				}
+				--pos_;
+			}
+			else {
+				node_ = child(node_, pos_);
+				while (!node_->leaf)
+					node_ = child(node_, node_->count);
+				pos_ = node_->count - 1;
+			}
+			return *this;
+		}
+
+		Iterator operator--(int) {
+			auto tmp(*this);
+			--(*this);
+			return tmp;
+		}
+
+		friend bool operator==(const Iterator& lhs, const Iterator& rhs) {
+			return lhs.node_ == rhs.node_ && lhs.pos_ == rhs.pos_;
+		}
+		friend bool operator!=(const Iterator& lhs, const Iterator& rhs) {
+			return !(lhs == rhs);
+		}
+
+	private:
+		Iterator(leaf_node * node, std::size_t pos) : node_(node), pos_(pos)
+		{}
+
+		leaf_node * node_;
+		std::size_t pos_;
+	};
+
+	using iterator = Iterator<const T>;
+	using const_iterator = Iterator<const T>;
+	using reverse_iterator = std::reverse_iterator<iterator>;
+	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+	iterator begin() const {
+		return iterator(leftmost_, 0);
+	}
+
+	iterator end() const {
+		return iterator(rightmost_, rightmost_ ? rightmost_->count : 0);
+	}
+
+	const_iterator cbegin() const { return begin(); }
+	const_iterator cend() const { return end(); }
+	reverse_iterator rbegin() const { return reverse_iterator(end()); }
+	reverse_iterator rend() const { return reverse_iterator(begin()); }
+	const_reverse_iterator crbegin() const { return const_reverse_iterator(end()); }
+	const_reverse_iterator crend() const { return const_reverse_iterator(begin()); }
+
+	/*
+	* === === === === === === === === === === === === === === ===
+	*                 C O M M O N  M E T H O D S
+	* === === === === === === === === === === === === === === ===
+	*/
+
+	const_iterator find(T const &value) const {
+		return find_impl(value);
+	}
+
+	const_iterator lower_bound(T const &value) const {
+		return lower_bound_impl(value);
+	}
+
+	const_iterator upper_bound(T const &value) const {
+		return upper_bound_impl(value);
+	}
+
+	bool contains(T const &value) const {
+		return find_impl(value) != end();
+	}
+
+	size_type count(T const &value) const {
+		return contains(value) ? 1 : 0;
+	}
+
+	template <typename K, typename C = Compare, typename = typename C::is_transparent>
+	const_iterator find(K const &key) const {
+		return find_impl(key);
+	}
+
+	template <typename K, typename C = Compare, typename = typename C::is_transparent>
+	const_iterator lower_bound(K const &key) const {
+		return lower_bound_impl(key);
+	}
+
+	template <typename K, typename C = Compare, typename = typename C::is_transparent>
+	const_iterator upper_bound(K const &key) const {
+		return upper_bound_impl(key);
+	}
+
+	template <typename K, typename C = Compare, typename = typename C::is_transparent>
+	bool contains(K const &key) const {
+		return find_impl(key) != end();
+	}
+
+	template <typename K, typename C = Compare, typename = typename C::is_transparent>
+	size_type count(K const &key) const {
+		return contains(key) ? 1 : 0;
+	}
+
+	bool empty() const {
+		return size_ == 0;
+	}
+
+	size_type size() const {
+		return size_;
+	}
+
+	void clear() {
+		if (root_ != nullptr)
+			destroy(root_);
+		root_ = leftmost_ = rightmost_ = nullptr;
+		size_ = 0;
+	}
+
+	std::pair<iterator, bool> insert(T const &value) {
+		return insert_unique(value, value);
+	}
+
+	std::pair<iterator, bool> insert(T &&value) {
+		return insert_unique(value, std::move(value));
+	}
+
+	template <typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+	void insert(InputIt first, InputIt last) {
+		for (; first != last; ++first)
+			insert(*first);
+	}
+
+	template <typename... Args>
+	std::pair<iterator, bool> emplace(Args&&... args) {
+		T value(std::forward<Args>(args)...);
+		return insert_unique(value, std::move(value));
+	}
+
+	/*
+	* Removes the element at pos and returns the iterator following it.
+	* Underfull nodes borrow from a sibling or merge with it.
+	*/
+	iterator erase(const_iterator pos) {
+		leaf_node * node = pos.node_;
+		std::size_t i = pos.pos_;
+		iterator next;
+		if (node->leaf) {
+			erase_value(node, i);
+			next = iterator(node, i);
+		}
+		else {
+			// Replace the separator with its predecessor, which sits in a leaf.
+			leaf_node * leaf = child(node, i);
+			while (!leaf->leaf)
+				leaf = child(leaf, leaf->count);
+			*node->value(i) = std::move(*leaf->value(leaf->count - 1));
+			next = iterator(node, i);
+			++next;
+			erase_value(leaf, leaf->count - 1);
+			node = leaf;
+		}
+		--size_;
+		rebalance_after_erase(node, next);
+		if (root_ == nullptr)
+			return end();
+		while (next.pos_ == next.node_->count && next.node_->parent != nullptr) {
+			next.pos_ = next.node_->position;
+			next.node_ = next.node_->parent;
+		}
+		if (next.pos_ == next.node_->count)
+			return end();
+		return next;
+	}
+
+	size_type erase(T const &value) {
+		const_iterator it = find(value);
+		if (it == end())
+			return 0;
+		erase(it);
+		return 1;
+	}
+
+	/*
+	* Number of levels, 0 for an empty set.
+	*/
+	std::size_t height() const {
+		std::size_t result = 0;
+		for (leaf_node * cur = root_; cur != nullptr; cur = cur->leaf ? nullptr : child(cur, 0))
+			++result;
+		return result;
+	}
+
+private:
+	/*
+	* === === === === === === === === === === === === === === ===
+	*                L O C A L  O P E R A T I O N S
+	* === === === === === === === === === === === === === === ===
+	*/
+
+	static leaf_node *& child(leaf_node * node, std::size_t i) {
+		return static_cast<internal_node*>(node)->children[i];
+	}
+
+	template <typename L, typename R>
+	bool less(L const &lhs, R const &rhs) const {
+		return comp_(lhs, rhs);
+	}
+
+	/*
+	* First slot in node whose value is not less than key.
+	*/
+	template <typename K>
+	std::size_t lower_slot(leaf_node * node, K const &key) const {
+		std::size_t lo = 0, hi = node->count;
+		while (lo < hi) {
+			std::size_t mid = (lo + hi) / 2;
+			if (less(*node->value(mid), key))
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		return lo;
+	}
+
+	template <typename K>
+	std::size_t upper_slot(leaf_node * node, K const &key) const {
+		std::size_t lo = 0, hi = node->count;
+		while (lo < hi) {
+			std::size_t mid = (lo + hi) / 2;
+			if (less(key, *node->value(mid)))
+				hi = mid;
+			else
+				lo = mid + 1;
+		}
+		return lo;
+	}
+
+	template <typename K>
+	const_iterator lower_bound_impl(K const &key) const {
+		const_iterator result = end();
+		for (leaf_node * cur = root_; cur != nullptr; ) {
+			std::size_t i = lower_slot(cur, key);
+			if (i < cur->count)
+				result = const_iterator(cur, i);
+			cur = cur->leaf ? nullptr : child(cur, i);
+		}
+		return result;
+	}
+
+	template <typename K>
+	const_iterator upper_bound_impl(K const &key) const {
+		const_iterator result = end();
+		for (leaf_node * cur = root_; cur != nullptr; ) {
+			std::size_t i = upper_slot(cur, key);
+			if (i < cur->count)
+				result = const_iterator(cur, i);
+			cur = cur->leaf ? nullptr : child(cur, i);
+		}
+		return result;
+	}
+
+	template <typename K>
+	const_iterator find_impl(K const &key) const {
+		for (leaf_node * cur = root_; cur != nullptr; ) {
+			std::size_t i = lower_slot(cur, key);
+			if (i < cur->count && !less(key, *cur->value(i)))
+				return const_iterator(cur, i);
+			cur = cur->leaf ? nullptr : child(cur, i);
+		}
+		return end();
+	}
+
+	leaf_node * create_leaf() {
+		leaf_node * created = leaf_traits::allocate(alloc_, 1);
+		::new (static_cast<void*>(created)) leaf_node;
+		created->parent = nullptr;
+		created->position = 0;
+		created->count = 0;
+		created->leaf = true;
+		return created;
+	}
+
+	internal_node * create_internal() {
+		internal_allocator alloc(alloc_);
+		internal_node * created = internal_traits::allocate(alloc, 1);
+		::new (static_cast<void*>(created)) internal_node;
+		created->parent = nullptr;
+		created->position = 0;
+		created->count = 0;
+		created->leaf = false;
+		return created;
+	}
+
+	void free_node(leaf_node * node) {
+		if (node->leaf) {
+			leaf_traits::deallocate(alloc_, node, 1);
+		}
+		else {
+			internal_allocator alloc(alloc_);
+			internal_traits::deallocate(alloc, static_cast<internal_node*>(node), 1);
+		}
+	}
+
+	/*
+	* Frees a subtree. The recursion depth is the tree height, log_B(n).
+	*/
+	void destroy(leaf_node * node) {
+		for (std::size_t i = 0; i < node->count; i++)
+			node->value(i)->~T();
+		if (!node->leaf)
+			for (std::size_t i = 0; i <= node->count; i++)
+				destroy(child(node, i));
+		free_node(node);
+	}
+
+	/*
+	* Rebuilds other's tree in this empty set, moving its values out when
+	* Move is set.
+	*/
+	template <bool Move = false>
+	void clone_from(btree_set const &other) {
+		if (other.root_ == nullptr)
+			return;
+		root_ = clone<Move>(other.root_, nullptr);
+		size_ = other.size_;
+		leftmost_ = root_;
+		while (!leftmost_->leaf)
+			leftmost_ = child(leftmost_, 0);
+		rightmost_ = root_;
+		while (!rightmost_->leaf)
+			rightmost_ = child(rightmost_, rightmost_->count);
+	}
+
+	/*
+	* Takes other's comparator and nodes; the allocators must compare equal.
+	*/
+	void take_nodes(btree_set &other) {
+		root_ = other.root_;
+		leftmost_ = other.leftmost_;
+		rightmost_ = other.rightmost_;
+		size_ = other.size_;
+		comp_ = std::move(other.comp_);
+		other.root_ = other.leftmost_ = other.rightmost_ = nullptr;
+		other.size_ = 0;
+	}
+
+	template <bool Move = false>
+	leaf_node * clone(leaf_node * src, internal_node * parent) {
+		leaf_node * copy = src->leaf ? create_leaf() : create_internal();
+		copy->parent = parent;
+		copy->position = src->position;
+		try {
+			for (; copy->count < src->count; copy->count++) {
+				if constexpr (Move)
+					::new (static_cast<void*>(copy->value(copy->count))) T(std::move(*src->value(copy->count)));
+				else
+					::new (static_cast<void*>(copy->value(copy->count))) T(*src->value(copy->count));
+			}
+			if (!src->leaf) {
+				std::size_t i = 0;
+				try {
+					for (; i <= src->count; i++)
+						child(copy, i) = clone<Move>(child(src, i), static_cast<internal_node*>(copy));
+				}
+				catch (...) {
+					for (std::size_t j = 0; j < i; j++)
+						destroy(child(copy, j));
+					throw;
+				}
+			}
+		}
+		catch (...) {
+			for (std::size_t j = 0; j < copy->count; j++)
+				copy->value(j)->~T();
+			free_node(copy);
+			throw;
+		}
+		return copy;
+	}
+
+	static void move_value(leaf_node * dst, std::size_t di, leaf_node * src, std::size_t si) {
+		::new (static_cast<void*>(dst->value(di))) T(std::move(*src->value(si)));
+		src->value(si)->~T();
+	}
+
+	static void set_child(leaf_node * node, std::size_t i, leaf_node * c) {
+		child(node, i) = c;
+		c->parent = static_cast<internal_node*>(node);
+		c->position = static_cast<std::uint16_t>(i);
+	}
+
+	/*
+	* Opens a hole at slot i by moving [i, count) one slot to the right.
+	*/
+	static void shift_right(leaf_node * node, std::size_t i) {
+		for (std::size_t k = node->count; k > i; k--)
+			move_value(node, k, node, k - 1);
+	}
+
+	static void erase_value(leaf_node * node, std::size_t i) {
+		node->value(i)->~T();
+		for (std::size_t k = i; k + 1 < node->count; k++)
+			move_value(node, k, node, k + 1);
+		node->count--;
+	}
+
+	template <typename K, typename... Args>
+	std::pair<iterator, bool> insert_unique(K const &key, Args&&... args) {
+		if (root_ == nullptr) {
+			root_ = leftmost_ = rightmost_ = create_leaf();
+		}
+		leaf_node * cur = root_;
+		std::size_t i;
+		while (true) {
+			i = lower_slot(cur, key);
+			if (i < cur->count && !less(key, *cur->value(i)))
+				return { iterator(cur, i), false };
+			if (cur->leaf)
+				break;
+			cur = child(cur, i);
+		}
+		if (cur->count == node_slots) {
+			std::size_t mid = split(cur);
+			if (i > mid) {
+				i -= mid + 1;
+				cur = child(cur->parent, cur->position + 1);
+			}
+		}
+		shift_right(cur, i);
+		try {
+			::new (static_cast<void*>(cur->value(i))) T(std::forward<Args>(args)...);
+		}
+		catch (...) {
+			for (std::size_t k = i; k < cur->count; k++)
+				move_value(cur, k, cur, k + 1);
+			if (size_ == 0)
+				clear();
+			throw;
+		}
+		cur->count++;
+		size_++;
+		return { iterator(cur, i), true };
+	}
+
+	/*
+	* Splits the full node in two around its middle value, which moves up into
+	* the parent (splitting that first if needed). Returns the middle slot.
+	*/
+	std::size_t split(leaf_node * node) {
+		if (node->parent != nullptr && node->parent->count == node_slots)
+			split(node->parent);
+		if (node->parent == nullptr) {
+			internal_node * new_root = create_internal();
+			set_child(new_root, 0, node);
+			root_ = new_root;
+		}
+		leaf_node * parent = node->parent;
+		leaf_node * sibling = node->leaf ? create_leaf() : create_internal();
+		std::size_t mid = node->count / 2;
+		std::size_t pos = node->position;
+
+		for (std::size_t k = mid + 1; k < node->count; k++)
+			move_value(sibling, k - mid - 1, node, k);
+		sibling->count = static_cast<std::uint16_t>(node->count - mid - 1);
+		if (!node->leaf)
+			for (std::size_t k = mid + 1; k <= node->count; k++)
+				set_child(sibling, k - mid - 1, child(node, k));
+
+		shift_right(parent, pos);
+		for (std::size_t k = parent->count; k > pos; k--)
+			set_child(parent, k + 1, child(parent, k));
+		move_value(parent, pos, node, mid);
+		set_child(parent, pos + 1, sibling);
+		parent->count++;
+		node->count = static_cast<std::uint16_t>(mid);
+
+		if (node == rightmost_)
+			rightmost_ = sibling;
+		return mid;
+	}
+
+	/*
+	* Moves `it` along with the value it refers to when that value changes node.
+	*/
+	static void track(iterator &it, leaf_node * from, std::size_t from_pos, leaf_node * to, std::size_t to_pos) {
+		if (it.node_ == from && it.pos_ == from_pos) {
+			it.node_ = to;
+			it.pos_ = to_pos;
+		}
+	}
+
+	void rebalance_after_erase(leaf_node * node, iterator &next) {
+		while (true) {
+			if (node == root_) {
+				if (node->count == 0) {
+					if (node->leaf) {
+						free_node(node);
+						root_ = leftmost_ = rightmost_ = nullptr;
+					}
+					else {
+						root_ = child(node, 0);
+						root_->parent = nullptr;
+						root_->position = 0;
+						free_node(node);
+					}
+				}
+				return;
+			}
+			if (node->count >= min_slots)
+				return;
+
+			leaf_node * parent = node->parent;
+			std::size_t j = node->position;
+			leaf_node * left = j > 0 ? child(parent, j - 1) : nullptr;
+			leaf_node * right = j < parent->count ? child(parent, j + 1) : nullptr;
+
+			if (left != nullptr && left->count > min_slots) {
+				borrow_from_left(node, left, parent, j, next);
+				return;
+			}
+			if (right != nullptr && right->count > min_slots) {
+				borrow_from_right(node, right, parent, j, next);
+				return;
+			}
+			if (left != nullptr)
+				merge_into(left, node, parent, j - 1, next);
+			else
+				merge_into(node, right, parent, j, next);
+			node = parent;
+		}
+	}
+
+	void borrow_from_left(leaf_node * node, leaf_node * left, leaf_node * parent, std::size_t j, iterator &next) {
+		if (next.node_ == node)
+			next.pos_++;
+		shift_right(node, 0);
+		if (!node->leaf)
+			for (std::size_t k = node->count + 1; k > 0; k--)
+				set_child(node, k, child(node, k - 1));
+		move_value(node, 0, parent, j - 1);
+		track(next, parent, j - 1, node, 0);
+		move_value(parent, j - 1, left, left->count - 1);
+		track(next, left, left->count - 1, parent, j - 1);
+		if (!node->leaf)
+			set_child(node, 0, child(left, left->count));
+		left->count--;
+		node->count++;
+	}
+
+	void borrow_from_right(leaf_node * node, leaf_node * right, leaf_node * parent, std::size_t j, iterator &next) {
+		move_value(node, node->count, parent, j);
+		track(next, parent, j, node, node->count);
+		move_value(parent, j, right, 0);
+		track(next, right, 0, parent, j);
+		if (!node->leaf)
+			set_child(node, node->count + 1, child(right, 0));
+		for (std::size_t k = 1; k < right->count; k++)
+			move_value(right, k - 1, right, k);
+		if (!right->leaf)
+			for (std::size_t k = 1; k <= right->count; k++)
+				set_child(right, k - 1, child(right, k));
+		if (next.node_ == right)
+			next.pos_--;
+		right->count--;
+		node->count++;
+	}
+
+	/*
+	* Appends the separator at parent slot j and all of right to left, then frees right.
+	*/
+	void merge_into(leaf_node * left, leaf_node * right, leaf_node * parent, std::size_t j, iterator &next) {
+		std::size_t base = left->count;
+		move_value(left, base, parent, j);
+		track(next, parent, j, left, base);
+		for (std::size_t k = 0; k < right->count; k++)
+			move_value(left, base + 1 + k, right, k);
+		if (!left->leaf)
+			for (std::size_t k = 0; k <= right->count; k++)
+				set_child(left, base + 1 + k, child(right, k));
+		if (next.node_ == right) {
+			next.node_ = left;
+			next.pos_ += base + 1;
+		}
+		left->count = static_cast<std::uint16_t>(base + 1 + right->count);
+
+		for (std::size_t k = j + 1; k < parent->count; k++)
+			move_value(parent, k - 1, parent, k);
+		for (std::size_t k = j + 2; k <= parent->count; k++)
+			set_child(parent, k - 1, child(parent, k));
+		if (next.node_ == parent && next.pos_ > j)
+			next.pos_--;
+		parent->count--;
+
+		if (right == rightmost_)
+			rightmost_ = left;
+		free_node(right);
+	}
+};
+
+template <typename T, typename Compare, typename Alloc>
+void swap(btree_set<T, Compare, Alloc> &lhs, btree_set<T, Compare, Alloc> &rhs) noexcept {
+	lhs.swap(rhs);
+}
+
+#endif // BTREE_SET_H
@@ -0,0 +1,655 @@
+#ifndef CONCURRENT_SET_H
+#define CONCURRENT_SET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <cassert>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "set.h"
+
+namespace myset_detail {
+
+	/*
+	* Epoch-based reclamation shared by all concurrent containers in the process.
+	*
+	* A thread pins itself before touching shared nodes by publishing the global
+	* epoch it saw. Unlinked nodes are retired into a per-thread list tagged with
+	* the epoch current at the time; the global epoch only advances once every
+	* pinned thread has seen it, so a node retired in epoch e can be freed once
+	* the global epoch reaches e + 2 - no thread can still hold a pointer to it.
+	*/
+	class epoch_domain {
+	public:
+		struct retired {
+			void * ptr;
+			void (*deleter)(void *);
+		};
+
+		struct record {
+			std::atomic<std::uint64_t> state{ 0 }; // (epoch << 1) | pinned
+			std::atomic<bool> owned{ false };
+			record * next = nullptr;
+
+			// Touched only by the owning thread.
+			std::vector<retired> limbo[3];
+			std::uint64_t limbo_epoch[3] = { 0, 0, 0 };
+			unsigned pin_depth = 0;
+			unsigned retire_count = 0;
+		};
+
+		epoch_domain() = default;
+		epoch_domain(epoch_domain const&) = delete;
+		epoch_domain& operator=(epoch_domain const&) = delete;
+
+		/*
+		* Only runs at process exit, after every thread-local participant is gone.
+		*/
+		~epoch_domain() {
+			record * cur = records_.load(std::memory_order_acquire);
+			while (cur != nullptr) {
+				record * next = cur->next;
+				for (auto &bucket : cur->limbo)
+					free_all(bucket);
+				delete cur;
+				cur = next;
+			}
+			for (auto &orphan : orphans_)
+				orphan.second.deleter(orphan.second.ptr);
+		}
+
+		record * acquire() {
+			for (record * cur = records_.load(std::memory_order_acquire); cur != nullptr; cur = cur->next) {
+				bool expected = false;
+				if (!cur->owned.load(std::memory_order_relaxed)
+					&& cur->owned.compare_exchange_strong(expected, true, std::memory_order_acquire))
+					return cur;
+			}
+			record * created = new record;
+			created->owned.store(true, std::memory_order_relaxed);
+			record * head = records_.load(std::memory_order_relaxed);
+			do {
+				created->next = head;
+			} while (!records_.compare_exchange_weak(head, created, std::memory_order_release, std::memory_order_relaxed));
+			return created;
+		}
+
+		/*
+		* Hands a thread's record back; its pending garbage becomes an orphan
+		* that later advances free.
+		*/
+		void release(record * rec) {
+			{
+				std::lock_guard<std::mutex> lock(orphans_mutex_);
+				for (int b = 0; b < 3; b++) {
+					for (retired const &r : rec->limbo[b])
+						orphans_.emplace_back(rec->limbo_epoch[b], r);
+					rec->limbo[b].clear();
+				}
+			}
+			rec->state.store(0, std::memory_order_release);
+			rec->owned.store(false, std::memory_order_release);
+		}
+
+		void pin(record * rec) {
+			if (rec->pin_depth++ == 0) {
+				std::uint64_t e = epoch_.load(std::memory_order_acquire);
+				rec->state.store((e << 1) | 1, std::memory_order_seq_cst);
+			}
+		}
+
+		void unpin(record * rec) {
+			if (--rec->pin_depth == 0)
+				rec->state.store(0, std::memory_order_release);
+		}
+
+		void retire(record * rec, void * ptr, void (*deleter)(void *)) {
+			std::uint64_t e = epoch_.load(std::memory_order_acquire);
+			collect(rec, e);
+			unsigned b = static_cast<unsigned>(e % 3);
+			rec->limbo_epoch[b] = e;
+			rec->limbo[b].push_back({ ptr, deleter });
+			if (++rec->retire_count % 64 == 0 && try_advance())
+				collect(rec, epoch_.load(std::memory_order_acquire));
+		}
+
+		/*
+		* Moves the global epoch forward if every pinned thread has caught up.
+		*/
+		bool try_advance() {
+			std::uint64_t e = epoch_.load(std::memory_order_seq_cst);
+			for (record * cur = records_.load(std::memory_order_acquire); cur != nullptr; cur = cur->next) {
+				std::uint64_t s = cur->state.load(std::memory_order_seq_cst);
+				if ((s & 1) && (s >> 1) != e)
+					return false;
+			}
+			if (!epoch_.compare_exchange_strong(e, e + 1, std::memory_order_seq_cst))
+				return false;
+			collect_orphans(e + 1);
+			return true;
+		}
+
+		std::uint64_t epoch() const {
+			return epoch_.load(std::memory_order_acquire);
+		}
+
+	private:
+		static void free_all(std::vector<retired> &bucket) {
+			for (retired const &r : bucket)
+				r.deleter(r.ptr);
+			bucket.clear();
+		}
+
+		static void collect(record * rec, std::uint64_t e) {
+			for (int b = 0; b < 3; b++)
+				if (!rec->limbo[b].empty() && rec->limbo_epoch[b] + 2 <= e)
+					free_all(rec->limbo[b]);
+		}
+
+		void collect_orphans(std::uint64_t e) {
+			std::unique_lock<std::mutex> lock(orphans_mutex_, std::try_to_lock);
+			if (!lock.owns_lock() || orphans_.empty())
+				return;
+			std::size_t kept = 0;
+			for (std::size_t i = 0; i < orphans_.size(); i++) {
+				if (orphans_[i].first + 2 <= e)
+					orphans_[i].second.deleter(orphans_[i].second.ptr);
+				else
+					orphans_[kept++] = orphans_[i];
+			}
+			orphans_.resize(kept);
+		}
+
+		std::atomic<std::uint64_t> epoch_{ 0 };
+		std::atomic<record*> records_{ nullptr };
+		std::mutex orphans_mutex_;
+		std::vector<std::pair<std::uint64_t, retired>> orphans_;
+	};
+
+	inline epoch_domain & default_epoch_domain() {
+		static epoch_domain domain;
+		return domain;
+	}
+
+	/*
+	* This thread's record in the default domain, handed back on thread exit.
+	*/
+	class epoch_participant {
+	public:
+		epoch_participant()
+			: domain_(default_epoch_domain()), record_(domain_.acquire())
+		{}
+
+		~epoch_participant() {
+			domain_.release(record_);
+		}
+
+		epoch_participant(epoch_participant const&) = delete;
+		epoch_participant& operator=(epoch_participant const&) = delete;
+
+		static epoch_participant & local() {
+			thread_local epoch_participant participant;
+			return participant;
+		}
+
+		void pin() { domain_.pin(record_); }
+		void unpin() { domain_.unpin(record_); }
+
+		void retire(void * ptr, void (*deleter)(void *)) {
+			domain_.retire(record_, ptr, deleter);
+		}
+
+	private:
+		epoch_domain & domain_;
+		epoch_domain::record * record_;
+	};
+
+	/*
+	* Keeps the calling thread pinned for its lifetime; guards nest.
+	*/
+	class epoch_guard {
+	public:
+		epoch_guard() : participant_(epoch_participant::local()) {
+			participant_.pin();
+		}
+
+		~epoch_guard() {
+			participant_.unpin();
+		}
+
+		epoch_guard(epoch_guard const&) = delete;
+		epoch_guard& operator=(epoch_guard const&) = delete;
+
+	private:
+		epoch_participant & participant_;
+	};
+
+	/*
+	* Test-and-test-and-set lock that yields when contended, so it behaves on
+	* machines with fewer cores than threads.
+	*/
+	class spin_lock {
+	public:
+		void lock() noexcept {
+			for (unsigned spins = 0; ; spins++) {
+				if (!locked_.load(std::memory_order_relaxed) && !locked_.exchange(true, std::memory_order_acquire))
+					return;
+				if (spins >= 16)
+					std::this_thread::yield();
+			}
+		}
+
+		void unlock() noexcept {
+			locked_.store(false, std::memory_order_release);
+		}
+
+	private:
+		std::atomic<bool> locked_{ false };
+	};
+
+} // namespace myset_detail
+
+/*
+* Ordered set for many concurrent readers and a few writers: a lazy skip list
+* (Herlihy, Lev, Luchangco, Shavit). Readers take no locks and never retry,
+* so contains/find/lower_bound are wait-free apart from pinning the epoch.
+* Writers lock only the predecessors of the node they link or unlink, after
+* an optimistic unlocked search, and retry if validation fails. Unlinked
+* nodes are freed through epoch-based reclamation once no reader can still
+* be looking at them.
+*
+* Lookups return copies, since a reference could outlive the element.
+* The destructor, unlike every other member, must not race with other calls.
+*/
+template <typename T, typename Compare = std::less<T>>
+struct concurrent_set : private myset_detail::ebo_holder<Compare, 0> {
+
+private:
+
+	static constexpr int max_level = 20;
+
+	using compare_base = myset_detail::ebo_holder<Compare, 0>;
+
+	struct node {
+		std::atomic<node*> * next;
+		int top_level;
+		std::atomic<bool> marked;
+		std::atomic<bool> fully_linked;
+		myset_detail::spin_lock lock;
+	};
+
+	struct value_node : node {
+		T value;
+	};
+
+	node head_;
+	std::atomic<node*> head_next_[max_level];
+	std::atomic<std::size_t> size_;
+
+public:
+
+	using key_type = T;
+	using value_type = T;
+	using size_type = std::size_t;
+	using key_compare = Compare;
+	using value_compare = Compare;
+
+	concurrent_set()
+		: concurrent_set(Compare())
+	{}
+
+	explicit concurrent_set(Compare const &comp)
+		: compare_base(comp), size_(0)
+	{
+		head_.next = head_next_;
+		head_.top_level = max_level - 1;
+		head_.marked.store(false, std::memory_order_relaxed);
+		head_.fully_linked.store(true, std::memory_order_relaxed);
+		for (auto &next : head_next_)
+			next.store(nullptr, std::memory_order_relaxed);
+	}
+
+	concurrent_set(concurrent_set const&) = delete;
+	concurrent_set& operator=(concurrent_set const&) = delete;
+
+	~concurrent_set() {
+		node * cur = head_next_[0].load(std::memory_order_acquire);
+		while (cur != nullptr) {
+			node * next = cur->next[0].load(std::memory_order_relaxed);
+			destroy_node(cur);
+			cur = next;
+		}
+	}
+
+	key_compare key_comp() const {
+		return compare_base::get();
+	}
+
+	/*
+	* === === === === === === === === === === === === === === ===
+	*                         R E A D E R S
+	* === === === === === === === === === === === === === === ===
+	*/
+
+	bool contains(T const &value) const {
+		myset_detail::epoch_guard guard;
+		node * found = find_node(value);
+		return found != nullptr && found->fully_linked.load(std::memory_order_acquire)
+			&& !found->marked.load(std::memory_order_acquire);
+	}
+
+	std::optional<T> find(T const &value) const {
+		myset_detail::epoch_guard guard;
+		node * found = find_node(value);
+		if (found == nullptr || !found->fully_linked.load(std::memory_order_acquire)
+			|| found->marked.load(std::memory_order_acquire))
+			return std::nullopt;
+		return value_of(found);
+	}
+
+	/*
+	* The smallest element not less than value that was present at some
+	* point during the call.
+	*/
+	std::optional<T> lower_bound(T const &value) const {
+		return bound(value, true);
+	}
+
+	std::optional<T> upper_bound(T const &value) const {
+		return bound(value, false);
+	}
+
+	template <typename K, typename C = Compare, typename = typename C::is_transparent>
+	bool contains(K const &key) const {
+		myset_detail::epoch_guard guard;
+		node * found = find_node(key);
+		return found != nullptr && found->fully_linked.load(std::memory_order_acquire)
+			&& !found->marked.load(std::memory_order_acquire);
+	}
+
+	/*
+	* Calls f on the elements in order. Concurrent updates may or may not be
+	* seen, but every element present for the whole walk is visited once.
+	*/
+	template <typename F>
+	void for_each(F &&f) const {
+		myset_detail::epoch_guard guard;
+		for (node * cur = head_next_[0].load(std::memory_order_acquire); cur != nullptr;
+			cur = cur->next[0].load(std::memory_order_acquire))
+			if (cur->fully_linked.load(std::memory_order_acquire) && !cur->marked.load(std::memory_order_acquire))
+				f(value_of(cur));
+	}
+
+	/*
+	* Copies a weakly consistent snapshot into a set<T>, O(n).
+	*/
+	set<T, Compare> to_set() const {
+		std::vector<T> values;
+		for_each([&values](T const &value) { values.push_back(value); });
+		return set<T, Compare>(assume_sorted_unique, values.begin(), values.end(), key_comp());
+	}
+
+	/*
+	* Element count; exact when no update is in flight.
+	*/
+	size_type size() const {
+		return size_.load(std::memory_order_relaxed);
+	}
+
+	bool empty() const {
+		return size() == 0;
+	}
+
+	/*
+	* === === === === === === === === === === === === === === ===
+	*                         W R I T E R S
+	* === === === === === === === === === === === === === === ===
+	*/
+
+	bool insert(T const &value) {
+		return insert_impl(value, value);
+	}
+
+	bool insert(T &&value) {
+		return insert_impl(value, std::move(value));
+	}
+
+	bool erase(T const &value) {
+		myset_detail::epoch_guard guard;
+		node * preds[max_level];
+		node * succs[max_level];
+		node * victim = nullptr;
+		bool is_marked = false;
+		int top_level = -1;
+		while (true) {
+			int found = find_path(value, preds, succs);
+			if (found != -1)
+				victim = succs[found];
+			if (!is_marked && (found == -1 || !victim->fully_linked.load(std::memory_order_acquire)
+				|| victim->top_level != found || victim->marked.load(std::memory_order_acquire)))
+				return false;
+			if (!is_marked) {
+				top_level = victim->top_level;
+				victim->lock.lock();
+				if (victim->marked.load(std::memory_order_relaxed)) {
+					victim->lock.unlock();
+					return false;
+				}
+				victim->marked.store(true, std::memory_order_release);
+				is_marked = true;
+			}
+
+			int highest_locked = -1;
+			bool valid = true;
+			for (int level = 0; valid && level <= top_level; level++) {
+				node * pred = preds[level];
+				if (level == 0 || pred != preds[level - 1]) {
+					pred->lock.lock();
+					highest_locked = level;
+				}
+				valid = !pred->marked.load(std::memory_order_acquire)
+					&& pred->next[level].load(std::memory_order_acquire) == victim;
+			}
+			if (!valid) {
+				unlock_preds(preds, highest_locked);
+				continue;
+			}
+			for (int level = top_level; level >= 0; level--)
+				preds[level]->next[level].store(victim->next[level].load(std::memory_order_relaxed), std::memory_order_release);
+			victim->lock.unlock();
+			unlock_preds(preds, highest_locked);
+			size_.fetch_sub(1, std::memory_order_relaxed);
+			myset_detail::epoch_participant::local().retire(victim, &destroy_node_erased);
+			return true;
+		}
+	}
+
+private:
+	/*
+	* === === === === === === === === === === === === === === ===
+	*                L O C A L  O P E R A T I O N S
+	* === === === === === === === === === === === === === === ===
+	*/
+
+	template <typename L, typename R>
+	bool less(L const &lhs, R const &rhs) const {
+		return compare_base::get()(lhs, rhs);
+	}
+
+	static T const & value_of(node * n) {
+		return static_cast<value_node*>(n)->value;
+	}
+
+	static int random_level() {
+		thread_local std::uint64_t state = 0x9E3779B97F4A7C15ull
+			^ static_cast<std::uint64_t>(std::hash<std::thread::id>()(std::this_thread::get_id()));
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		// Each level is kept with probability 1/4.
+		int level = 0;
+		for (std::uint64_t bits = state; (bits & 3) == 0 && level < max_level - 1; bits >>= 2)
+			++level;
+		return level;
+	}
+
+	template <typename... Args>
+	static node * create_node(int top_level, Args&&... args) {
+		std::size_t bytes = sizeof(value_node) + (top_level + 1) * sizeof(std::atomic<node*>);
+		void * raw = ::operator new(bytes, std::align_val_t(alignof(value_node)));
+		value_node * created;
+		try {
+			created = ::new (raw) value_node{ {}, T(std::forward<Args>(args)...) };
+		}
+		catch (...) {
+			::operator delete(raw, std::align_val_t(alignof(value_node)));
+			throw;
+		}
+		created->next = reinterpret_cast<std::atomic<node*>*>(reinterpret_cast<char*>(raw) + sizeof(value_node));
+		for (int level = 0; level <= top_level; level++)
+			::new (static_cast<void*>(created->next + level)) std::atomic<node*>(nullptr);
+		created->top_level = top_level;
+		created->marked.store(false, std::memory_order_relaxed);
+		created->fully_linked.store(false, std::memory_order_relaxed);
+		return created;
+	}
+
+	static void destroy_node(node * n) {
+		value_node * v = static_cast<value_node*>(n);
+		v->~value_node();
+		::operator delete(static_cast<void*>(v), std::align_val_t(alignof(value_node)));
+	}
+
+	static void destroy_node_erased(void * n) {
+		destroy_node(static_cast<node*>(n));
+	}
+
+	/*
+	* Unlocked search: the first node not less than key, or nullptr.
+	*/
+	template <typename K>
+	node * lower_bound_node(K const &key) const {
+		node * pred = const_cast<node*>(&head_);
+		node * cur = nullptr;
+		for (int level = max_level - 1; level >= 0; level--) {
+			cur = pred->next[level].load(std::memory_order_acquire);
+			while (cur != nullptr && less(value_of(cur), key)) {
+				pred = cur;
+				cur = pred->next[level].load(std::memory_order_acquire);
+			}
+		}
+		return cur;
+	}
+
+	template <typename K>
+	node * find_node(K const &key) const {
+		node * cur = lower_bound_node(key);
+		if (cur == nullptr || less(key, value_of(cur)))
+			return nullptr;
+		return cur;
+	}
+
+	std::optional<T> bound(T const &value, bool inclusive) const {
+		myset_detail::epoch_guard guard;
+		node * cur = lower_bound_node(value);
+		while (cur != nullptr && ((!inclusive && !less(value, value_of(cur)))
+			|| !cur->fully_linked.load(std::memory_order_acquire) || cur->marked.load(std::memory_order_acquire)))
+			cur = cur->next[0].load(std::memory_order_acquire);
+		if (cur == nullptr)
+			return std::nullopt;
+		return value_of(cur);
+	}
+
+	/*
+	* Fills in the predecessor and successor of key on every level and returns
+	* the highest level on which a node equal to key was seen, or -1.
+	*/
+	template <typename K>
+	int find_path(K const &key, node ** preds, node ** succs) const {
+		int found = -1;
+		node * pred = const_cast<node*>(&head_);
+		for (int level = max_level - 1; level >= 0; level--) {
+			node * cur = pred->next[level].load(std::memory_order_acquire);
+			while (cur != nullptr && less(value_of(cur), key)) {
+				pred = cur;
+				cur = pred->next[level].load(std::memory_order_acquire);
+			}
+			if (found == -1 && cur != nullptr && !less(key, value_of(cur)))
+				found = level;
+			preds[level] = pred;
+			succs[level] = cur;
+		}
+		return found;
+	}
+
+	static void unlock_preds(node ** preds, int highest_locked) {
+		for (int level = 0; level <= highest_locked; level++)
+			if (level == 0 || preds[level] != preds[level - 1])
+				preds[level]->lock.unlock();
+	}
+
+	template <typename K, typename... Args>
+	bool insert_impl(K const &key, Args&&... args) {
+		myset_detail::epoch_guard guard;
+		int top_level = random_level();
+		node * preds[max_level];
+		node * succs[max_level];
+		while (true) {
+			int found = find_path(key, preds, succs);
+			if (found != -1) {
+				node * existing = succs[found];
+				if (!existing->marked.load(std::memory_order_acquire)) {
+					while (!existing->fully_linked.load(std::memory_order_acquire))
+						std::this_thread::yield();
+					return false;
+				}
+				// Being erased; wait for it to be unlinked and look again.
+				continue;
+			}
+
+			int highest_locked = -1;
+			bool valid = true;
+			for (int level = 0; valid && level <= top_level; level++) {
+				node * pred = preds[level];
+				node * succ = succs[level];
+				if (level == 0 || pred != preds[level - 1]) {
+					pred->lock.lock();
+					highest_locked = level;
+				}
+				valid = !pred->marked.load(std::memory_order_acquire)
+					&& (succ == nullptr || !succ->marked.load(std::memory_order_acquire))
+					&& pred->next[level].load(std::memory_order_acquire) == succ;
+			}
+			if (!valid) {
+				unlock_preds(preds, highest_locked);
+				continue;
+			}
+
+			node * created;
+			try {
+				created = create_node(top_level, std::forward<Args>(args)...);
+			}
+			catch (...) {
+				unlock_preds(preds, highest_locked);
+				throw;
+			}
+			for (int level = 0; level <= top_level; level++)
+				created->next[level].store(succs[level], std::memory_order_relaxed);
+			for (int level = 0; level <= top_level; level++)
+				preds[level]->next[level].store(created, std::memory_order_release);
+			created->fully_linked.store(true, std::memory_order_release);
+			unlock_preds(preds, highest_locked);
+			size_.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+};
+
+#endif // CONCURRENT_SET_H
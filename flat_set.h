@@ -0,0 +1,362 @@
+#ifndef FLAT_SET_H
+#define FLAT_SET_H
+
+#include <cstddef>
+#include <memory>
+#include <cassert>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "set.h"
+
+/*
+* Sorted contiguous array with the lookup and iteration surface of set<T>,
+* for sets that are built once and then read far more often than written.
+* Lookups are a branch-free binary search; single inserts and erases shift
+* the tail, so updates should be batched through the range insert, which
+* sorts the batch and merges it in linear time.
+*
+* Any insert or erase invalidates iterators and references.
+*/
+template <typename T, typename Compare = std::less<T>, typename Alloc = std::allocator<T>>
+struct flat_set : private myset_detail::ebo_holder<Compare, 0> {
+
+private:
+
+	using compare_base = myset_detail::ebo_holder<Compare, 0>;
+	using storage = std::vector<T, Alloc>;
+
+	storage data_;
+
+public:
+
+	using key_type = T;
+	using value_type = T;
+	using size_type = std::size_t;
+	using key_compare = Compare;
+	using value_compare = Compare;
+	using allocator_type = Alloc;
+	using iterator = typename storage::const_iterator;
+	using const_iterator = typename storage::const_iterator;
+	using reverse_iterator = std::reverse_iterator<iterator>;
+	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+	flat_set() = default;
+
+	explicit flat_set(Compare const &comp, Alloc const &alloc = Alloc())
+		: compare_base(comp), data_(alloc)
+	{}
+
+	template <typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+	flat_set(InputIt first, InputIt last, Compare const &comp = Compare(), Alloc const &alloc = Alloc())
+		: compare_base(comp), data_(alloc)
+	{
+		insert(first, last);
+	}
+
+	/*
+	* Takes [first, last) as is; it must already be sorted and free of duplicates.
+	*/
+	template <typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+	flat_set(assume_sorted_unique_t, InputIt first, InputIt last, Compare const &comp = Compare(), Alloc const &alloc = Alloc())
+		: compare_base(comp), data_(first, last, alloc)
+	{
+		assert(std::adjacent_find(data_.begin(), data_.end(), [this](T const &a, T const &b) { return !less(a, b); }) == data_.end());
+	}
+
+	/*
+	* Copies a set in one in-order walk, O(n).
+	*/
+	template <typename A, typename S>
+	explicit flat_set(set<T, Compare, A, S> const &other, Alloc const &alloc = Alloc())
+		: compare_base(other.key_comp()), data_(alloc)
+	{
+		data_.reserve(other.size());
+		data_.assign(other.begin(), other.end());
+	}
+
+	/*
+	* Builds a balanced set<T> from the sorted buffer in O(n).
+	*/
+	template <typename A = Alloc>
+	set<T, Compare, A> to_set(A const &alloc = A()) const & {
+		return set<T, Compare, A>(assume_sorted_unique, data_.begin(), data_.end(), key_comp(), alloc);
+	}
+
+	template <typename A = Alloc>
+	set<T, Compare, A> to_set(A const &alloc = A()) && {
+		set<T, Compare, A> result(assume_sorted_unique, std::make_move_iterator(data_.begin()),
+			std::make_move_iterator(data_.end()), key_comp(), alloc);
+		data_.clear();
+		return result;
+	}
+
+	void swap(flat_set &other) noexcept(std::is_nothrow_swappable<Compare>::value) {
+		using std::swap;
+		swap(compare_base::get(), other.compare_base::get());
+		data_.swap(other.data_);
+	}
+
+	allocator_type get_allocator() const {
+		return data_.get_allocator();
+	}
+
+	key_compare key_comp() const {
+		return compare_base::get();
+	}
+
+	value_compare value_comp() const {
+		return compare_base::get();
+	}
+
+	/*
+	* === === === === === === === === === === === === === === ===
+	*                      I T E R A T O R S
+	* === === === === === === === === === === === === === === ===
+	*/
+
+	iterator begin() const { return data_.cbegin(); }
+	iterator end() const { return data_.cend(); }
+	const_iterator cbegin() const { return data_.cbegin(); }
+	const_iterator cend() const { return data_.cend(); }
+	reverse_iterator rbegin() const { return reverse_iterator(end()); }
+	reverse_iterator rend() const { return reverse_iterator(begin()); }
+	const_reverse_iterator crbegin() const { return const_reverse_iterator(end()); }
+	const_reverse_iterator crend() const { return const_reverse_iterator(begin()); }
+
+	/*
+	* === === === === === === === === === === === === === === ===
+	*                 C O M M O N  M E T H O D S
+	* === === === === === === === === === === === === === === ===
+	*/
+
+	const_iterator find(T const &value) const {
+		return find_impl(value);
+	}
+
+	const_iterator lower_bound(T const &value) const {
+		return begin() + lower_index(value);
+	}
+
+	const_iterator upper_bound(T const &value) const {
+		return begin() + upper_index(value);
+	}
+
+	bool contains(T const &value) const {
+		return find_impl(value) != end();
+	}
+
+	size_type count(T const &value) const {
+		return contains(value) ? 1 : 0;
+	}
+
+	template <typename K, typename C = Compare, typename = typename C::is_transparent>
+	const_iterator find(K const &key) const {
+		return find_impl(key);
+	}
+
+	template <typename K, typename C = Compare, typename = typename C::is_transparent>
+	const_iterator lower_bound(K const &key) const {
+		return begin() + lower_index(key);
+	}
+
+	template <typename K, typename C = Compare, typename = typename C::is_transparent>
+	const_iterator upper_bound(K const &key) const {
+		return begin() + upper_index(key);
+	}
+
+	template <typename K, typename C = Compare, typename = typename C::is_transparent>
+	bool contains(K const &key) const {
+		return find_impl(key) != end();
+	}
+
+	template <typename K, typename C = Compare, typename = typename C::is_transparent>
+	size_type count(K const &key) const {
+		return contains(key) ? 1 : 0;
+	}
+
+	/*
+	* k-th smallest element, O(1).
+	*/
+	const_iterator nth(size_type k) const {
+		return k < size() ? begin() + k : end();
+	}
+
+	size_type rank(T const &value) const {
+		return lower_index(value);
+	}
+
+	bool empty() const {
+		return data_.empty();
+	}
+
+	size_type size() const {
+		return data_.size();
+	}
+
+	size_type capacity() const {
+		return data_.capacity();
+	}
+
+	void reserve(size_type n) {
+		data_.reserve(n);
+	}
+
+	void shrink_to_fit() {
+		data_.shrink_to_fit();
+	}
+
+	void clear() {
+		data_.clear();
+	}
+
+	std::pair<iterator, bool> insert(T const &value) {
+		return insert_unique(value, value);
+	}
+
+	std::pair<iterator, bool> insert(T &&value) {
+		return insert_unique(value, std::move(value));
+	}
+
+	template <typename... Args>
+	std::pair<iterator, bool> emplace(Args&&... args) {
+		T value(std::forward<Args>(args)...);
+		return insert_unique(value, std::move(value));
+	}
+
+	/*
+	* Appends the batch, sorts it and merges it with the existing elements,
+	* O(n + m log m). Equivalent elements already present are kept.
+	*/
+	template <typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+	void insert(InputIt first, InputIt last) {
+		size_type old_size = data_.size();
+		data_.insert(data_.end(), first, last);
+		auto mid = data_.begin() + old_size;
+		if (!std::is_sorted(mid, data_.end(), value_comp()))
+			std::stable_sort(mid, data_.end(), value_comp());
+		merge_tail(old_size);
+	}
+
+	/*
+	* Batched insert of a range already sorted and free of duplicates, O(n + m).
+	*/
+	template <typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+	void insert(assume_sorted_unique_t, InputIt first, InputIt last) {
+		size_type old_size = data_.size();
+		data_.insert(data_.end(), first, last);
+		merge_tail(old_size);
+	}
+
+	iterator erase(const_iterator pos) {
+		return data_.erase(pos);
+	}
+
+	iterator erase(const_iterator first, const_iterator last) {
+		return data_.erase(first, last);
+	}
+
+	size_type erase(T const &value) {
+		const_iterator it = find(value);
+		if (it == end())
+			return 0;
+		data_.erase(it);
+		return 1;
+	}
+
+	friend bool operator==(flat_set const &lhs, flat_set const &rhs) {
+		return lhs.data_ == rhs.data_;
+	}
+
+	friend bool operator!=(flat_set const &lhs, flat_set const &rhs) {
+		return !(lhs == rhs);
+	}
+
+private:
+	/*
+	* === === === === === === === === === === === === === === ===
+	*                L O C A L  O P E R A T I O N S
+	* === === === === === === === === === === === === === === ===
+	*/
+
+	template <typename L, typename R>
+	bool less(L const &lhs, R const &rhs) const {
+		return compare_base::get()(lhs, rhs);
+	}
+
+	/*
+	* Binary search without a data-dependent branch: the loop runs
+	* ceil(log2 n) times and the step compiles to a conditional move.
+	*/
+	template <typename K>
+	size_type lower_index(K const &key) const {
+		size_type n = data_.size();
+		if (n == 0)
+			return 0;
+		T const * base = data_.data();
+		while (n > 1) {
+			size_type half = n / 2;
+			base = less(base[half], key) ? base + half : base;
+			n -= half;
+		}
+		return static_cast<size_type>(base - data_.data()) + less(*base, key);
+	}
+
+	template <typename K>
+	size_type upper_index(K const &key) const {
+		size_type n = data_.size();
+		if (n == 0)
+			return 0;
+		T const * base = data_.data();
+		while (n > 1) {
+			size_type half = n / 2;
+			base = less(key, base[half]) ? base : base + half;
+			n -= half;
+		}
+		return static_cast<size_type>(base - data_.data()) + !less(key, *base);
+	}
+
+	template <typename K>
+	const_iterator find_impl(K const &key) const {
+		size_type i = lower_index(key);
+		if (i == data_.size() || less(key, data_[i]))
+			return end();
+		return begin() + i;
+	}
+
+	template <typename K, typename... Args>
+	std::pair<iterator, bool> insert_unique(K const &key, Args&&... args) {
+		size_type i = lower_index(key);
+		if (i < data_.size() && !less(key, data_[i]))
+			return { begin() + i, false };
+		data_.emplace(data_.begin() + i, std::forward<Args>(args)...);
+		return { begin() + i, true };
+	}
+
+	/*
+	* Merges the sorted tail starting at old_size into the sorted prefix and
+	* drops duplicates, keeping the first of each run (the older element).
+	*/
+	void merge_tail(size_type old_size) {
+		auto mid = data_.begin() + old_size;
+		if (mid == data_.end())
+			return;
+		// Elements before the first one not less than the batch's minimum stay put.
+		auto from = std::lower_bound(data_.begin(), mid, *mid, value_comp());
+		if (from != mid)
+			std::inplace_merge(from, mid, data_.end(), value_comp());
+		auto last = std::unique(from, data_.end(), [this](T const &a, T const &b) { return !less(a, b); });
+		data_.erase(last, data_.end());
+	}
+};
+
+template <typename T, typename Compare, typename Alloc>
+void swap(flat_set<T, Compare, Alloc> &lhs, flat_set<T, Compare, Alloc> &rhs) noexcept(noexcept(lhs.swap(rhs))) {
+	lhs.swap(rhs);
+}
+
+#endif // FLAT_SET_H
@@ -0,0 +1,598 @@
+#ifndef FROZEN_SET_H
+#define FROZEN_SET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <cassert>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "set.h"
+
+namespace myset_detail {
+
+	inline unsigned count_trailing_zeros(std::size_t x) {
+#if defined(__GNUC__)
+		return static_cast<unsigned>(__builtin_ctzll(x));
+#else
+		unsigned n = 0;
+		for (; (x & 1) == 0; x >>= 1)
+			++n;
+		return n;
+#endif
+	}
+
+	/*
+	* Whether rank_in_line() below can compare a whole cache line of keys at
+	* once: arithmetic keys ordered by the built-in operator<.
+	*/
+	template <typename T, typename Compare>
+	struct has_simd_rank : std::false_type {};
+
+#if defined(__SSE2__)
+
+	template <typename T>
+	struct is_builtin_less : std::false_type {};
+	template <typename T>
+	struct is_builtin_less<std::less<T>> : std::true_type {};
+	template <>
+	struct is_builtin_less<std::less<>> : std::true_type {};
+
+	template <typename C>
+	struct has_simd_rank<std::int32_t, C> : is_builtin_less<C> {};
+	template <typename C>
+	struct has_simd_rank<float, C> : is_builtin_less<C> {};
+	template <typename C>
+	struct has_simd_rank<double, C> : is_builtin_less<C> {};
+#if defined(__SSE4_2__)
+	template <typename C>
+	struct has_simd_rank<std::int64_t, C> : is_builtin_less<C> {};
+#endif
+
+	/*
+	* Number of keys in the 64-byte line that are less than key (Strict) or
+	* not greater than key (!Strict).
+	*/
+	template <bool Strict>
+	std::size_t rank_in_line(std::int32_t const * line, std::int32_t key) {
+		unsigned greater = 0, less = 0;
+#if defined(__AVX2__)
+		__m256i k = _mm256_set1_epi32(key);
+		for (int i = 0; i < 16; i += 8) {
+			__m256i v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(line + i));
+			if (Strict)
+				less += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(k, v))));
+			else
+				greater += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(v, k))));
+		}
+#else
+		__m128i k = _mm_set1_epi32(key);
+		for (int i = 0; i < 16; i += 4) {
+			__m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(line + i));
+			if (Strict)
+				less += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(v, k))));
+			else
+				greater += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(v, k))));
+		}
+#endif
+		return Strict ? less : 16 - greater;
+	}
+
+	template <bool Strict>
+	std::size_t rank_in_line(float const * line, float key) {
+		unsigned count = 0;
+#if defined(__AVX2__)
+		__m256 k = _mm256_set1_ps(key);
+		for (int i = 0; i < 16; i += 8) {
+			__m256 v = _mm256_loadu_ps(line + i);
+			count += __builtin_popcount(_mm256_movemask_ps(Strict ? _mm256_cmp_ps(v, k, _CMP_LT_OQ) : _mm256_cmp_ps(v, k, _CMP_LE_OQ)));
+		}
+#else
+		__m128 k = _mm_set1_ps(key);
+		for (int i = 0; i < 16; i += 4) {
+			__m128 v = _mm_loadu_ps(line + i);
+			count += __builtin_popcount(_mm_movemask_ps(Strict ? _mm_cmplt_ps(v, k) : _mm_cmple_ps(v, k)));
+		}
+#endif
+		return count;
+	}
+
+	template <bool Strict>
+	std::size_t rank_in_line(double const * line, double key) {
+		unsigned count = 0;
+#if defined(__AVX2__)
+		__m256d k = _mm256_set1_pd(key);
+		for (int i = 0; i < 8; i += 4) {
+			__m256d v = _mm256_loadu_pd(line + i);
+			count += __builtin_popcount(_mm256_movemask_pd(Strict ? _mm256_cmp_pd(v, k, _CMP_LT_OQ) : _mm256_cmp_pd(v, k, _CMP_LE_OQ)));
+		}
+#else
+		__m128d k = _mm_set1_pd(key);
+		for (int i = 0; i < 8; i += 2) {
+			__m128d v = _mm_loadu_pd(line + i);
+			count += __builtin_popcount(_mm_movemask_pd(Strict ? _mm_cmplt_pd(v, k) : _mm_cmple_pd(v, k)));
+		}
+#endif
+		return count;
+	}
+
+#if defined(__SSE4_2__)
+	template <bool Strict>
+	std::size_t rank_in_line(std::int64_t const * line, std::int64_t key) {
+		unsigned greater = 0, less = 0;
+#if defined(__AVX2__)
+		__m256i k = _mm256_set1_epi64x(key);
+		for (int i = 0; i < 8; i += 4) {
+			__m256i v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(line + i));
+			if (Strict)
+				less += __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(k, v))));
+			else
+				greater += __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(v, k))));
+		}
+#else
+		__m128i k = _mm_set1_epi64x(key);
+		for (int i = 0; i < 8; i += 2) {
+			__m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(line + i));
+			if (Strict)
+				less += __builtin_popcount(_mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(k, v))));
+			else
+				greater += __builtin_popcount(_mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(v, k))));
+		}
+#endif
+		return Strict ? less : 8 - greater;
+	}
+#endif
+
+#endif // __SSE2__
+
+} // namespace myset_detail
+
+/*
+* Immutable sorted set tuned for lookups, usually produced by set::freeze().
+*
+* Keys are cut into cache-line blocks that are laid out in Eytzinger (BFS)
+* order: block k has children 2k and 2k + 1, and an in-order walk of the
+* blocks visits the keys in sorted order. A search descends on the first
+* key of each block without branching on the comparison, prefetching the
+* grandchildren two levels ahead, then ranks the key inside the one block
+* it lands on, with SSE/AVX2 compares for arithmetic keys. Everything lives
+* in one 64-byte aligned allocation.
+*/
+template <typename T, typename Compare>
+struct frozen_set : private myset_detail::ebo_holder<Compare, 0> {
+
+public:
+
+	static constexpr std::size_t block_slots = sizeof(T) >= 64 ? 1 : 64 / sizeof(T);
+
+private:
+
+	static constexpr std::size_t block_align = alignof(T) > 64 ? alignof(T) : 64;
+
+	using compare_base = myset_detail::ebo_holder<Compare, 0>;
+
+	// Block k (1-based) starts at blocks_ + k * block_slots; block 0 is unused.
+	T * blocks_;
+	std::size_t size_;
+	std::size_t block_count_;
+	std::size_t last_block_;
+
+public:
+
+	using key_type = T;
+	using value_type = T;
+	using size_type = std::size_t;
+	using key_compare = Compare;
+	using value_compare = Compare;
+
+	frozen_set()
+		: blocks_(nullptr), size_(0), block_count_(0), last_block_(0)
+	{}
+
+	/*
+	* [first, last) must already be sorted and free of duplicates.
+	*/
+	template <typename ForwardIt, typename = typename std::iterator_traits<ForwardIt>::iterator_category>
+	frozen_set(assume_sorted_unique_t, ForwardIt first, ForwardIt last, Compare const &comp = Compare())
+		: frozen_set(first, static_cast<size_type>(std::distance(first, last)), comp)
+	{}
+
+private:
+
+	template <typename, typename, typename, typename>
+	friend struct set;
+
+	template <typename ForwardIt>
+	frozen_set(ForwardIt first, size_type n, Compare const &comp)
+		: compare_base(comp), blocks_(nullptr), size_(n), block_count_((n + block_slots - 1) / block_slots), last_block_(0)
+	{
+		if (n == 0)
+			return;
+		last_block_ = 1;
+		while (2 * last_block_ + 1 <= block_count_)
+			last_block_ = 2 * last_block_ + 1;
+		blocks_ = allocate_blocks(block_count_);
+
+		// Fill the blocks in order; the tail of the last one repeats the maximum.
+		std::size_t done = 0;
+		try {
+			for (std::size_t k = first_block(); k != 0; k = next_block(k), done++) {
+				T * block = blocks_ + k * block_slots;
+				std::size_t j = 0;
+				try {
+					for (; j < block_size(k); j++, ++first)
+						::new (static_cast<void*>(block + j)) T(*first);
+					for (; j < block_slots; j++)
+						::new (static_cast<void*>(block + j)) T(block[block_size(k) - 1]);
+				}
+				catch (...) {
+					while (j > 0)
+						block[--j].~T();
+					throw;
+				}
+			}
+		}
+		catch (...) {
+			for (std::size_t k = first_block(); done > 0; k = next_block(k), done--)
+				destroy_block(k);
+			deallocate_blocks(blocks_, block_count_);
+			throw;
+		}
+	}
+
+public:
+
+	frozen_set(frozen_set const &other)
+		: compare_base(other.key_comp()), blocks_(nullptr), size_(other.size_)
+		, block_count_(other.block_count_), last_block_(other.last_block_)
+	{
+		if (block_count_ == 0)
+			return;
+		blocks_ = allocate_blocks(block_count_);
+		std::size_t k = 1;
+		try {
+			for (; k <= block_count_; k++)
+				for (std::size_t j = 0; j < block_slots; j++) {
+					try {
+						::new (static_cast<void*>(blocks_ + k * block_slots + j)) T(other.blocks_[k * block_slots + j]);
+					}
+					catch (...) {
+						while (j > 0)
+							blocks_[k * block_slots + --j].~T();
+						throw;
+					}
+				}
+		}
+		catch (...) {
+			while (--k > 0)
+				destroy_block(k);
+			deallocate_blocks(blocks_, block_count_);
+			throw;
+		}
+	}
+
+	frozen_set(frozen_set &&other) noexcept
+		: compare_base(static_cast<compare_base&&>(other)), blocks_(other.blocks_), size_(other.size_)
+		, block_count_(other.block_count_), last_block_(other.last_block_)
+	{
+		other.blocks_ = nullptr;
+		other.size_ = other.block_count_ = other.last_block_ = 0;
+	}
+
+	frozen_set& operator=(frozen_set rhs) noexcept {
+		swap(rhs);
+		return *this;
+	}
+
+	~frozen_set() {
+		if (blocks_ == nullptr)
+			return;
+		for (std::size_t k = 1; k <= block_count_; k++)
+			destroy_block(k);
+		deallocate_blocks(blocks_, block_count_);
+	}
+
+	void swap(frozen_set &other) noexcept {
+		using std::swap;
+		swap(compare_base::get(), other.compare_base::get());
+		swap(blocks_, other.blocks_);
+		swap(size_, other.size_);
+		swap(block_count_, other.block_count_);
+		swap(last_block_, other.last_block_);
+	}
+
+	key_compare key_comp() const {
+		return compare_base::get();
+	}
+
+	value_compare value_comp() const {
+		return compare_base::get();
+	}
+
+	/*
+	* Builds a balanced set<T> with the same keys in O(n).
+	*/
+	template <typename Alloc = std::allocator<T>>
+	set<T, Compare, Alloc> thaw(Alloc const &alloc = Alloc()) const {
+		return set<T, Compare, Alloc>(assume_sorted_unique, begin(), end(), key_comp(), alloc);
+	}
+
+	/*
+	* === === === === === === === === === === === === === === ===
+	*                      I T E R A T O R S
+	* === === === === === === === === === === === === === === ===
+	*/
+
+	class const_iterator {
+	public:
+		friend struct frozen_set;
+
+		using difference_type = std::ptrdiff_t;
+		using value_type = T const;
+		using pointer = T const * ;
+		using reference = T const & ;
+		using iterator_category = std::bidirectional_iterator_tag;
+
+		const_iterator() : owner_(nullptr), block_(0), slot_(0)
+		{}
+
+		pointer operator->() const {
+			return owner_->blocks_ + block_ * block_slots + slot_;
+		}
+
+		reference operator*() const {
+			return *operator->();
+		}
+
+		const_iterator& operator++() {
+			if (++slot_ == owner_->block_size(block_)) {
+				block_ = owner_->next_block(block_);
+				slot_ = 0;
+			}
+			return *this;
+		}
+
+		const_iterator operator++(int) {
+			auto tmp(*this);
+			++(*this);
+			return tmp;
+		}
+
+		const_iterator& operator--() {
+			if (slot_ == 0) {
+				block_ = owner_->prev_block(block_);
+				slot_ = owner_->block_size(block_) - 1;
+			}
+			else {
+				--slot_;
+			}
+			return *this;
+		}
+
+		const_iterator operator--(int) {
+			auto tmp(*this);
+			--(*this);
+			return tmp;
+		}
+
+		friend bool operator==(const_iterator const &lhs, const_iterator const &rhs) {
+			return lhs.block_ == rhs.block_ && lhs.slot_ == rhs.slot_;
+		}
+		friend bool operator!=(const_iterator const &lhs, const_iterator const &rhs) {
+			return !(lhs == rhs);
+		}
+
+	private:
+		const_iterator(frozen_set const * owner, std::size_t block, std::size_t slot)
+			: owner_(owner), block_(block), slot_(slot)
+		{}
+
+		frozen_set const * owner_;
+		std::size_t block_;
+		std::size_t slot_;
+	};
+
+	using iterator = const_iterator;
+	using reverse_iterator = std::reverse_iterator<iterator>;
+	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+	iterator begin() const { return iterator(this, first_block(), 0); }
+	iterator end() const { return iterator(this, 0, 0); }
+	const_iterator cbegin() const { return begin(); }
+	const_iterator cend() const { return end(); }
+	reverse_iterator rbegin() const { return reverse_iterator(end()); }
+	reverse_iterator rend() const { return reverse_iterator(begin()); }
+
+	/*
+	* === === === === === === === === === === === === === === ===
+	*                 C O M M O N  M E T H O D S
+	* === === === === === === === === === === === === === === ===
+	*/
+
+	const_iterator find(T const &value) const {
+		return find_impl(value);
+	}
+
+	const_iterator lower_bound(T const &value) const {
+		return bound<true>(value);
+	}
+
+	const_iterator upper_bound(T const &value) const {
+		return bound<false>(value);
+	}
+
+	bool contains(T const &value) const {
+		return find_impl(value) != end();
+	}
+
+	size_type count(T const &value) const {
+		return contains(value) ? 1 : 0;
+	}
+
+	template <typename K, typename C = Compare, typename = typename C::is_transparent>
+	const_iterator find(K const &key) const {
+		return find_impl(key);
+	}
+
+	template <typename K, typename C = Compare, typename = typename C::is_transparent>
+	const_iterator lower_bound(K const &key) const {
+		return bound<true>(key);
+	}
+
+	template <typename K, typename C = Compare, typename = typename C::is_transparent>
+	const_iterator upper_bound(K const &key) const {
+		return bound<false>(key);
+	}
+
+	template <typename K, typename C = Compare, typename = typename C::is_transparent>
+	bool contains(K const &key) const {
+		return find_impl(key) != end();
+	}
+
+	bool empty() const {
+		return size_ == 0;
+	}
+
+	size_type size() const {
+		return size_;
+	}
+
+	/*
+	* Bytes held by the block array, including the padding of the last block.
+	*/
+	std::size_t memory_usage() const {
+		return block_count_ == 0 ? 0 : (block_count_ + 1) * block_slots * sizeof(T);
+	}
+
+private:
+	/*
+	* === === === === === === === === === === === === === === ===
+	*                L O C A L  O P E R A T I O N S
+	* === === === === === === === === === === === === === === ===
+	*/
+
+	template <typename L, typename R>
+	bool less(L const &lhs, R const &rhs) const {
+		return compare_base::get()(lhs, rhs);
+	}
+
+	static T * allocate_blocks(std::size_t count) {
+		return static_cast<T*>(::operator new((count + 1) * block_slots * sizeof(T), std::align_val_t(block_align)));
+	}
+
+	static void deallocate_blocks(T * blocks, std::size_t) noexcept {
+		::operator delete(static_cast<void*>(blocks), std::align_val_t(block_align));
+	}
+
+	void destroy_block(std::size_t k) noexcept {
+		for (std::size_t j = 0; j < block_slots; j++)
+			blocks_[k * block_slots + j].~T();
+	}
+
+	std::size_t block_size(std::size_t k) const {
+		return k == last_block_ ? size_ - (block_count_ - 1) * block_slots : block_slots;
+	}
+
+	std::size_t first_block() const {
+		if (block_count_ == 0)
+			return 0;
+		std::size_t k = 1;
+		while (2 * k <= block_count_)
+			k *= 2;
+		return k;
+	}
+
+	/*
+	* In-order successor of block k, 0 after the last one.
+	*/
+	std::size_t next_block(std::size_t k) const {
+		if (2 * k + 1 <= block_count_) {
+			k = 2 * k + 1;
+			while (2 * k <= block_count_)
+				k *= 2;
+			return k;
+		}
+		return k >> (myset_detail::count_trailing_zeros(~k) + 1);
+	}
+
+	/*
+	* In-order predecessor of block k; the predecessor of end (0) is the last block.
+	*/
+	std::size_t prev_block(std::size_t k) const {
+		if (k == 0)
+			return last_block_;
+		if (2 * k <= block_count_) {
+			k = 2 * k;
+			while (2 * k + 1 <= block_count_)
+				k = 2 * k + 1;
+			return k;
+		}
+		return k >> (myset_detail::count_trailing_zeros(k) + 1);
+	}
+
+	/*
+	* Keys in block k that are less than key (Strict) or not greater (!Strict).
+	*/
+	template <bool Strict, typename K>
+	std::size_t rank_in_block(std::size_t k, K const &key) const {
+		T const * block = blocks_ + k * block_slots;
+		std::size_t count = 0;
+		if constexpr (myset_detail::has_simd_rank<T, Compare>::value && std::is_same<K, T>::value) {
+			count = myset_detail::rank_in_line<Strict>(block, key);
+		}
+		else {
+			for (std::size_t j = 0; j < block_slots; j++)
+				count += Strict ? less(block[j], key) : !less(key, block[j]);
+		}
+		return std::min(count, block_size(k));
+	}
+
+	/*
+	* lower_bound (Strict) or upper_bound (!Strict). The descent remembers the
+	* last block it turned right at: the block whose first key is the largest
+	* one before the bound.
+	*/
+	template <bool Strict, typename K>
+	const_iterator bound(K const &key) const {
+		std::size_t k = 1, candidate = 0;
+		while (k <= block_count_) {
+			char const * grandchildren = reinterpret_cast<char const*>(blocks_ + std::min(4 * k, block_count_) * block_slots);
+			for (int line = 0; line < 4; line++)
+				myset_detail::prefetch(grandchildren + line * 64);
+			T const &first = blocks_[k * block_slots];
+			bool right = Strict ? less(first, key) : !less(key, first);
+			candidate = right ? k : candidate;
+			k = 2 * k + right;
+		}
+		if (candidate == 0)
+			return begin();
+		std::size_t slot = rank_in_block<Strict>(candidate, key);
+		if (slot < block_size(candidate))
+			return const_iterator(this, candidate, slot);
+		return const_iterator(this, next_block(candidate), 0);
+	}
+
+	template <typename K>
+	const_iterator find_impl(K const &key) const {
+		const_iterator it = bound<true>(key);
+		if (it == end() || less(key, *it))
+			return end();
+		return it;
+	}
+};
+
+template <typename T, typename Compare>
+void swap(frozen_set<T, Compare> &lhs, frozen_set<T, Compare> &rhs) noexcept {
+	lhs.swap(rhs);
+}
+
+#endif // FROZEN_SET_H
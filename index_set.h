@@ -0,0 +1,802 @@
+#ifndef INDEX_SET_H
+#define INDEX_SET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <cassert>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "set.h"
+
+namespace myset_detail {
+
+	/*
+	* Node of an index_set: the links are 32-bit positions in the node
+	* vector, and the color takes the top bit of the parent link, so an
+	* int key costs 16 bytes where a set_node<int> costs 40.
+	*/
+	template <typename T>
+	struct index_node {
+		static constexpr std::uint32_t nil = 0x7fffffff;
+		static constexpr std::uint32_t red_bit = 0x80000000;
+
+		std::uint32_t left;
+		std::uint32_t right;
+		std::uint32_t parent_and_color;
+		T value;
+
+		template <typename... Args>
+		explicit index_node(std::uint32_t parent, Args&&... args)
+			: left(nil), right(nil), parent_and_color(parent | red_bit), value(std::forward<Args>(args)...)
+		{}
+	};
+
+} // namespace myset_detail
+
+/*
+* Red-black tree with the lookup and iteration surface of set<T> whose
+* nodes live in one vector and link to each other by 32-bit index. Nodes
+* are half the size or less, the tree holds no pointers, so it copies as
+* one vector, and a set built from sorted input is laid out in key order.
+* Holds at most 2^31 - 1 elements.
+*
+* The vector stays dense: erase moves the last node into the hole it
+* leaves. Iterators are (set, index) pairs, so growing the vector keeps
+* them valid, but an erase invalidates iterators to the erased element
+* and to the element that was stored last. References to elements are
+* invalidated by any insert or erase.
+*/
+template <typename T, typename Compare = std::less<T>, typename Alloc = std::allocator<T>>
+struct index_set : private myset_detail::ebo_holder<Compare, 0> {
+
+private:
+
+	using node = myset_detail::index_node<T>;
+	using index = std::uint32_t;
+	using compare_base = myset_detail::ebo_holder<Compare, 0>;
+	using storage = std::vector<node, typename std::allocator_traits<Alloc>::template rebind_alloc<node>>;
+
+	static constexpr index nil = node::nil;
+	static constexpr index red_bit = node::red_bit;
+
+	storage nodes_;
+	index root_;
+
+public:
+
+	using key_type = T;
+	using value_type = T;
+	using size_type = std::size_t;
+	using key_compare = Compare;
+	using value_compare = Compare;
+	using allocator_type = Alloc;
+
+	index_set() : root_(nil)
+	{}
+
+	explicit index_set(Compare const &comp, Alloc const &alloc = Alloc())
+		: compare_base(comp), nodes_(alloc), root_(nil)
+	{}
+
+	/*
+	* Sorted, duplicate-free forward ranges are linked in O(n) with the
+	* nodes in key order; anything else is inserted one by one.
+	*/
+	template <typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+	index_set(InputIt first, InputIt last, Compare const &comp = Compare(), Alloc const &alloc = Alloc())
+		: compare_base(comp), nodes_(alloc), root_(nil)
+	{
+		if constexpr (std::is_base_of<std::forward_iterator_tag, typename std::iterator_traits<InputIt>::iterator_category>::value) {
+			if (std::adjacent_find(first, last, [this](T const &a, T const &b) { return !less(a, b); }) == last) {
+				link_sorted(first, static_cast<size_type>(std::distance(first, last)));
+				return;
+			}
+		}
+		insert(first, last);
+	}
+
+	/*
+	* Links [first, last), which must be sorted and free of duplicates, in O(n).
+	*/
+	template <typename ForwardIt, typename = typename std::iterator_traits<ForwardIt>::iterator_category>
+	index_set(assume_sorted_unique_t, ForwardIt first, ForwardIt last, Compare const &comp = Compare(), Alloc const &alloc = Alloc())
+		: compare_base(comp), nodes_(alloc), root_(nil)
+	{
+		link_sorted(first, static_cast<size_type>(std::distance(first, last)));
+	}
+
+	/*
+	* Copies a set in one in-order walk, O(n).
+	*/
+	template <typename A, typename S>
+	explicit index_set(set<T, Compare, A, S> const &other, Alloc const &alloc = Alloc())
+		: compare_base(other.key_comp()), nodes_(alloc), root_(nil)
+	{
+		link_sorted(other.begin(), other.size());
+	}
+
+	index_set(index_set const &) = default;
+
+	index_set(index_set &&other) noexcept
+		: compare_base(static_cast<compare_base&&>(other)), nodes_(std::move(other.nodes_)), root_(other.root_)
+	{
+		other.nodes_.clear();
+		other.root_ = nil;
+	}
+
+	index_set& operator=(index_set const &) = default;
+
+	index_set& operator=(index_set &&rhs) noexcept(std::is_nothrow_move_assignable<storage>::value) {
+		if (this != &rhs) {
+			compare_base::get() = std::move(static_cast<compare_base&>(rhs).get());
+			nodes_ = std::move(rhs.nodes_);
+			root_ = rhs.root_;
+			rhs.nodes_.clear();
+			rhs.root_ = nil;
+		}
+		return *this;
+	}
+
+	void swap(index_set &other) noexcept(std::is_nothrow_swappable<Compare>::value) {
+		using std::swap;
+		swap(compare_base::get(), other.compare_base::get());
+		nodes_.swap(other.nodes_);
+		swap(root_, other.root_);
+	}
+
+	allocator_type get_allocator() const {
+		return allocator_type(nodes_.get_allocator());
+	}
+
+	key_compare key_comp() const {
+		return compare_base::get();
+	}
+
+	value_compare value_comp() const {
+		return compare_base::get();
+	}
+
+	/*
+	* === === === === === === === === === === === === === === ===
+	*                      I T E R A T O R S
+	* === === === === === === === === === === === === === === ===
+	*/
+
+	class const_iterator {
+	public:
+		friend struct index_set;
+
+		using difference_type = std::ptrdiff_t;
+		using value_type = T;
+		using pointer = T const *;
+		using reference = T const &;
+		using iterator_category = std::bidirectional_iterator_tag;
+
+		const_iterator() : owner_(nullptr), index_(nil)
+		{}
+
+		pointer operator->() const {
+			return &owner_->nodes_[index_].value;
+		}
+
+		reference operator*() const {
+			return owner_->nodes_[index_].value;
+		}
+
+		const_iterator& operator++() {
+			index_ = owner_->next_index(index_);
+			return *this;
+		}
+
+		const_iterator operator++(int) {
+			auto tmp(*this);
+			++(*this);
+			return tmp;
+		}
+
+		const_iterator& operator--() {
+			index_ = index_ == nil ? owner_->maximum(owner_->root_) : owner_->prev_index(index_);
+			return *this;
+		}
+
+		const_iterator operator--(int) {
+			auto tmp(*this);
+			--(*this);
+			return tmp;
+		}
+
+		friend bool operator==(const_iterator const &lhs, const_iterator const &rhs) {
+			return lhs.index_ == rhs.index_;
+		}
+
+		friend bool operator!=(const_iterator const &lhs, const_iterator const &rhs) {
+			return lhs.index_ != rhs.index_;
+		}
+
+	private:
+		const_iterator(index_set const * owner, index i) : owner_(owner), index_(i)
+		{}
+
+		index_set const * owner_;
+		index index_;
+	};
+
+	using iterator = const_iterator;
+	using reverse_iterator = std::reverse_iterator<iterator>;
+	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+	iterator begin() const { return iterator(this, root_ == nil ? nil : minimum(root_)); }
+	iterator end() const { return iterator(this, nil); }
+	const_iterator cbegin() const { return begin(); }
+	const_iterator cend() const { return end(); }
+	reverse_iterator rbegin() const { return reverse_iterator(end()); }
+	reverse_iterator rend() const { return reverse_iterator(begin()); }
+	const_reverse_iterator crbegin() const { return const_reverse_iterator(end()); }
+	const_reverse_iterator crend() const { return const_reverse_iterator(begin()); }
+
+	/*
+	* === === === === === === === === === === === === === === ===
+	*                 C O M M O N  M E T H O D S
+	* === === === === === === === === === === === === === === ===
+	*/
+
+	const_iterator find(T const &value) const {
+		return const_iterator(this, find_index(value));
+	}
+
+	const_iterator lower_bound(T const &value) const {
+		return const_iterator(this, lower_bound_index(value));
+	}
+
+	const_iterator upper_bound(T const &value) const {
+		return const_iterator(this, upper_bound_index(value));
+	}
+
+	bool contains(T const &value) const {
+		return find_index(value) != nil;
+	}
+
+	size_type count(T const &value) const {
+		return contains(value) ? 1 : 0;
+	}
+
+	template <typename K, typename C = Compare, typename = typename C::is_transparent>
+	const_iterator find(K const &key) const {
+		return const_iterator(this, find_index(key));
+	}
+
+	template <typename K, typename C = Compare, typename = typename C::is_transparent>
+	const_iterator lower_bound(K const &key) const {
+		return const_iterator(this, lower_bound_index(key));
+	}
+
+	template <typename K, typename C = Compare, typename = typename C::is_transparent>
+	const_iterator upper_bound(K const &key) const {
+		return const_iterator(this, upper_bound_index(key));
+	}
+
+	template <typename K, typename C = Compare, typename = typename C::is_transparent>
+	bool contains(K const &key) const {
+		return find_index(key) != nil;
+	}
+
+	template <typename K, typename C = Compare, typename = typename C::is_transparent>
+	size_type count(K const &key) const {
+		return contains(key) ? 1 : 0;
+	}
+
+	bool empty() const {
+		return nodes_.empty();
+	}
+
+	size_type size() const {
+		return nodes_.size();
+	}
+
+	size_type max_size() const {
+		return std::min<size_type>(nil, nodes_.max_size());
+	}
+
+	size_type capacity() const {
+		return nodes_.capacity();
+	}
+
+	void reserve(size_type n) {
+		nodes_.reserve(n);
+	}
+
+	void shrink_to_fit() {
+		nodes_.shrink_to_fit();
+	}
+
+	void clear() {
+		nodes_.clear();
+		root_ = nil;
+	}
+
+	std::pair<iterator, bool> insert(T const &value) {
+		return emplace_key(value, value);
+	}
+
+	std::pair<iterator, bool> insert(T &&value) {
+		return emplace_key(value, std::move(value));
+	}
+
+	/*
+	* The hinted forms are there for drop-in use with set; the hint is ignored.
+	*/
+	iterator insert(const_iterator, T const &value) {
+		return insert(value).first;
+	}
+
+	iterator insert(const_iterator, T &&value) {
+		return insert(std::move(value)).first;
+	}
+
+	template <typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+	void insert(InputIt first, InputIt last) {
+		for (; first != last; ++first)
+			insert(*first);
+	}
+
+	template <typename... Args>
+	std::pair<iterator, bool> emplace(Args&&... args) {
+		T value(std::forward<Args>(args)...);
+		return emplace_key(value, std::move(value));
+	}
+
+	template <typename... Args>
+	iterator emplace_hint(const_iterator, Args&&... args) {
+		return emplace(std::forward<Args>(args)...).first;
+	}
+
+	iterator erase(const_iterator pos) {
+		index z = pos.index_;
+		index next = next_index(z);
+		index moved = remove(z);
+		return iterator(this, next == moved ? z : next);
+	}
+
+	iterator erase(const_iterator first, const_iterator last) {
+		while (first != last) {
+			// Every erase moves the last stored node; last follows it if it is that one.
+			if (last.index_ == static_cast<index>(nodes_.size() - 1))
+				last.index_ = first.index_;
+			first = erase(first);
+		}
+		return last;
+	}
+
+	size_type erase(T const &value) {
+		index found = find_index(value);
+		if (found == nil)
+			return 0;
+		remove(found);
+		return 1;
+	}
+
+	/*
+	* Number of nodes on the longest root-to-leaf path, 0 for an empty set.
+	*/
+	std::size_t height() const {
+		return height(root_);
+	}
+
+private:
+	/*
+	* === === === === === === === === === === === === === === ===
+	*                L O C A L  O P E R A T I O N S
+	* === === === === === === === === === === === === === === ===
+	*/
+
+	template <typename L, typename R>
+	bool less(L const &lhs, R const &rhs) const {
+		return compare_base::get()(lhs, rhs);
+	}
+
+	T const & value_of(index i) const {
+		return nodes_[i].value;
+	}
+
+	index & left(index i) {
+		return nodes_[i].left;
+	}
+
+	index & right(index i) {
+		return nodes_[i].right;
+	}
+
+	index left(index i) const {
+		return nodes_[i].left;
+	}
+
+	index right(index i) const {
+		return nodes_[i].right;
+	}
+
+	index parent(index i) const {
+		return nodes_[i].parent_and_color & ~red_bit;
+	}
+
+	void set_parent(index i, index p) {
+		nodes_[i].parent_and_color = (nodes_[i].parent_and_color & red_bit) | p;
+	}
+
+	bool is_red(index i) const {
+		return i != nil && (nodes_[i].parent_and_color & red_bit) != 0;
+	}
+
+	void set_red(index i, bool red) {
+		nodes_[i].parent_and_color = (nodes_[i].parent_and_color & ~red_bit) | (red ? red_bit : 0);
+	}
+
+	/*
+	* Points whatever referred to old_child from p (the root if p is nil) at new_child.
+	*/
+	void replace_child(index p, index old_child, index new_child) {
+		if (p == nil)
+			root_ = new_child;
+		else if (left(p) == old_child)
+			left(p) = new_child;
+		else
+			right(p) = new_child;
+	}
+
+	template <typename K>
+	index lower_bound_index(K const &key) const {
+		index result = nil;
+		index cur = root_;
+		while (cur != nil) {
+			if (!less(value_of(cur), key)) {
+				result = cur;
+				cur = left(cur);
+			}
+			else {
+				cur = right(cur);
+			}
+		}
+		return result;
+	}
+
+	template <typename K>
+	index upper_bound_index(K const &key) const {
+		index result = nil;
+		index cur = root_;
+		while (cur != nil) {
+			if (less(key, value_of(cur))) {
+				result = cur;
+				cur = left(cur);
+			}
+			else {
+				cur = right(cur);
+			}
+		}
+		return result;
+	}
+
+	template <typename K>
+	index find_index(K const &key) const {
+		index found = lower_bound_index(key);
+		if (found == nil || less(key, value_of(found)))
+			return nil;
+		return found;
+	}
+
+	index minimum(index cur) const {
+		while (left(cur) != nil)
+			cur = left(cur);
+		return cur;
+	}
+
+	index maximum(index cur) const {
+		while (right(cur) != nil)
+			cur = right(cur);
+		return cur;
+	}
+
+	index next_index(index cur) const {
+		if (right(cur) != nil)
+			return minimum(right(cur));
+		index p = parent(cur);
+		while (p != nil && cur == right(p)) {
+			cur = p;
+			p = parent(p);
+		}
+		return p;
+	}
+
+	index prev_index(index cur) const {
+		if (left(cur) != nil)
+			return maximum(left(cur));
+		index p = parent(cur);
+		while (p != nil && cur == left(p)) {
+			cur = p;
+			p = parent(p);
+		}
+		return p;
+	}
+
+	std::size_t height(index cur) const {
+		if (cur == nil)
+			return 0;
+		return 1 + std::max(height(left(cur)), height(right(cur)));
+	}
+
+	template <typename K, typename... Args>
+	std::pair<iterator, bool> emplace_key(K const &key, Args&&... args) {
+		index parent = nil;
+		index cur = root_;
+		index pred = nil;
+		bool go_left = true;
+		while (cur != nil) {
+			parent = cur;
+			go_left = less(key, value_of(cur));
+			if (go_left) {
+				cur = left(cur);
+			}
+			else {
+				pred = cur;
+				cur = right(cur);
+			}
+		}
+		if (pred != nil && !less(value_of(pred), key))
+			return { iterator(this, pred), false };
+		if (nodes_.size() >= nil)
+			throw std::length_error("index_set: too many elements");
+		index created = static_cast<index>(nodes_.size());
+		nodes_.emplace_back(parent, std::forward<Args>(args)...);
+		replace_child_of_new(parent, go_left, created);
+		insert_fixup(created);
+		return { iterator(this, created), true };
+	}
+
+	void replace_child_of_new(index p, bool go_left, index created) {
+		if (p == nil)
+			root_ = created;
+		else if (go_left)
+			left(p) = created;
+		else
+			right(p) = created;
+	}
+
+	/*
+	* Links the n sorted, unique elements starting at first into a balanced
+	* tree whose nodes sit in the vector in key order. As in set, only the
+	* nodes on the deepest, incomplete level are red.
+	*/
+	template <typename InputIt>
+	void link_sorted(InputIt first, size_type n) {
+		if (n >= nil)
+			throw std::length_error("index_set: too many elements");
+		nodes_.reserve(n);
+		for (size_type i = 0; i < n; ++i, ++first)
+			nodes_.emplace_back(nil, *first);
+		std::size_t red_depth = 0;
+		while ((std::size_t(2) << red_depth) <= n + 1)
+			++red_depth;
+		root_ = build_sorted(0, static_cast<index>(n), nil, 0, red_depth);
+	}
+
+	index build_sorted(index first, index n, index p, std::size_t depth, std::size_t red_depth) {
+		if (n == 0)
+			return nil;
+		index cur = first + n / 2;
+		left(cur) = build_sorted(first, n / 2, cur, depth + 1, red_depth);
+		right(cur) = build_sorted(cur + 1, n - n / 2 - 1, cur, depth + 1, red_depth);
+		nodes_[cur].parent_and_color = p;
+		set_red(cur, depth == red_depth);
+		return cur;
+	}
+
+	void rotate_left(index x) {
+		index y = right(x);
+		right(x) = left(y);
+		if (left(y) != nil)
+			set_parent(left(y), x);
+		set_parent(y, parent(x));
+		replace_child(parent(x), x, y);
+		left(y) = x;
+		set_parent(x, y);
+	}
+
+	void rotate_right(index x) {
+		index y = left(x);
+		left(x) = right(y);
+		if (right(y) != nil)
+			set_parent(right(y), x);
+		set_parent(y, parent(x));
+		replace_child(parent(x), x, y);
+		right(y) = x;
+		set_parent(x, y);
+	}
+
+	void insert_fixup(index x) {
+		while (x != root_ && is_red(parent(x))) {
+			index xp = parent(x);
+			index xpp = parent(xp);
+			if (xp == left(xpp)) {
+				index uncle = right(xpp);
+				if (is_red(uncle)) {
+					set_red(xp, false);
+					set_red(uncle, false);
+					set_red(xpp, true);
+					x = xpp;
+				}
+				else {
+					if (x == right(xp)) {
+						x = xp;
+						rotate_left(x);
+						xp = parent(x);
+					}
+					set_red(xp, false);
+					set_red(xpp, true);
+					rotate_right(xpp);
+				}
+			}
+			else {
+				index uncle = left(xpp);
+				if (is_red(uncle)) {
+					set_red(xp, false);
+					set_red(uncle, false);
+					set_red(xpp, true);
+					x = xpp;
+				}
+				else {
+					if (x == left(xp)) {
+						x = xp;
+						rotate_right(x);
+						xp = parent(x);
+					}
+					set_red(xp, false);
+					set_red(xpp, true);
+					rotate_left(xpp);
+				}
+			}
+		}
+		set_red(root_, false);
+	}
+
+	/*
+	* Unlinks z and rebalances, relinking nodes rather than moving values,
+	* as set::erase_fixup does.
+	*/
+	void unlink(index z) {
+		index y = z;
+		index x;
+		index x_parent;
+
+		if (left(y) == nil)
+			x = right(y);
+		else if (right(y) == nil)
+			x = left(y);
+		else {
+			y = minimum(right(y));
+			x = right(y);
+		}
+
+		bool removed_red;
+		if (y != z) {
+			set_parent(left(z), y);
+			left(y) = left(z);
+			if (y != right(z)) {
+				x_parent = parent(y);
+				if (x != nil)
+					set_parent(x, parent(y));
+				left(parent(y)) = x;
+				right(y) = right(z);
+				set_parent(right(z), y);
+			}
+			else {
+				x_parent = y;
+			}
+			replace_child(parent(z), z, y);
+			set_parent(y, parent(z));
+			removed_red = is_red(y);
+			set_red(y, is_red(z));
+		}
+		else {
+			x_parent = parent(y);
+			if (x != nil)
+				set_parent(x, parent(y));
+			replace_child(parent(z), z, x);
+			removed_red = is_red(z);
+		}
+
+		if (removed_red)
+			return;
+
+		while (x != root_ && !is_red(x)) {
+			if (x == left(x_parent)) {
+				index w = right(x_parent);
+				if (is_red(w)) {
+					set_red(w, false);
+					set_red(x_parent, true);
+					rotate_left(x_parent);
+					w = right(x_parent);
+				}
+				if (!is_red(left(w)) && !is_red(right(w))) {
+					set_red(w, true);
+					x = x_parent;
+					x_parent = parent(x_parent);
+				}
+				else {
+					if (!is_red(right(w))) {
+						set_red(left(w), false);
+						set_red(w, true);
+						rotate_right(w);
+						w = right(x_parent);
+					}
+					set_red(w, is_red(x_parent));
+					set_red(x_parent, false);
+					if (right(w) != nil)
+						set_red(right(w), false);
+					rotate_left(x_parent);
+					break;
+				}
+			}
+			else {
+				index w = left(x_parent);
+				if (is_red(w)) {
+					set_red(w, false);
+					set_red(x_parent, true);
+					rotate_right(x_parent);
+					w = left(x_parent);
+				}
+				if (!is_red(right(w)) && !is_red(left(w))) {
+					set_red(w, true);
+					x = x_parent;
+					x_parent = parent(x_parent);
+				}
+				else {
+					if (!is_red(left(w))) {
+						set_red(right(w), false);
+						set_red(w, true);
+						rotate_left(w);
+						w = left(x_parent);
+					}
+					set_red(w, is_red(x_parent));
+					set_red(x_parent, false);
+					if (left(w) != nil)
+						set_red(left(w), false);
+					rotate_right(x_parent);
+					break;
+				}
+			}
+		}
+		if (x != nil)
+			set_red(x, false);
+	}
+
+	/*
+	* Unlinks z, moves the last node into its slot and shrinks the vector.
+	* Returns the old index of the moved node (z itself if z was last).
+	*/
+	index remove(index z) {
+		unlink(z);
+		index last = static_cast<index>(nodes_.size() - 1);
+		if (z != last) {
+			nodes_[z] = std::move(nodes_[last]);
+			replace_child(parent(z), last, z);
+			if (left(z) != nil)
+				set_parent(left(z), z);
+			if (right(z) != nil)
+				set_parent(right(z), z);
+		}
+		nodes_.pop_back();
+		return last;
+	}
+};
+
+template <typename T, typename Compare, typename Alloc>
+void swap(index_set<T, Compare, Alloc> &lhs, index_set<T, Compare, Alloc> &rhs) noexcept(noexcept(lhs.swap(rhs))) {
+	lhs.swap(rhs);
+}
+
+#endif // INDEX_SET_H
@@ -0,0 +1,903 @@
+#ifndef LEAN_SET_H
+#define LEAN_SET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <cassert>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+#include "set.h"
+
+namespace myset_detail {
+
+	/*
+	* Two tagged child links and nothing else. Bit 0 of left is set when the
+	* left subtree is the taller one, bit 0 of right when the right one is,
+	* so the AVL balance factor costs no space of its own.
+	*/
+	struct lean_base_node {
+		std::uintptr_t left_bits;
+		std::uintptr_t right_bits;
+
+		lean_base_node() : left_bits(0), right_bits(0)
+		{}
+
+		lean_base_node * left() const {
+			return reinterpret_cast<lean_base_node*>(left_bits & ~std::uintptr_t(1));
+		}
+
+		lean_base_node * right() const {
+			return reinterpret_cast<lean_base_node*>(right_bits & ~std::uintptr_t(1));
+		}
+
+		void set_left(lean_base_node * child) {
+			left_bits = reinterpret_cast<std::uintptr_t>(child) | (left_bits & 1);
+		}
+
+		void set_right(lean_base_node * child) {
+			right_bits = reinterpret_cast<std::uintptr_t>(child) | (right_bits & 1);
+		}
+
+		// Height of the right subtree minus that of the left one: -1, 0 or 1.
+		int balance() const {
+			return static_cast<int>(right_bits & 1) - static_cast<int>(left_bits & 1);
+		}
+
+		void set_balance(int b) {
+			left_bits = (left_bits & ~std::uintptr_t(1)) | (b < 0 ? 1 : 0);
+			right_bits = (right_bits & ~std::uintptr_t(1)) | (b > 0 ? 1 : 0);
+		}
+	};
+
+	static_assert(alignof(lean_base_node) >= 2, "the low bit of a node address must be free");
+
+	template <typename T>
+	struct lean_node : lean_base_node {
+		T value;
+
+		template <typename... Args>
+		explicit lean_node(Args&&... args)
+			: lean_base_node(), value(std::forward<Args>(args)...)
+		{}
+	};
+
+} // namespace myset_detail
+
+/*
+* AVL tree with the lookup and iteration surface of set<T> whose nodes
+* carry no parent pointer, no subtree size and no color field: two child
+* links with the balance bits tagged into them, then the value. A node<int>
+* takes 24 bytes instead of 40, so lookup-heavy sets fit more keys per
+* cache line. There are no order statistics, split or join.
+*
+* Iterators carry the path from the root, like those of persistent_set, so
+* they are large to create and copy, and any insert or erase invalidates
+* them; references to other elements stay valid. insert returns its
+* iterator through a second descent.
+*/
+template <typename T, typename Compare = std::less<T>, typename Alloc = std::allocator<T>>
+struct lean_set
+	: private myset_detail::ebo_holder<Compare, 0>
+	, private myset_detail::ebo_holder<typename std::allocator_traits<Alloc>::template rebind_alloc<myset_detail::lean_node<T>>, 1> {
+
+private:
+
+	using base_node = myset_detail::lean_base_node;
+	using node = myset_detail::lean_node<T>;
+	using node_allocator = typename std::allocator_traits<Alloc>::template rebind_alloc<node>;
+	using node_traits = std::allocator_traits<node_allocator>;
+	using compare_base = myset_detail::ebo_holder<Compare, 0>;
+	using alloc_base = myset_detail::ebo_holder<node_allocator, 1>;
+
+	// AVL height is below 1.45 log2(n + 2), so 64 levels cover over 2^43 elements.
+	static constexpr int max_height = 64;
+
+	base_node * root_;
+	std::size_t size_;
+
+public:
+
+	using key_type = T;
+	using value_type = T;
+	using size_type = std::size_t;
+	using key_compare = Compare;
+	using value_compare = Compare;
+	using allocator_type = typename std::allocator_traits<Alloc>::template rebind_alloc<T>;
+
+	lean_set() : root_(nullptr), size_(0)
+	{}
+
+	explicit lean_set(Compare const &comp, Alloc const &alloc = Alloc())
+		: compare_base(comp), alloc_base(node_allocator(alloc)), root_(nullptr), size_(0)
+	{}
+
+	/*
+	* Sorted, duplicate-free forward ranges are linked in O(n); anything
+	* else is inserted one by one.
+	*/
+	template <typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+	lean_set(InputIt first, InputIt last, Compare const &comp = Compare(), Alloc const &alloc = Alloc())
+		: compare_base(comp), alloc_base(node_allocator(alloc)), root_(nullptr), size_(0)
+	{
+		if constexpr (std::is_base_of<std::forward_iterator_tag, typename std::iterator_traits<InputIt>::iterator_category>::value) {
+			if (std::adjacent_find(first, last, [this](T const &a, T const &b) { return !less(a, b); }) == last) {
+				link_sorted(first, static_cast<size_type>(std::distance(first, last)));
+				return;
+			}
+		}
+		insert(first, last);
+	}
+
+	/*
+	* Links [first, last), which must be sorted and free of duplicates, in O(n).
+	*/
+	template <typename ForwardIt, typename = typename std::iterator_traits<ForwardIt>::iterator_category>
+	lean_set(assume_sorted_unique_t, ForwardIt first, ForwardIt last, Compare const &comp = Compare(), Alloc const &alloc = Alloc())
+		: compare_base(comp), alloc_base(node_allocator(alloc)), root_(nullptr), size_(0)
+	{
+		link_sorted(first, static_cast<size_type>(std::distance(first, last)));
+	}
+
+	/*
+	* Copies a set in one in-order walk, O(n).
+	*/
+	template <typename A, typename S>
+	explicit lean_set(set<T, Compare, A, S> const &other, Alloc const &alloc = Alloc())
+		: compare_base(other.key_comp()), alloc_base(node_allocator(alloc)), root_(nullptr), size_(0)
+	{
+		link_sorted(other.begin(), other.size());
+	}
+
+	/*
+	* Clones the tree shape and balance bits as they are, O(n).
+	*/
+	lean_set(lean_set const &other)
+		: compare_base(other.key_comp())
+		, alloc_base(node_traits::select_on_container_copy_construction(static_cast<alloc_base const&>(other).get()))
+		, root_(nullptr), size_(0)
+	{
+		root_ = clone(other.root_);
+		size_ = other.size_;
+	}
+
+	lean_set(lean_set &&other) noexcept
+		: compare_base(static_cast<compare_base&&>(other)), alloc_base(static_cast<alloc_base&&>(other))
+		, root_(other.root_), size_(other.size_)
+	{
+		other.root_ = nullptr;
+		other.size_ = 0;
+	}
+
+	/*
+	* Copies into nodes from this set's allocator, or from rhs's when it
+	* propagates on copy assignment.
+	*/
+	lean_set& operator=(lean_set const &rhs) {
+		if (this != &rhs) {
+			constexpr bool propagate = node_traits::propagate_on_container_copy_assignment::value;
+			lean_set tmp(rhs.key_comp(), propagate ? rhs.get_allocator() : get_allocator());
+			tmp.root_ = tmp.clone(rhs.root_);
+			tmp.size_ = rhs.size_;
+			clear();
+			if (propagate)
+				alloc_base::get() = static_cast<alloc_base&>(tmp).get();
+			take_nodes(tmp);
+		}
+		return *this;
+	}
+
+	/*
+	* Steals rhs's nodes when the allocator propagates or the two compare
+	* equal, and moves the elements one by one otherwise.
+	*/
+	lean_set& operator=(lean_set &&rhs) noexcept(node_traits::propagate_on_container_move_assignment::value
+		|| node_traits::is_always_equal::value) {
+		if (this == &rhs)
+			return *this;
+		if (node_traits::propagate_on_container_move_assignment::value
+			|| alloc_base::get() == static_cast<alloc_base&>(rhs).get()) {
+			clear();
+			if (node_traits::propagate_on_container_move_assignment::value)
+				alloc_base::get() = static_cast<alloc_base&>(rhs).get();
+			take_nodes(rhs);
+		}
+		else {
+			lean_set tmp(rhs.key_comp(), get_allocator());
+			tmp.root_ = tmp.template clone<true>(rhs.root_);
+			tmp.size_ = rhs.size_;
+			rhs.clear();
+			clear();
+			take_nodes(tmp);
+		}
+		return *this;
+	}
+
+	~lean_set() {
+		destroy(root_);
+	}
+
+	void swap(lean_set &other) noexcept {
+		using std::swap;
+		swap(compare_base::get(), static_cast<compare_base&>(other).get());
+		if (node_traits::propagate_on_container_swap::value)
+			swap(alloc_base::get(), static_cast<alloc_base&>(other).get());
+		swap(root_, other.root_);
+		swap(size_, other.size_);
+	}
+
+	allocator_type get_allocator() const {
+		return allocator_type(alloc_base::get());
+	}
+
+	key_compare key_comp() const {
+		return compare_base::get();
+	}
+
+	value_compare value_comp() const {
+		return compare_base::get();
+	}
+
+	/*
+	* === === === === === === === === === === === === === === ===
+	*                      I T E R A T O R S
+	* === === === === === === === === === === === === === === ===
+	*/
+
+	class const_iterator {
+	public:
+		friend struct lean_set;
+
+		using difference_type = std::ptrdiff_t;
+		using value_type = T const;
+		using pointer = T const * ;
+		using reference = T const & ;
+		using iterator_category = std::bidirectional_iterator_tag;
+
+		const_iterator() : root_(nullptr), depth_(0)
+		{}
+
+		pointer operator->() const {
+			return &value_of(path_[depth_ - 1]);
+		}
+
+		reference operator*() const {
+			return value_of(path_[depth_ - 1]);
+		}
+
+		const_iterator& operator++() {
+			base_node * cur = path_[depth_ - 1];
+			if (cur->right()) {
+				push_leftmost(cur->right());
+			}
+			else {
+				base_node * child;
+				do {
+					child = path_[--depth_];
+				} while (depth_ > 0 && path_[depth_ - 1]->right() == child);
+			}
+			return *this;
+		}
+
+		const_iterator operator++(int) {
+			auto tmp(*this);
+			++(*this);
+			return tmp;
+		}
+
+		const_iterator& operator--() {
+			if (depth_ == 0) {
+				push_rightmost(root_);
+			}
+			else if (path_[depth_ - 1]->left()) {
+				push_rightmost(path_[depth_ - 1]->left());
+			}
+			else {
+				base_node * child;
+				do {
+					child = path_[--depth_];
+				} while (depth_ > 0 && path_[depth_ - 1]->left() == child);
+			}
+			return *this;
+		}
+
+		const_iterator operator--(int) {
+			auto tmp(*this);
+			--(*this);
+			return tmp;
+		}
+
+		friend bool operator==(const_iterator const &lhs, const_iterator const &rhs) {
+			return lhs.depth_ == rhs.depth_ && (lhs.depth_ == 0 || lhs.path_[lhs.depth_ - 1] == rhs.path_[rhs.depth_ - 1]);
+		}
+		friend bool operator!=(const_iterator const &lhs, const_iterator const &rhs) {
+			return !(lhs == rhs);
+		}
+
+	private:
+		explicit const_iterator(base_node * root) : root_(root), depth_(0)
+		{}
+
+		void push(base_node * n) {
+			assert(depth_ < max_height);
+			path_[depth_++] = n;
+		}
+
+		void push_leftmost(base_node * n) {
+			for (; n != nullptr; n = n->left())
+				push(n);
+		}
+
+		void push_rightmost(base_node * n) {
+			for (; n != nullptr; n = n->right())
+				push(n);
+		}
+
+		base_node * top() const {
+			return depth_ == 0 ? nullptr : path_[depth_ - 1];
+		}
+
+		base_node * root_;
+		int depth_;
+		base_node * path_[max_height] = {};
+	};
+
+	using iterator = const_iterator;
+	using reverse_iterator = std::reverse_iterator<iterator>;
+	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+	iterator begin() const {
+		iterator it(root_);
+		it.push_leftmost(root_);
+		return it;
+	}
+
+	iterator end() const { return iterator(root_); }
+	const_iterator cbegin() const { return begin(); }
+	const_iterator cend() const { return end(); }
+	reverse_iterator rbegin() const { return reverse_iterator(end()); }
+	reverse_iterator rend() const { return reverse_iterator(begin()); }
+	const_reverse_iterator crbegin() const { return const_reverse_iterator(end()); }
+	const_reverse_iterator crend() const { return const_reverse_iterator(begin()); }
+
+	/*
+	* === === === === === === === === === === === === === === ===
+	*                 C O M M O N  M E T H O D S
+	* === === === === === === === === === === === === === === ===
+	*/
+
+	const_iterator find(T const &value) const {
+		return find_impl(value);
+	}
+
+	const_iterator lower_bound(T const &value) const {
+		return lower_bound_impl(value);
+	}
+
+	const_iterator upper_bound(T const &value) const {
+		return upper_bound_impl(value);
+	}
+
+	/*
+	* A plain descent that builds no path, unlike find.
+	*/
+	bool contains(T const &value) const {
+		return contains_impl(value);
+	}
+
+	size_type count(T const &value) const {
+		return contains(value) ? 1 : 0;
+	}
+
+	template <typename K, typename C = Compare, typename = typename C::is_transparent>
+	const_iterator find(K const &key) const {
+		return find_impl(key);
+	}
+
+	template <typename K, typename C = Compare, typename = typename C::is_transparent>
+	const_iterator lower_bound(K const &key) const {
+		return lower_bound_impl(key);
+	}
+
+	template <typename K, typename C = Compare, typename = typename C::is_transparent>
+	const_iterator upper_bound(K const &key) const {
+		return upper_bound_impl(key);
+	}
+
+	template <typename K, typename C = Compare, typename = typename C::is_transparent>
+	bool contains(K const &key) const {
+		return contains_impl(key);
+	}
+
+	template <typename K, typename C = Compare, typename = typename C::is_transparent>
+	size_type count(K const &key) const {
+		return contains(key) ? 1 : 0;
+	}
+
+	bool empty() const {
+		return root_ == nullptr;
+	}
+
+	size_type size() const {
+		return size_;
+	}
+
+	void clear() {
+		destroy(root_);
+		root_ = nullptr;
+		size_ = 0;
+	}
+
+	std::pair<iterator, bool> insert(T const &value) {
+		return emplace_key(value, value);
+	}
+
+	std::pair<iterator, bool> insert(T &&value) {
+		return emplace_key(value, std::move(value));
+	}
+
+	/*
+	* The hinted forms are there for drop-in use with set; the hint is ignored.
+	*/
+	iterator insert(const_iterator, T const &value) {
+		return insert(value).first;
+	}
+
+	iterator insert(const_iterator, T &&value) {
+		return insert(std::move(value)).first;
+	}
+
+	template <typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+	void insert(InputIt first, InputIt last) {
+		for (; first != last; ++first)
+			insert(*first);
+	}
+
+	template <typename... Args>
+	std::pair<iterator, bool> emplace(Args&&... args) {
+		T value(std::forward<Args>(args)...);
+		return emplace_key(value, std::move(value));
+	}
+
+	template <typename... Args>
+	iterator emplace_hint(const_iterator, Args&&... args) {
+		return emplace(std::forward<Args>(args)...).first;
+	}
+
+	iterator erase(const_iterator pos) {
+		const_iterator next = pos;
+		++next;
+		base_node * after = next.top();
+		erase_key(value_of(pos.top()));
+		return after ? iterator_to(after) : end();
+	}
+
+	iterator erase(const_iterator first, const_iterator last) {
+		base_node * stop = last.top();
+		base_node * cur = first.top();
+		while (cur != stop)
+			cur = erase(iterator_to(cur)).top();
+		return stop ? iterator_to(stop) : end();
+	}
+
+	size_type erase(T const &value) {
+		return erase_key(value);
+	}
+
+	/*
+	* Number of nodes on the longest root-to-leaf path, 0 for an empty set.
+	*/
+	std::size_t height() const {
+		std::size_t result = 0;
+		for (base_node * cur = root_; cur != nullptr; cur = cur->balance() > 0 ? cur->right() : cur->left())
+			++result;
+		return result;
+	}
+
+private:
+	/*
+	* === === === === === === === === === === === === === === ===
+	*                L O C A L  O P E R A T I O N S
+	* === === === === === === === === === === === === === === ===
+	*/
+
+	static T const & value_of(base_node * cur) {
+		return static_cast<node*>(cur)->value;
+	}
+
+	template <typename L, typename R>
+	bool less(L const &lhs, R const &rhs) const {
+		return compare_base::get()(lhs, rhs);
+	}
+
+	template <typename K>
+	bool contains_impl(K const &key) const {
+		base_node * cur = root_;
+		while (cur != nullptr) {
+			if (less(key, value_of(cur)))
+				cur = cur->left();
+			else if (less(value_of(cur), key))
+				cur = cur->right();
+			else
+				return true;
+		}
+		return false;
+	}
+
+	template <typename K>
+	const_iterator find_impl(K const &key) const {
+		const_iterator it = lower_bound_impl(key);
+		if (it.depth_ == 0 || less(key, *it))
+			return end();
+		return it;
+	}
+
+	/*
+	* Records the whole descent, then cuts the path back to the last node
+	* that satisfied the bound.
+	*/
+	template <typename K>
+	const_iterator lower_bound_impl(K const &key) const {
+		const_iterator it(root_);
+		int found = 0;
+		for (base_node * cur = root_; cur != nullptr; ) {
+			it.push(cur);
+			if (!less(value_of(cur), key)) {
+				found = it.depth_;
+				cur = cur->left();
+			}
+			else {
+				cur = cur->right();
+			}
+		}
+		it.depth_ = found;
+		return it;
+	}
+
+	template <typename K>
+	const_iterator upper_bound_impl(K const &key) const {
+		const_iterator it(root_);
+		int found = 0;
+		for (base_node * cur = root_; cur != nullptr; ) {
+			it.push(cur);
+			if (less(key, value_of(cur))) {
+				found = it.depth_;
+				cur = cur->left();
+			}
+			else {
+				cur = cur->right();
+			}
+		}
+		it.depth_ = found;
+		return it;
+	}
+
+	/*
+	* Path to a node known to be in the tree.
+	*/
+	const_iterator iterator_to(base_node * target) const {
+		const_iterator it(root_);
+		for (base_node * cur = root_; ; ) {
+			it.push(cur);
+			if (cur == target)
+				return it;
+			cur = less(value_of(target), value_of(cur)) ? cur->left() : cur->right();
+		}
+	}
+
+	template <typename... Args>
+	node * create_node(Args&&... args) {
+		node_allocator &alloc = alloc_base::get();
+		node * created = node_traits::allocate(alloc, 1);
+		try {
+			node_traits::construct(alloc, created, std::forward<Args>(args)...);
+		}
+		catch (...) {
+			node_traits::deallocate(alloc, created, 1);
+			throw;
+		}
+		return created;
+	}
+
+	void destroy_node(base_node * cur) {
+		node_allocator &alloc = alloc_base::get();
+		node_traits::destroy(alloc, static_cast<node*>(cur));
+		node_traits::deallocate(alloc, static_cast<node*>(cur), 1);
+	}
+
+	void destroy(base_node * cur) {
+		if (cur == nullptr)
+			return;
+		destroy(cur->left());
+		destroy(cur->right());
+		destroy_node(cur);
+	}
+
+	/*
+	* Copies the subtree at src, or moves its values out when Move is set.
+	*/
+	template <bool Move = false>
+	base_node * clone(base_node * src) {
+		if (src == nullptr)
+			return nullptr;
+		base_node * copy;
+		if constexpr (Move)
+			copy = create_node(std::move(static_cast<node*>(src)->value));
+		else
+			copy = create_node(value_of(src));
+		try {
+			copy->set_left(clone<Move>(src->left()));
+			copy->set_right(clone<Move>(src->right()));
+		}
+		catch (...) {
+			destroy(copy);
+			throw;
+		}
+		copy->set_balance(src->balance());
+		return copy;
+	}
+
+	/*
+	* Takes other's comparator and nodes; the allocators must compare equal.
+	*/
+	void take_nodes(lean_set &other) {
+		compare_base::get() = static_cast<compare_base&>(other).get();
+		root_ = other.root_;
+		size_ = other.size_;
+		other.root_ = nullptr;
+		other.size_ = 0;
+	}
+
+	template <typename InputIt>
+	void link_sorted(InputIt first, size_type n) {
+		root_ = build_sorted(first, n);
+		size_ = n;
+	}
+
+	/*
+	* The left half gets the extra element, so the left subtree is never
+	* the shorter one and at most one level taller than the right.
+	*/
+	template <typename InputIt>
+	base_node * build_sorted(InputIt &first, size_type n) {
+		if (n == 0)
+			return nullptr;
+		base_node * left = build_sorted(first, n / 2);
+		base_node * cur;
+		try {
+			cur = create_node(*first);
+			++first;
+		}
+		catch (...) {
+			destroy(left);
+			throw;
+		}
+		cur->set_left(left);
+		try {
+			cur->set_right(build_sorted(first, n - n / 2 - 1));
+		}
+		catch (...) {
+			destroy(cur);
+			throw;
+		}
+		cur->set_balance(bit_width(n - n / 2 - 1) - bit_width(n / 2));
+		return cur;
+	}
+
+	// Height of a subtree of n nodes built by build_sorted.
+	static int bit_width(size_type n) {
+		int result = 0;
+		for (; n != 0; n >>= 1)
+			++result;
+		return result;
+	}
+
+	static base_node * rotate_left(base_node * x) {
+		base_node * y = x->right();
+		x->set_right(y->left());
+		y->set_left(x);
+		return y;
+	}
+
+	static base_node * rotate_right(base_node * x) {
+		base_node * y = x->left();
+		x->set_left(y->right());
+		y->set_right(x);
+		return y;
+	}
+
+	/*
+	* n's left subtree is two levels taller than its right one. Rotates and
+	* returns the new subtree root; shorter tells whether the subtree ended
+	* up one level lower than n was before the imbalance.
+	*/
+	static base_node * fix_left_heavy(base_node * n, bool &shorter) {
+		base_node * l = n->left();
+		int lb = l->balance();
+		if (lb <= 0) {
+			base_node * top = rotate_right(n);
+			n->set_balance(lb == 0 ? -1 : 0);
+			top->set_balance(lb == 0 ? 1 : 0);
+			shorter = lb != 0;
+			return top;
+		}
+		int b = l->right()->balance();
+		n->set_left(rotate_left(l));
+		base_node * top = rotate_right(n);
+		n->set_balance(b < 0 ? 1 : 0);
+		l->set_balance(b > 0 ? -1 : 0);
+		top->set_balance(0);
+		shorter = true;
+		return top;
+	}
+
+	static base_node * fix_right_heavy(base_node * n, bool &shorter) {
+		base_node * r = n->right();
+		int rb = r->balance();
+		if (rb >= 0) {
+			base_node * top = rotate_left(n);
+			n->set_balance(rb == 0 ? 1 : 0);
+			top->set_balance(rb == 0 ? -1 : 0);
+			shorter = rb != 0;
+			return top;
+		}
+		int b = r->left()->balance();
+		n->set_right(rotate_right(r));
+		base_node * top = rotate_left(n);
+		n->set_balance(b > 0 ? -1 : 0);
+		r->set_balance(b < 0 ? 1 : 0);
+		top->set_balance(0);
+		shorter = true;
+		return top;
+	}
+
+	/*
+	* Rebalancing after n's left (right) subtree grew by one level; grew
+	* reports whether n's subtree grew as well.
+	*/
+	static base_node * left_grew(base_node * n, bool &grew) {
+		int b = n->balance();
+		if (b < 0) {
+			bool shorter;
+			grew = false;
+			return fix_left_heavy(n, shorter);
+		}
+		n->set_balance(b - 1);
+		grew = b == 0;
+		return n;
+	}
+
+	static base_node * right_grew(base_node * n, bool &grew) {
+		int b = n->balance();
+		if (b > 0) {
+			bool shorter;
+			grew = false;
+			return fix_right_heavy(n, shorter);
+		}
+		n->set_balance(b + 1);
+		grew = b == 0;
+		return n;
+	}
+
+	/*
+	* Rebalancing after n's left (right) subtree lost a level; shorter
+	* reports whether n's subtree lost one as well.
+	*/
+	static base_node * left_shrank(base_node * n, bool &shorter) {
+		int b = n->balance();
+		if (b > 0)
+			return fix_right_heavy(n, shorter);
+		n->set_balance(b + 1);
+		shorter = b < 0;
+		return n;
+	}
+
+	static base_node * right_shrank(base_node * n, bool &shorter) {
+		int b = n->balance();
+		if (b < 0)
+			return fix_left_heavy(n, shorter);
+		n->set_balance(b - 1);
+		shorter = b > 0;
+		return n;
+	}
+
+	/*
+	* Inserts below cur and returns the new subtree root. Nothing is
+	* relinked before the new node exists, so a throwing comparator or
+	* constructor leaves the tree as it was.
+	*/
+	template <typename K, typename... Args>
+	base_node * insert_at(base_node * cur, K const &key, bool &grew, base_node *&result, Args&&... args) {
+		if (cur == nullptr) {
+			result = create_node(std::forward<Args>(args)...);
+			++size_;
+			grew = true;
+			return result;
+		}
+		if (less(key, value_of(cur))) {
+			cur->set_left(insert_at(cur->left(), key, grew, result, std::forward<Args>(args)...));
+			return grew ? left_grew(cur, grew) : cur;
+		}
+		if (less(value_of(cur), key)) {
+			cur->set_right(insert_at(cur->right(), key, grew, result, std::forward<Args>(args)...));
+			return grew ? right_grew(cur, grew) : cur;
+		}
+		result = cur;
+		grew = false;
+		return cur;
+	}
+
+	template <typename K, typename... Args>
+	std::pair<iterator, bool> emplace_key(K const &key, Args&&... args) {
+		bool grew;
+		base_node * result = nullptr;
+		size_type old_size = size_;
+		root_ = insert_at(root_, key, grew, result, std::forward<Args>(args)...);
+		bool inserted = size_ != old_size;
+		return { iterator_to(result), inserted };
+	}
+
+	/*
+	* Unlinks the smallest node below cur into min.
+	*/
+	static base_node * remove_min(base_node * cur, bool &shorter, base_node *&min) {
+		if (cur->left() == nullptr) {
+			min = cur;
+			shorter = true;
+			return cur->right();
+		}
+		cur->set_left(remove_min(cur->left(), shorter, min));
+		return shorter ? left_shrank(cur, shorter) : cur;
+	}
+
+	template <typename K>
+	base_node * erase_at(base_node * cur, K const &key, bool &shorter, base_node *&removed) {
+		if (cur == nullptr) {
+			shorter = false;
+			return nullptr;
+		}
+		if (less(key, value_of(cur))) {
+			cur->set_left(erase_at(cur->left(), key, shorter, removed));
+			return shorter ? left_shrank(cur, shorter) : cur;
+		}
+		if (less(value_of(cur), key)) {
+			cur->set_right(erase_at(cur->right(), key, shorter, removed));
+			return shorter ? right_shrank(cur, shorter) : cur;
+		}
+		removed = cur;
+		if (cur->left() == nullptr || cur->right() == nullptr) {
+			shorter = true;
+			return cur->left() ? cur->left() : cur->right();
+		}
+		// The successor takes cur's place; nodes are relinked, never their values moved.
+		base_node * successor;
+		base_node * right = remove_min(cur->right(), shorter, successor);
+		successor->set_left(cur->left());
+		successor->set_right(right);
+		successor->set_balance(cur->balance());
+		return shorter ? right_shrank(successor, shorter) : successor;
+	}
+
+	template <typename K>
+	size_type erase_key(K const &key) {
+		bool shorter;
+		base_node * removed = nullptr;
+		root_ = erase_at(root_, key, shorter, removed);
+		if (removed == nullptr)
+			return 0;
+		destroy_node(removed);
+		--size_;
+		return 1;
+	}
+};
+
+template <typename T, typename Compare, typename Alloc>
+void swap(lean_set<T, Compare, Alloc> &lhs, lean_set<T, Compare, Alloc> &rhs) noexcept {
+	lhs.swap(rhs);
+}
+
+#endif // LEAN_SET_H
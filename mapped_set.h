@@ -0,0 +1,758 @@
+#ifndef MAPPED_SET_H
+#define MAPPED_SET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+#include <cassert>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "set.h"
+
+namespace myset_detail {
+
+	/*
+	* Nodes link to each other by byte offsets from the start of the file,
+	* so a tree is valid wherever the file happens to be mapped. Offset 0 is
+	* the file header, which doubles as the null link.
+	*/
+	template <typename T>
+	struct mapped_node {
+		std::uint64_t left;
+		std::uint64_t right;
+		std::int32_t height;
+		T value;
+	};
+
+	/*
+	* What a reader needs to see a tree: the root and the element count, plus
+	* the end of the arena at the time, from which a writer reopening the file
+	* continues. sequence is odd while the writer is filling the slot.
+	*/
+	struct mapped_snapshot {
+		std::atomic<std::uint64_t> sequence;
+		std::atomic<std::uint64_t> root;
+		std::atomic<std::uint64_t> count;
+		std::atomic<std::uint64_t> end;
+	};
+
+	/*
+	* The writer publishes a snapshot by filling the slot the next
+	* generation selects and then bumping generation. Each slot is a seqlock
+	* of its own: readers retry if its sequence was odd or moved while they
+	* were copying it, which happens when the writer laps them.
+	*/
+	struct mapped_header {
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t byte_order;
+		std::uint32_t value_size;
+		std::uint32_t value_align;
+		std::atomic<std::uint64_t> generation;
+		mapped_snapshot slots[2];
+	};
+
+	static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "mapped_set shares atomics between processes");
+
+	constexpr char mapped_magic[8] = { 'M', 'Y', 'S', 'E', 'T', 'M', 'A', 'P' };
+	constexpr std::uint32_t mapped_version = 2;
+
+	[[noreturn]] inline void throw_errno(char const * what) {
+		throw std::system_error(errno, std::generic_category(), what);
+	}
+
+} // namespace myset_detail
+
+enum class map_mode {
+	read_only,
+	read_write
+};
+
+/*
+* Ordered set of trivially copyable keys whose nodes live in a memory-mapped
+* file. Opening a file maps it and reads the header: no deserialization and
+* no copies, whatever the size of the set.
+*
+* One process at a time may open a file read_write (an exclusive flock
+* enforces this); any number may open it read_only. The writer's updates
+* become visible to readers, and durable, only at sync(): nodes that a
+* published tree may still reach are never modified but copied on write,
+* like persistent_set, while nodes created since the last sync() are
+* changed in place. A reader keeps seeing the tree it opened until it calls
+* refresh(). Updates not synced when the writer closes are discarded.
+*
+* The tree is an AVL tree. Copied-away nodes are not reclaimed, so the file
+* grows with the number of updates between syncs times the tree height.
+* The file format is tied to the key type's size, alignment and byte order.
+*/
+template <typename T, typename Compare = std::less<T>>
+struct mapped_set : private myset_detail::ebo_holder<Compare, 0> {
+
+	static_assert(std::is_trivially_copyable<T>::value, "mapped_set stores keys as raw bytes");
+
+private:
+
+	using node = myset_detail::mapped_node<T>;
+	using header = myset_detail::mapped_header;
+	using compare_base = myset_detail::ebo_holder<Compare, 0>;
+
+	static constexpr int max_height = 64;
+	static constexpr std::uint64_t initial_capacity = 1 << 20;
+
+public:
+
+	using key_type = T;
+	using value_type = T;
+	using size_type = std::size_t;
+	using key_compare = Compare;
+	using value_compare = Compare;
+
+	/*
+	* Maps the file at path. read_write creates it if it does not exist;
+	* read_only requires an existing, initialized file.
+	*/
+	mapped_set(std::string const &path, map_mode mode, Compare const &comp = Compare())
+		: compare_base(comp), fd_(-1), base_(nullptr), mapped_(0), writable_(mode == map_mode::read_write),
+		root_(0), count_(0), end_(0), published_end_(0)
+	{
+		try {
+			open_file(path);
+		}
+		catch (...) {
+			close_file();
+			throw;
+		}
+	}
+
+	mapped_set(mapped_set &&other) noexcept
+		: compare_base(static_cast<compare_base&&>(other)), fd_(other.fd_), base_(other.base_), mapped_(other.mapped_),
+		writable_(other.writable_), root_(other.root_), count_(other.count_), end_(other.end_),
+		published_end_(other.published_end_), free_(std::move(other.free_))
+	{
+		other.fd_ = -1;
+		other.base_ = nullptr;
+		other.mapped_ = 0;
+	}
+
+	mapped_set& operator=(mapped_set &&rhs) noexcept {
+		if (this != &rhs) {
+			close_file();
+			compare_base::get() = std::move(static_cast<compare_base&>(rhs).get());
+			fd_ = rhs.fd_;
+			base_ = rhs.base_;
+			mapped_ = rhs.mapped_;
+			writable_ = rhs.writable_;
+			root_ = rhs.root_;
+			count_ = rhs.count_;
+			end_ = rhs.end_;
+			published_end_ = rhs.published_end_;
+			free_ = std::move(rhs.free_);
+			rhs.fd_ = -1;
+			rhs.base_ = nullptr;
+			rhs.mapped_ = 0;
+		}
+		return *this;
+	}
+
+	mapped_set(mapped_set const &) = delete;
+	mapped_set& operator=(mapped_set const &) = delete;
+
+	~mapped_set() {
+		close_file();
+	}
+
+	key_compare key_comp() const {
+		return compare_base::get();
+	}
+
+	value_compare value_comp() const {
+		return compare_base::get();
+	}
+
+	/*
+	* Flushes the writer's nodes to the file and then publishes its tree to
+	* readers. Nodes published here are copied on their next update.
+	*/
+	void sync() {
+		assert(writable_);
+		if (::msync(base_, static_cast<std::size_t>(end_), MS_SYNC) != 0)
+			myset_detail::throw_errno("mapped_set: msync");
+		publish();
+		if (::msync(base_, sizeof(header), MS_SYNC) != 0)
+			myset_detail::throw_errno("mapped_set: msync");
+		published_end_ = end_;
+		free_.clear();
+	}
+
+	/*
+	* Switches a reader to the writer's latest published tree, remapping the
+	* file if it has grown. Invalidates iterators.
+	*/
+	void refresh() {
+		assert(!writable_);
+		load_snapshot();
+		cover_snapshot();
+	}
+
+	/*
+	* Bytes of the file in use, header and unreclaimed nodes included.
+	*/
+	std::uint64_t used_bytes() const {
+		return end_;
+	}
+
+	/*
+	* === === === === === === === === === === === === === === ===
+	*                      I T E R A T O R S
+	* === === === === === === === === === === === === === === ===
+	*/
+
+	/*
+	* Carries the offsets from the root to its node. Invalidated by any
+	* update, and for readers by refresh().
+	*/
+	class const_iterator {
+	public:
+		friend struct mapped_set;
+
+		using difference_type = std::ptrdiff_t;
+		using value_type = T const;
+		using pointer = T const * ;
+		using reference = T const & ;
+		using iterator_category = std::bidirectional_iterator_tag;
+
+		const_iterator() : owner_(nullptr), depth_(0)
+		{}
+
+		pointer operator->() const {
+			return &owner_->at(path_[depth_ - 1]).value;
+		}
+
+		reference operator*() const {
+			return owner_->at(path_[depth_ - 1]).value;
+		}
+
+		const_iterator& operator++() {
+			node const &cur = owner_->at(path_[depth_ - 1]);
+			if (cur.right) {
+				push_leftmost(cur.right);
+			}
+			else {
+				std::uint64_t child;
+				do {
+					child = path_[--depth_];
+				} while (depth_ > 0 && owner_->at(path_[depth_ - 1]).right == child);
+			}
+			return *this;
+		}
+
+		const_iterator operator++(int) {
+			auto tmp(*this);
+			++(*this);
+			return tmp;
+		}
+
+		const_iterator& operator--() {
+			if (depth_ == 0) {
+				push_rightmost(owner_->root_);
+			}
+			else if (owner_->at(path_[depth_ - 1]).left) {
+				push_rightmost(owner_->at(path_[depth_ - 1]).left);
+			}
+			else {
+				std::uint64_t child;
+				do {
+					child = path_[--depth_];
+				} while (depth_ > 0 && owner_->at(path_[depth_ - 1]).left == child);
+			}
+			return *this;
+		}
+
+		const_iterator operator--(int) {
+			auto tmp(*this);
+			--(*this);
+			return tmp;
+		}
+
+		friend bool operator==(const_iterator const &lhs, const_iterator const &rhs) {
+			return lhs.depth_ == rhs.depth_ && (lhs.depth_ == 0 || lhs.path_[lhs.depth_ - 1] == rhs.path_[rhs.depth_ - 1]);
+		}
+		friend bool operator!=(const_iterator const &lhs, const_iterator const &rhs) {
+			return !(lhs == rhs);
+		}
+
+	private:
+		explicit const_iterator(mapped_set const * owner) : owner_(owner), depth_(0)
+		{}
+
+		void push(std::uint64_t n) {
+			assert(depth_ < max_height);
+			path_[depth_++] = n;
+		}
+
+		void push_leftmost(std::uint64_t n) {
+			for (; n != 0; n = owner_->at(n).left)
+				push(n);
+		}
+
+		void push_rightmost(std::uint64_t n) {
+			for (; n != 0; n = owner_->at(n).right)
+				push(n);
+		}
+
+		mapped_set const * owner_;
+		int depth_;
+		std::uint64_t path_[max_height];
+	};
+
+	using iterator = const_iterator;
+	using reverse_iterator = std::reverse_iterator<iterator>;
+	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+	iterator begin() const {
+		iterator it(this);
+		it.push_leftmost(root_);
+		return it;
+	}
+
+	iterator end() const { return iterator(this); }
+	const_iterator cbegin() const { return begin(); }
+	const_iterator cend() const { return end(); }
+	reverse_iterator rbegin() const { return reverse_iterator(end()); }
+	reverse_iterator rend() const { return reverse_iterator(begin()); }
+
+	/*
+	* === === === === === === === === === === === === === === ===
+	*                 C O M M O N  M E T H O D S
+	* === === === === === === === === === === === === === === ===
+	*/
+
+	const_iterator find(T const &value) const {
+		const_iterator it = lower_bound(value);
+		if (it == end() || less(value, *it))
+			return end();
+		return it;
+	}
+
+	const_iterator lower_bound(T const &value) const {
+		return bound(value, [this](T const &key, T const &cur) { return !less(cur, key); });
+	}
+
+	const_iterator upper_bound(T const &value) const {
+		return bound(value, [this](T const &key, T const &cur) { return less(key, cur); });
+	}
+
+	bool contains(T const &value) const {
+		return find_node(value) != 0;
+	}
+
+	size_type count(T const &value) const {
+		return contains(value) ? 1 : 0;
+	}
+
+	bool empty() const {
+		return count_ == 0;
+	}
+
+	size_type size() const {
+		return static_cast<size_type>(count_);
+	}
+
+	bool insert(T const &value) {
+		assert(writable_);
+		if (contains(value))
+			return false;
+		root_ = insert_node(root_, value);
+		++count_;
+		return true;
+	}
+
+	bool erase(T const &value) {
+		assert(writable_);
+		if (!contains(value))
+			return false;
+		root_ = erase_node(root_, value);
+		--count_;
+		return true;
+	}
+
+	void clear() {
+		assert(writable_);
+		root_ = 0;
+		count_ = 0;
+	}
+
+private:
+	/*
+	* === === === === === === === === === === === === === === ===
+	*                L O C A L  O P E R A T I O N S
+	* === === === === === === === === === === === === === === ===
+	*
+	* Any allocation may remap the file, so the update code below holds
+	* offsets across calls and only turns them into references through at().
+	*/
+
+	template <typename L, typename R>
+	bool less(L const &lhs, R const &rhs) const {
+		return compare_base::get()(lhs, rhs);
+	}
+
+	node const & at(std::uint64_t offset) const {
+		return *reinterpret_cast<node const*>(base_ + offset);
+	}
+
+	node & at(std::uint64_t offset) {
+		return *reinterpret_cast<node*>(base_ + offset);
+	}
+
+	header & head() const {
+		return *reinterpret_cast<header*>(base_);
+	}
+
+	static std::uint64_t align_up(std::uint64_t offset) {
+		return (offset + alignof(node) - 1) / alignof(node) * alignof(node);
+	}
+
+	void open_file(std::string const &path) {
+		fd_ = ::open(path.c_str(), writable_ ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+		if (fd_ < 0)
+			myset_detail::throw_errno("mapped_set: open");
+		if (writable_ && ::flock(fd_, LOCK_EX | LOCK_NB) != 0)
+			myset_detail::throw_errno("mapped_set: file already has a writer");
+		struct stat st;
+		if (::fstat(fd_, &st) != 0)
+			myset_detail::throw_errno("mapped_set: fstat");
+		std::uint64_t size = static_cast<std::uint64_t>(st.st_size);
+		if (size == 0 && writable_) {
+			grow_file(initial_capacity);
+			remap(initial_capacity);
+			initialize();
+			return;
+		}
+		if (size < sizeof(header))
+			throw std::runtime_error("mapped_set: not a mapped_set file");
+		remap(size);
+		validate();
+		load_snapshot();
+		cover_snapshot();
+		published_end_ = end_;
+	}
+
+	/*
+	* The writer may have grown the file between our fstat and the snapshot
+	* we loaded; the file is never shrunk, so remapping it whole suffices.
+	*/
+	void cover_snapshot() {
+		if (end_ <= mapped_)
+			return;
+		struct stat st;
+		if (::fstat(fd_, &st) != 0)
+			myset_detail::throw_errno("mapped_set: fstat");
+		remap(static_cast<std::uint64_t>(st.st_size));
+	}
+
+	void close_file() noexcept {
+		if (base_ != nullptr)
+			::munmap(base_, static_cast<std::size_t>(mapped_));
+		if (fd_ >= 0)
+			::close(fd_);
+		base_ = nullptr;
+		mapped_ = 0;
+		fd_ = -1;
+	}
+
+	void initialize() {
+		header * h = new (base_) header;
+		std::memcpy(h->magic, myset_detail::mapped_magic, sizeof(h->magic));
+		h->version = myset_detail::mapped_version;
+		h->byte_order = 0x01020304;
+		h->value_size = sizeof(T);
+		h->value_align = alignof(T);
+		h->generation.store(0, std::memory_order_relaxed);
+		for (myset_detail::mapped_snapshot &slot : h->slots)
+			slot.sequence.store(0, std::memory_order_relaxed);
+		end_ = align_up(sizeof(header));
+		publish();
+		published_end_ = end_;
+	}
+
+	void validate() const {
+		header const &h = head();
+		if (std::memcmp(h.magic, myset_detail::mapped_magic, sizeof(h.magic)) != 0)
+			throw std::runtime_error("mapped_set: not a mapped_set file");
+		if (h.version != myset_detail::mapped_version || h.byte_order != 0x01020304)
+			throw std::runtime_error("mapped_set: unsupported file version or byte order");
+		if (h.value_size != sizeof(T) || h.value_align != alignof(T))
+			throw std::runtime_error("mapped_set: file was written for a different key type");
+	}
+
+	void publish() {
+		header &h = head();
+		std::uint64_t next = h.generation.load(std::memory_order_relaxed) + 1;
+		myset_detail::mapped_snapshot &slot = h.slots[next & 1];
+		std::uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+		slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		slot.root.store(root_, std::memory_order_relaxed);
+		slot.count.store(count_, std::memory_order_relaxed);
+		slot.end.store(end_, std::memory_order_relaxed);
+		slot.sequence.store(sequence + 2, std::memory_order_release);
+		h.generation.store(next, std::memory_order_release);
+	}
+
+	void load_snapshot() {
+		header const &h = head();
+		for (;;) {
+			std::uint64_t generation = h.generation.load(std::memory_order_acquire);
+			myset_detail::mapped_snapshot const &slot = h.slots[generation & 1];
+			std::uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+			if (sequence & 1)
+				continue;
+			root_ = slot.root.load(std::memory_order_relaxed);
+			count_ = slot.count.load(std::memory_order_relaxed);
+			end_ = slot.end.load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (slot.sequence.load(std::memory_order_relaxed) == sequence)
+				return;
+		}
+	}
+
+	void grow_file(std::uint64_t size) {
+		if (::ftruncate(fd_, static_cast<off_t>(size)) != 0)
+			myset_detail::throw_errno("mapped_set: ftruncate");
+	}
+
+	void remap(std::uint64_t size) {
+		int prot = writable_ ? PROT_READ | PROT_WRITE : PROT_READ;
+		void * mapped = ::mmap(nullptr, static_cast<std::size_t>(size), prot, MAP_SHARED, fd_, 0);
+		if (mapped == MAP_FAILED)
+			myset_detail::throw_errno("mapped_set: mmap");
+		if (base_ != nullptr)
+			::munmap(base_, static_cast<std::size_t>(mapped_));
+		base_ = static_cast<char*>(mapped);
+		mapped_ = size;
+	}
+
+	/*
+	* Takes a node the writer owns: one freed since the last sync, or fresh
+	* space at the end of the arena, doubling the file when it runs out.
+	*/
+	std::uint64_t allocate() {
+		if (!free_.empty()) {
+			std::uint64_t reused = free_.back();
+			free_.pop_back();
+			return reused;
+		}
+		std::uint64_t offset = align_up(end_);
+		if (offset + sizeof(node) > mapped_) {
+			std::uint64_t size = std::max(2 * mapped_, offset + sizeof(node));
+			grow_file(size);
+			remap(size);
+		}
+		end_ = offset + sizeof(node);
+		return offset;
+	}
+
+	std::uint64_t new_node(T const &value) {
+		std::uint64_t n = allocate();
+		node &created = at(n);
+		created.left = created.right = 0;
+		created.height = 1;
+		std::memcpy(&created.value, &value, sizeof(T));
+		return n;
+	}
+
+	/*
+	* Returns a node with n's contents that the writer may modify: n itself
+	* if it was created after the last sync, otherwise a copy.
+	*/
+	std::uint64_t writable(std::uint64_t n) {
+		if (n >= published_end_)
+			return n;
+		std::uint64_t copy = allocate();
+		std::memcpy(&at(copy), &at(n), sizeof(node));
+		return copy;
+	}
+
+	void release(std::uint64_t n) {
+		if (n >= published_end_)
+			free_.push_back(n);
+	}
+
+	int node_height(std::uint64_t n) const {
+		return n ? at(n).height : 0;
+	}
+
+	void update(std::uint64_t n) {
+		at(n).height = std::max(node_height(at(n).left), node_height(at(n).right)) + 1;
+	}
+
+	std::uint64_t rotate_right(std::uint64_t n) {
+		n = writable(n);
+		std::uint64_t l = writable(at(n).left);
+		at(n).left = at(l).right;
+		update(n);
+		at(l).right = n;
+		update(l);
+		return l;
+	}
+
+	std::uint64_t rotate_left(std::uint64_t n) {
+		n = writable(n);
+		std::uint64_t r = writable(at(n).right);
+		at(n).right = at(r).left;
+		update(n);
+		at(r).left = n;
+		update(r);
+		return r;
+	}
+
+	/*
+	* Restores the AVL balance of a writable node whose children changed
+	* height by at most one.
+	*/
+	std::uint64_t rebalance(std::uint64_t n) {
+		update(n);
+		int balance = node_height(at(n).left) - node_height(at(n).right);
+		if (balance > 1) {
+			std::uint64_t l = at(n).left;
+			if (node_height(at(l).left) < node_height(at(l).right)) {
+				std::uint64_t rotated = rotate_left(l);
+				at(n).left = rotated;
+			}
+			return rotate_right(n);
+		}
+		if (balance < -1) {
+			std::uint64_t r = at(n).right;
+			if (node_height(at(r).right) < node_height(at(r).left)) {
+				std::uint64_t rotated = rotate_right(r);
+				at(n).right = rotated;
+			}
+			return rotate_left(n);
+		}
+		return n;
+	}
+
+	std::uint64_t insert_node(std::uint64_t n, T const &value) {
+		if (n == 0)
+			return new_node(value);
+		n = writable(n);
+		if (less(value, at(n).value)) {
+			std::uint64_t child = insert_node(at(n).left, value);
+			at(n).left = child;
+		}
+		else {
+			std::uint64_t child = insert_node(at(n).right, value);
+			at(n).right = child;
+		}
+		return rebalance(n);
+	}
+
+	/*
+	* Unlinks the smallest node of n into min, which comes back writable and childless.
+	*/
+	std::uint64_t remove_min(std::uint64_t n, std::uint64_t &min) {
+		n = writable(n);
+		if (at(n).left == 0) {
+			std::uint64_t right = at(n).right;
+			at(n).right = 0;
+			min = n;
+			return right;
+		}
+		std::uint64_t child = remove_min(at(n).left, min);
+		at(n).left = child;
+		return rebalance(n);
+	}
+
+	std::uint64_t erase_node(std::uint64_t n, T const &value) {
+		if (less(value, at(n).value)) {
+			n = writable(n);
+			std::uint64_t child = erase_node(at(n).left, value);
+			at(n).left = child;
+			return rebalance(n);
+		}
+		if (less(at(n).value, value)) {
+			n = writable(n);
+			std::uint64_t child = erase_node(at(n).right, value);
+			at(n).right = child;
+			return rebalance(n);
+		}
+		std::uint64_t left = at(n).left;
+		std::uint64_t right = at(n).right;
+		release(n);
+		if (left == 0)
+			return right;
+		if (right == 0)
+			return left;
+		std::uint64_t min;
+		right = remove_min(right, min);
+		at(min).left = left;
+		at(min).right = right;
+		return rebalance(min);
+	}
+
+	std::uint64_t find_node(T const &value) const {
+		std::uint64_t cur = root_;
+		while (cur != 0) {
+			node const &n = at(cur);
+			if (less(value, n.value))
+				cur = n.left;
+			else if (less(n.value, value))
+				cur = n.right;
+			else
+				return cur;
+		}
+		return 0;
+	}
+
+	/*
+	* Iterator to the first element for which goes_left(key, element) holds.
+	*/
+	template <typename GoesLeft>
+	const_iterator bound(T const &value, GoesLeft goes_left) const {
+		const_iterator it(this);
+		int best = 0;
+		for (std::uint64_t cur = root_; cur != 0; ) {
+			it.push(cur);
+			if (goes_left(value, at(cur).value)) {
+				best = it.depth_;
+				cur = at(cur).left;
+			}
+			else {
+				cur = at(cur).right;
+			}
+		}
+		it.depth_ = best;
+		return it;
+	}
+
+	int fd_;
+	char * base_;
+	std::uint64_t mapped_;
+	bool writable_;
+	std::uint64_t root_;
+	std::uint64_t count_;
+	std::uint64_t end_;
+	// Nodes below this offset may be reachable from a published tree.
+	std::uint64_t published_end_;
+	// Nodes created and dropped since the last sync, free for reuse.
+	std::vector<std::uint64_t> free_;
+};
+
+#endif // MAPPED_SET_H
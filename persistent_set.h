@@ -0,0 +1,566 @@
+#ifndef PERSISTENT_SET_H
+#define PERSISTENT_SET_H
+
+#include <cstddef>
+#include <atomic>
+#include <cassert>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "set.h"
+
+namespace myset_detail {
+
+	template <typename T>
+	struct persistent_node {
+		std::atomic<std::size_t> refs;
+		persistent_node * left;
+		persistent_node * right;
+		std::size_t size;
+		int height;
+		T value;
+
+		template <typename... Args>
+		explicit persistent_node(Args&&... args)
+			: refs(1), left(nullptr), right(nullptr), size(1), height(1), value(std::forward<Args>(args)...)
+		{}
+	};
+
+} // namespace myset_detail
+
+/*
+* Ordered set whose copies are O(1) snapshots. Nodes are reference counted
+* and shared between every set that can reach them; an update copies only
+* the nodes on its root-to-leaf path that some other snapshot still sees and
+* modifies unshared nodes in place, so taking no snapshots costs little.
+* The tree is an AVL tree, which keeps paths - and iterator stacks - short.
+*
+* A snapshot is never changed by updates to the set it was taken from, and
+* snapshots may be read from other threads. A single persistent_set object
+* must still not be updated while another thread reads or copies it.
+*/
+template <typename T, typename Compare = std::less<T>>
+struct persistent_set : private myset_detail::ebo_holder<Compare, 0> {
+
+private:
+
+	using node = myset_detail::persistent_node<T>;
+	using compare_base = myset_detail::ebo_holder<Compare, 0>;
+
+	// AVL height is below 1.45 log2(n + 2), so 64 levels cover over 2^43 elements.
+	static constexpr int max_height = 64;
+
+	node * root_;
+
+public:
+
+	using key_type = T;
+	using value_type = T;
+	using size_type = std::size_t;
+	using key_compare = Compare;
+	using value_compare = Compare;
+
+	persistent_set()
+		: root_(nullptr)
+	{}
+
+	explicit persistent_set(Compare const &comp)
+		: compare_base(comp), root_(nullptr)
+	{}
+
+	template <typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+	persistent_set(InputIt first, InputIt last)
+		: root_(nullptr)
+	{
+		for (; first != last; ++first)
+			insert(*first);
+	}
+
+	/*
+	* Shares the whole tree: O(1).
+	*/
+	persistent_set(persistent_set const &other)
+		: compare_base(other.key_comp()), root_(retain(other.root_))
+	{}
+
+	persistent_set(persistent_set &&other) noexcept
+		: compare_base(static_cast<compare_base&&>(other)), root_(other.root_)
+	{
+		other.root_ = nullptr;
+	}
+
+	persistent_set& operator=(persistent_set const &rhs) {
+		node * shared = retain(rhs.root_);
+		release(root_);
+		root_ = shared;
+		compare_base::get() = rhs.key_comp();
+		return *this;
+	}
+
+	persistent_set& operator=(persistent_set &&rhs) noexcept {
+		if (this != &rhs) {
+			release(root_);
+			root_ = rhs.root_;
+			rhs.root_ = nullptr;
+			compare_base::get() = std::move(static_cast<compare_base&>(rhs).get());
+		}
+		return *this;
+	}
+
+	~persistent_set() {
+		release(root_);
+	}
+
+	/*
+	* Point-in-time view that later updates to *this do not affect. O(1).
+	*/
+	persistent_set snapshot() const {
+		return *this;
+	}
+
+	void swap(persistent_set &other) noexcept {
+		using std::swap;
+		swap(compare_base::get(), other.compare_base::get());
+		swap(root_, other.root_);
+	}
+
+	key_compare key_comp() const {
+		return compare_base::get();
+	}
+
+	value_compare value_comp() const {
+		return compare_base::get();
+	}
+
+	/*
+	* Copies the elements into a balanced set<T> in O(n).
+	*/
+	set<T, Compare> to_set() const {
+		return set<T, Compare>(assume_sorted_unique, begin(), end(), key_comp());
+	}
+
+	/*
+	* === === === === === === === === === === === === === === ===
+	*                      I T E R A T O R S
+	* === === === === === === === === === === === === === === ===
+	*/
+
+	/*
+	* Nodes have no parent pointers, so an iterator carries the path from the
+	* root to its node. It stays valid as long as the set it came from (or a
+	* snapshot sharing that tree) is not updated or destroyed.
+	*/
+	class const_iterator {
+	public:
+		friend struct persistent_set;
+
+		using difference_type = std::ptrdiff_t;
+		using value_type = T const;
+		using pointer = T const * ;
+		using reference = T const & ;
+		using iterator_category = std::bidirectional_iterator_tag;
+
+		const_iterator() : root_(nullptr), depth_(0)
+		{}
+
+		pointer operator->() const {
+			return &path_[depth_ - 1]->value;
+		}
+
+		reference operator*() const {
+			return path_[depth_ - 1]->value;
+		}
+
+		const_iterator& operator++() {
+			node const * cur = path_[depth_ - 1];
+			if (cur->right) {
+				push_leftmost(cur->right);
+			}
+			else {
+				node const * child;
+				do {
+					child = path_[--depth_];
+				} while (depth_ > 0 && path_[depth_ - 1]->right == child);
+			}
+			return *this;
+		}
+
+		const_iterator operator++(int) {
+			auto tmp(*this);
+			++(*this);
+			return tmp;
+		}
+
+		const_iterator& operator--() {
+			if (depth_ == 0) {
+				push_rightmost(root_);
+			}
+			else if (path_[depth_ - 1]->left) {
+				push_rightmost(path_[depth_ - 1]->left);
+			}
+			else {
+				node const * child;
+				do {
+					child = path_[--depth_];
+				} while (depth_ > 0 && path_[depth_ - 1]->left == child);
+			}
+			return *this;
+		}
+
+		const_iterator operator--(int) {
+			auto tmp(*this);
+			--(*this);
+			return tmp;
+		}
+
+		friend bool operator==(const_iterator const &lhs, const_iterator const &rhs) {
+			return lhs.depth_ == rhs.depth_ && (lhs.depth_ == 0 || lhs.path_[lhs.depth_ - 1] == rhs.path_[rhs.depth_ - 1]);
+		}
+		friend bool operator!=(const_iterator const &lhs, const_iterator const &rhs) {
+			return !(lhs == rhs);
+		}
+
+	private:
+		explicit const_iterator(node const * root) : root_(root), depth_(0)
+		{}
+
+		void push(node const * n) {
+			assert(depth_ < max_height);
+			path_[depth_++] = n;
+		}
+
+		void push_leftmost(node const * n) {
+			for (; n != nullptr; n = n->left)
+				push(n);
+		}
+
+		void push_rightmost(node const * n) {
+			for (; n != nullptr; n = n->right)
+				push(n);
+		}
+
+		node const * root_;
+		int depth_;
+		node const * path_[max_height];
+	};
+
+	using iterator = const_iterator;
+	using reverse_iterator = std::reverse_iterator<iterator>;
+	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+	iterator begin() const {
+		iterator it(root_);
+		it.push_leftmost(root_);
+		return it;
+	}
+
+	iterator end() const { return iterator(root_); }
+	const_iterator cbegin() const { return begin(); }
+	const_iterator cend() const { return end(); }
+	reverse_iterator rbegin() const { return reverse_iterator(end()); }
+	reverse_iterator rend() const { return reverse_iterator(begin()); }
+
+	/*
+	* === === === === === === === === === === === === === === ===
+	*                 C O M M O N  M E T H O D S
+	* === === === === === === === === === === === === === === ===
+	*/
+
+	const_iterator find(T const &value) const {
+		const_iterator it = lower_bound(value);
+		if (it == end() || less(value, *it))
+			return end();
+		return it;
+	}
+
+	const_iterator lower_bound(T const &value) const {
+		return bound(value, [this](T const &key, T const &cur) { return !less(cur, key); });
+	}
+
+	const_iterator upper_bound(T const &value) const {
+		return bound(value, [this](T const &key, T const &cur) { return less(key, cur); });
+	}
+
+	bool contains(T const &value) const {
+		return find_node(value) != nullptr;
+	}
+
+	size_type count(T const &value) const {
+		return contains(value) ? 1 : 0;
+	}
+
+	bool empty() const {
+		return root_ == nullptr;
+	}
+
+	size_type size() const {
+		return subtree_size(root_);
+	}
+
+	/*
+	* The k-th smallest element (0-based), or end() if k >= size().
+	*/
+	const_iterator nth(size_type k) const {
+		const_iterator it(root_);
+		if (k >= size())
+			return it;
+		for (node const * cur = root_; ; ) {
+			it.push(cur);
+			size_type left = subtree_size(cur->left);
+			if (k == left)
+				return it;
+			if (k < left) {
+				cur = cur->left;
+			}
+			else {
+				k -= left + 1;
+				cur = cur->right;
+			}
+		}
+	}
+
+	/*
+	* Number of elements less than value.
+	*/
+	size_type rank(T const &value) const {
+		size_type result = 0;
+		for (node const * cur = root_; cur != nullptr; ) {
+			if (less(cur->value, value)) {
+				result += subtree_size(cur->left) + 1;
+				cur = cur->right;
+			}
+			else {
+				cur = cur->left;
+			}
+		}
+		return result;
+	}
+
+	void clear() {
+		release(root_);
+		root_ = nullptr;
+	}
+
+	bool insert(T const &value) {
+		if (contains(value))
+			return false;
+		root_ = insert_node(root_, value);
+		return true;
+	}
+
+	bool insert(T &&value) {
+		if (contains(value))
+			return false;
+		root_ = insert_node(root_, std::move(value));
+		return true;
+	}
+
+	bool erase(T const &value) {
+		if (!contains(value))
+			return false;
+		root_ = erase_node(root_, value);
+		return true;
+	}
+
+	std::size_t height() const {
+		return static_cast<std::size_t>(node_height(root_));
+	}
+
+private:
+	/*
+	* === === === === === === === === === === === === === === ===
+	*                L O C A L  O P E R A T I O N S
+	* === === === === === === === === === === === === === === ===
+	*
+	* Every node * passed in or returned below carries one reference that the
+	* callee consumes or the caller takes over.
+	*/
+
+	template <typename L, typename R>
+	bool less(L const &lhs, R const &rhs) const {
+		return compare_base::get()(lhs, rhs);
+	}
+
+	static size_type subtree_size(node const * n) {
+		return n ? n->size : 0;
+	}
+
+	static int node_height(node const * n) {
+		return n ? n->height : 0;
+	}
+
+	static node * retain(node * n) {
+		if (n)
+			n->refs.fetch_add(1, std::memory_order_relaxed);
+		return n;
+	}
+
+	/*
+	* Drops one reference; the recursion only continues into nodes that die,
+	* so its depth is bounded by the tree height.
+	*/
+	static void release(node * n) {
+		if (n == nullptr || n->refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+			return;
+		release(n->left);
+		release(n->right);
+		delete n;
+	}
+
+	/*
+	* Returns a node with the same contents that nobody else references,
+	* copying n (and sharing its children) if it is shared.
+	*/
+	static node * unique(node * n) {
+		if (n->refs.load(std::memory_order_acquire) == 1)
+			return n;
+		node * copy = new node(n->value);
+		copy->left = retain(n->left);
+		copy->right = retain(n->right);
+		copy->size = n->size;
+		copy->height = n->height;
+		release(n);
+		return copy;
+	}
+
+	static void update(node * n) {
+		n->size = subtree_size(n->left) + subtree_size(n->right) + 1;
+		n->height = std::max(node_height(n->left), node_height(n->right)) + 1;
+	}
+
+	static node * rotate_right(node * n) {
+		n = unique(n);
+		node * l = unique(n->left);
+		n->left = l->right;
+		update(n);
+		l->right = n;
+		update(l);
+		return l;
+	}
+
+	static node * rotate_left(node * n) {
+		n = unique(n);
+		node * r = unique(n->right);
+		n->right = r->left;
+		update(n);
+		r->left = n;
+		update(r);
+		return r;
+	}
+
+	/*
+	* Restores the AVL balance of an unshared node whose children changed
+	* height by at most one.
+	*/
+	static node * rebalance(node * n) {
+		update(n);
+		int balance = node_height(n->left) - node_height(n->right);
+		if (balance > 1) {
+			if (node_height(n->left->left) < node_height(n->left->right))
+				n->left = rotate_left(n->left);
+			return rotate_right(n);
+		}
+		if (balance < -1) {
+			if (node_height(n->right->right) < node_height(n->right->left))
+				n->right = rotate_right(n->right);
+			return rotate_left(n);
+		}
+		return n;
+	}
+
+	template <typename V>
+	node * insert_node(node * n, V &&value) {
+		if (n == nullptr)
+			return new node(std::forward<V>(value));
+		n = unique(n);
+		if (less(value, n->value))
+			n->left = insert_node(n->left, std::forward<V>(value));
+		else
+			n->right = insert_node(n->right, std::forward<V>(value));
+		return rebalance(n);
+	}
+
+	/*
+	* Unlinks the smallest node of n into min, which comes back unshared and childless.
+	*/
+	static node * remove_min(node * n, node * &min) {
+		n = unique(n);
+		if (n->left == nullptr) {
+			node * right = n->right;
+			n->right = nullptr;
+			min = n;
+			return right;
+		}
+		n->left = remove_min(n->left, min);
+		return rebalance(n);
+	}
+
+	node * erase_node(node * n, T const &value) {
+		n = unique(n);
+		if (less(value, n->value)) {
+			n->left = erase_node(n->left, value);
+			return rebalance(n);
+		}
+		if (less(n->value, value)) {
+			n->right = erase_node(n->right, value);
+			return rebalance(n);
+		}
+		node * left = n->left;
+		node * right = n->right;
+		n->left = n->right = nullptr;
+		release(n);
+		if (left == nullptr)
+			return right;
+		if (right == nullptr)
+			return left;
+		node * min;
+		right = remove_min(right, min);
+		min->left = left;
+		min->right = right;
+		return rebalance(min);
+	}
+
+	node * find_node(T const &value) const {
+		node * cur = root_;
+		while (cur != nullptr) {
+			if (less(value, cur->value))
+				cur = cur->left;
+			else if (less(cur->value, value))
+				cur = cur->right;
+			else
+				return cur;
+		}
+		return nullptr;
+	}
+
+	/*
+	* Iterator to the first element for which goes_left(key, element) holds.
+	*/
+	template <typename GoesLeft>
+	const_iterator bound(T const &value, GoesLeft goes_left) const {
+		const_iterator it(root_);
+		int best = 0;
+		for (node const * cur = root_; cur != nullptr; ) {
+			it.push(cur);
+			if (goes_left(value, cur->value)) {
+				best = it.depth_;
+				cur = cur->left;
+			}
+			else {
+				cur = cur->right;
+			}
+		}
+		it.depth_ = best;
+		return it;
+	}
+};
+
+template <typename T, typename Compare>
+void swap(persistent_set<T, Compare> &lhs, persistent_set<T, Compare> &rhs) noexcept {
+	lhs.swap(rhs);
+}
+
+#endif // PERSISTENT_SET_H
@@ -0,0 +1,202 @@
+#ifndef POOL_ALLOCATOR_H
+#define POOL_ALLOCATOR_H
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+namespace myset_detail {
+
+	/*
+	* Hands out fixed-size slots from geometrically growing chunks. The slot
+	* size is fixed by the first single-object allocation; freed slots are
+	* threaded through an intrusive free list and reused before the chunk is
+	* bumped further. Not thread-safe.
+	*/
+	class node_pool {
+	public:
+		node_pool() = default;
+		node_pool(node_pool const&) = delete;
+		node_pool& operator=(node_pool const&) = delete;
+
+		~node_pool() {
+			free_chunks();
+		}
+
+		bool fits(std::size_t size, std::size_t align) const noexcept {
+			return slot_size_ == 0 || (size <= slot_size_ && align <= slot_align_);
+		}
+
+		void * allocate(std::size_t size, std::size_t align) {
+			if (slot_size_ == 0) {
+				slot_align_ = std::max(align, alignof(free_slot));
+				slot_size_ = round_up(std::max(size, sizeof(free_slot)), slot_align_);
+			}
+			++in_use_;
+			if (free_list_ != nullptr) {
+				free_slot * slot = free_list_;
+				free_list_ = slot->next;
+				return slot;
+			}
+			if (bump_ == bump_end_)
+				grow();
+			void * slot = bump_;
+			bump_ += slot_size_;
+			return slot;
+		}
+
+		void deallocate(void * p) noexcept {
+			--in_use_;
+			free_slot * slot = static_cast<free_slot*>(p);
+			slot->next = free_list_;
+			free_list_ = slot;
+		}
+
+		/*
+		* Returns every chunk to the system once no slot is handed out.
+		*/
+		void release() noexcept {
+			if (in_use_ == 0)
+				free_chunks();
+		}
+
+		std::size_t chunk_count() const noexcept {
+			std::size_t count = 0;
+			for (chunk_header * c = chunks_; c != nullptr; c = c->next)
+				++count;
+			return count;
+		}
+
+	private:
+		struct free_slot {
+			free_slot * next;
+		};
+
+		struct chunk_header {
+			chunk_header * next;
+		};
+
+		static constexpr std::size_t first_chunk_slots = 64;
+		static constexpr std::size_t max_chunk_slots = 8192;
+
+		static std::size_t round_up(std::size_t n, std::size_t align) {
+			return (n + align - 1) / align * align;
+		}
+
+		void grow() {
+			std::size_t header = round_up(sizeof(chunk_header), slot_align_);
+			std::size_t bytes = header + slot_size_ * next_chunk_slots_;
+			char * raw = static_cast<char*>(::operator new(bytes, std::align_val_t(slot_align_)));
+			chunk_header * chunk = reinterpret_cast<chunk_header*>(raw);
+			chunk->next = chunks_;
+			chunks_ = chunk;
+			bump_ = raw + header;
+			bump_end_ = raw + bytes;
+			if (next_chunk_slots_ < max_chunk_slots)
+				next_chunk_slots_ *= 2;
+		}
+
+		void free_chunks() noexcept {
+			while (chunks_ != nullptr) {
+				chunk_header * next = chunks_->next;
+				::operator delete(static_cast<void*>(chunks_), std::align_val_t(slot_align_));
+				chunks_ = next;
+			}
+			free_list_ = nullptr;
+			bump_ = bump_end_ = nullptr;
+			next_chunk_slots_ = first_chunk_slots;
+		}
+
+		std::size_t slot_size_ = 0;
+		std::size_t slot_align_ = 0;
+		std::size_t in_use_ = 0;
+		std::size_t next_chunk_slots_ = first_chunk_slots;
+		chunk_header * chunks_ = nullptr;
+		free_slot * free_list_ = nullptr;
+		char * bump_ = nullptr;
+		char * bump_end_ = nullptr;
+	};
+
+} // namespace myset_detail
+
+/*
+* Slab allocator for node-based containers. Copies (including rebound ones)
+* share one pool; single-object allocations that fit the pool's slot come
+* from it, everything else goes to the global operator new. Copy-constructed
+* containers get a fresh pool, so two sets never share slots by accident.
+*/
+template <typename T>
+class pool_allocator {
+public:
+	using value_type = T;
+	using propagate_on_container_copy_assignment = std::false_type;
+	using propagate_on_container_move_assignment = std::true_type;
+	using propagate_on_container_swap = std::true_type;
+	using is_always_equal = std::false_type;
+
+	template <typename U>
+	struct rebind {
+		using other = pool_allocator<U>;
+	};
+
+	pool_allocator()
+		: pool_(std::make_shared<myset_detail::node_pool>())
+	{}
+
+	// Moving must leave the source usable, so copies and moves both share the pool.
+	pool_allocator(pool_allocator const&) = default;
+	pool_allocator& operator=(pool_allocator const&) = default;
+
+	template <typename U>
+	pool_allocator(pool_allocator<U> const& other) noexcept
+		: pool_(other.pool_)
+	{}
+
+	pool_allocator select_on_container_copy_construction() const {
+		return pool_allocator();
+	}
+
+	T * allocate(std::size_t n) {
+		if (n == 1 && pool_->fits(sizeof(T), alignof(T)))
+			return static_cast<T*>(pool_->allocate(sizeof(T), alignof(T)));
+		return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(alignof(T))));
+	}
+
+	void deallocate(T * p, std::size_t n) noexcept {
+		if (n == 1 && pool_->fits(sizeof(T), alignof(T)))
+			pool_->deallocate(p);
+		else
+			::operator delete(static_cast<void*>(p), std::align_val_t(alignof(T)));
+	}
+
+	/*
+	* Drops all chunks if every slot has been given back; called by set::clear().
+	*/
+	void release() noexcept {
+		pool_->release();
+	}
+
+	std::size_t chunk_count() const noexcept {
+		return pool_->chunk_count();
+	}
+
+	template <typename U>
+	friend bool operator==(pool_allocator const& lhs, pool_allocator<U> const& rhs) noexcept {
+		return lhs.pool_ == rhs.pool_;
+	}
+
+	template <typename U>
+	friend bool operator!=(pool_allocator const& lhs, pool_allocator<U> const& rhs) noexcept {
+		return lhs.pool_ != rhs.pool_;
+	}
+
+private:
+	template <typename U>
+	friend class pool_allocator;
+
+	std::shared_ptr<myset_detail::node_pool> pool_;
+};
+
+#endif // POOL_ALLOCATOR_H
@@ -0,0 +1,369 @@
+#ifndef SERIALIZATION_H
+#define SERIALIZATION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <istream>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "set.h"
+
+/*
+* Binary dump of a set, written in sorted order so that loading it links a
+* balanced tree in one linear pass instead of inserting element by element.
+*
+*   magic       8 bytes  "MYSETBIN"
+*   version     u32      currently 1
+*   byte order  u32      0x01020304 as written by the producer
+*   key format  u32      key_codec<T>::format
+*   key width   u32      key_codec<T>::width
+*   count       u64      number of elements
+*   elements    count encoded keys, strictly increasing
+*   checksum    u64      FNV-1a over everything above
+*
+* Integers, and trivially copyable keys, are stored in the producer's byte
+* order; a loader with the other byte order rejects the dump.
+*/
+
+struct serialization_error : std::runtime_error {
+	using std::runtime_error::runtime_error;
+};
+
+/*
+* How keys of type T are encoded. Trivially copyable keys are stored as
+* their object representation, strings as a u64 length and the characters.
+* Other key types can be made serializable by specializing key_codec with
+* a format id of 256 or above and the same three members.
+*/
+template <typename T, typename = void>
+struct key_codec;
+
+template <typename T>
+struct key_codec<T, std::enable_if_t<std::is_trivially_copyable<T>::value && std::is_default_constructible<T>::value>> {
+	static constexpr std::uint32_t format = 1;
+	static constexpr std::uint32_t width = sizeof(T);
+
+	template <typename Writer>
+	static void encode(Writer &out, T const &value) {
+		out.write(&value, sizeof(T));
+	}
+
+	template <typename Reader>
+	static T decode(Reader &in) {
+		T value;
+		in.read(&value, sizeof(T));
+		return value;
+	}
+};
+
+template <typename Char, typename Traits, typename Alloc>
+struct key_codec<std::basic_string<Char, Traits, Alloc>, std::enable_if_t<std::is_trivially_copyable<Char>::value>> {
+	static constexpr std::uint32_t format = 2;
+	static constexpr std::uint32_t width = sizeof(Char);
+
+	template <typename Writer>
+	static void encode(Writer &out, std::basic_string<Char, Traits, Alloc> const &value) {
+		std::uint64_t length = value.size();
+		out.write(&length, sizeof(length));
+		out.write(value.data(), value.size() * sizeof(Char));
+	}
+
+	/*
+	* Reads the characters in bounded steps, so a corrupt length runs into
+	* the end of the input instead of into one huge allocation.
+	*/
+	template <typename Reader>
+	static std::basic_string<Char, Traits, Alloc> decode(Reader &in) {
+		std::uint64_t length;
+		in.read(&length, sizeof(length));
+		std::basic_string<Char, Traits, Alloc> value;
+		const std::uint64_t step = 65536 / sizeof(Char);
+		while (length != 0) {
+			std::size_t chunk = static_cast<std::size_t>(std::min(length, step));
+			std::size_t old_size = value.size();
+			value.resize(old_size + chunk);
+			in.read(&value[old_size], chunk * sizeof(Char));
+			length -= chunk;
+		}
+		return value;
+	}
+};
+
+namespace myset_detail {
+
+	constexpr char serial_magic[8] = { 'M', 'Y', 'S', 'E', 'T', 'B', 'I', 'N' };
+	constexpr std::uint32_t serial_version = 1;
+	constexpr std::uint32_t serial_byte_order = 0x01020304;
+
+	struct fnv1a {
+		std::uint64_t hash = 14695981039346656037ull;
+
+		void update(void const * data, std::size_t n) {
+			unsigned char const * bytes = static_cast<unsigned char const*>(data);
+			for (std::size_t i = 0; i < n; i++)
+				hash = (hash ^ bytes[i]) * 1099511628211ull;
+		}
+	};
+
+	/*
+	* Writes through a fixed 64 KiB buffer, so a dump never needs memory
+	* proportional to its size.
+	*/
+	class stream_writer {
+	public:
+		explicit stream_writer(std::ostream &out) : out_(out), used_(0), buffer_(65536)
+		{}
+
+		void write(void const * data, std::size_t n) {
+			checksum.update(data, n);
+			char const * bytes = static_cast<char const*>(data);
+			while (n != 0) {
+				std::size_t chunk = std::min(n, buffer_.size() - used_);
+				std::memcpy(buffer_.data() + used_, bytes, chunk);
+				used_ += chunk;
+				bytes += chunk;
+				n -= chunk;
+				if (used_ == buffer_.size())
+					flush();
+			}
+		}
+
+		void flush() {
+			if (used_ != 0 && !out_.write(buffer_.data(), static_cast<std::streamsize>(used_)))
+				throw serialization_error("set dump: write failed");
+			used_ = 0;
+		}
+
+		fnv1a checksum;
+
+	private:
+		std::ostream &out_;
+		std::size_t used_;
+		std::vector<char> buffer_;
+	};
+
+	class buffer_writer {
+	public:
+		explicit buffer_writer(std::vector<char> &out) : out_(out)
+		{}
+
+		void write(void const * data, std::size_t n) {
+			checksum.update(data, n);
+			char const * bytes = static_cast<char const*>(data);
+			out_.insert(out_.end(), bytes, bytes + n);
+		}
+
+		void flush() {
+		}
+
+		fnv1a checksum;
+
+	private:
+		std::vector<char> &out_;
+	};
+
+	/*
+	* Reads through the stream's own buffer, so nothing past the dump is
+	* consumed and the stream can hold more data after it.
+	*/
+	class stream_reader {
+	public:
+		explicit stream_reader(std::istream &in) : in_(in)
+		{}
+
+		void read(void * data, std::size_t n) {
+			std::streambuf * buf = in_.rdbuf();
+			if (buf == nullptr || buf->sgetn(static_cast<char*>(data), static_cast<std::streamsize>(n)) != static_cast<std::streamsize>(n)) {
+				in_.setstate(std::ios_base::eofbit | std::ios_base::failbit);
+				throw serialization_error("set dump: unexpected end of input");
+			}
+			checksum.update(data, n);
+		}
+
+		fnv1a checksum;
+
+	private:
+		std::istream &in_;
+	};
+
+	class buffer_reader {
+	public:
+		buffer_reader(char const * data, std::size_t size) : data_(data), left_(size)
+		{}
+
+		void read(void * data, std::size_t n) {
+			if (n > left_)
+				throw serialization_error("set dump: unexpected end of input");
+			std::memcpy(data, data_, n);
+			checksum.update(data, n);
+			data_ += n;
+			left_ -= n;
+		}
+
+		std::size_t remaining() const {
+			return left_;
+		}
+
+		fnv1a checksum;
+
+	private:
+		char const * data_;
+		std::size_t left_;
+	};
+
+	/*
+	* Single-pass iterator that decodes one key per element. Dereferencing
+	* decodes and hands the key out as an rvalue, so it is moved into its node.
+	*/
+	template <typename T, typename Reader>
+	class decoding_iterator {
+	public:
+		using difference_type = std::ptrdiff_t;
+		using value_type = T;
+		using pointer = T * ;
+		using reference = T && ;
+		using iterator_category = std::input_iterator_tag;
+
+		explicit decoding_iterator(Reader &in) : in_(&in)
+		{}
+
+		T && operator*() {
+			if (!current_)
+				current_.emplace(key_codec<T>::decode(*in_));
+			return std::move(*current_);
+		}
+
+		decoding_iterator& operator++() {
+			current_.reset();
+			return *this;
+		}
+
+	private:
+		Reader * in_;
+		std::optional<T> current_;
+	};
+
+	template <typename Writer>
+	void write_u32(Writer &out, std::uint32_t value) {
+		out.write(&value, sizeof(value));
+	}
+
+	template <typename Writer>
+	void write_u64(Writer &out, std::uint64_t value) {
+		out.write(&value, sizeof(value));
+	}
+
+	template <typename Reader>
+	std::uint32_t read_u32(Reader &in) {
+		std::uint32_t value;
+		in.read(&value, sizeof(value));
+		return value;
+	}
+
+	template <typename Reader>
+	std::uint64_t read_u64(Reader &in) {
+		std::uint64_t value;
+		in.read(&value, sizeof(value));
+		return value;
+	}
+
+	template <typename T, typename Compare, typename Alloc, typename Stats, typename Writer>
+	void save(set<T, Compare, Alloc, Stats> const &s, Writer &out) {
+		out.write(serial_magic, sizeof(serial_magic));
+		write_u32(out, serial_version);
+		write_u32(out, serial_byte_order);
+		write_u32(out, key_codec<T>::format);
+		write_u32(out, key_codec<T>::width);
+		write_u64(out, s.size());
+		for (T const &value : s)
+			key_codec<T>::encode(out, value);
+		std::uint64_t checksum = out.checksum.hash;
+		write_u64(out, checksum);
+		out.flush();
+	}
+
+	/*
+	* Builds the whole set aside and only replaces out once the checksum
+	* and the key order have been verified, so a bad dump leaves out as it was.
+	*/
+	template <typename T, typename Compare, typename Alloc, typename Stats, typename Reader>
+	void load(Reader &in, set<T, Compare, Alloc, Stats> &out) {
+		char magic[sizeof(serial_magic)];
+		in.read(magic, sizeof(magic));
+		if (std::memcmp(magic, serial_magic, sizeof(magic)) != 0)
+			throw serialization_error("set dump: bad magic");
+		if (read_u32(in) != serial_version)
+			throw serialization_error("set dump: unsupported version");
+		if (read_u32(in) != serial_byte_order)
+			throw serialization_error("set dump: written with a different byte order");
+		std::uint32_t format = read_u32(in);
+		std::uint32_t width = read_u32(in);
+		if (format != key_codec<T>::format || width != key_codec<T>::width)
+			throw serialization_error("set dump: written for a different key type");
+		std::uint64_t count = read_u64(in);
+		if (count > std::numeric_limits<typename set<T, Compare, Alloc, Stats>::size_type>::max())
+			throw serialization_error("set dump: too many elements");
+
+		set<T, Compare, Alloc, Stats> loaded(assume_sorted_unique, decoding_iterator<T, Reader>(in),
+			static_cast<typename set<T, Compare, Alloc, Stats>::size_type>(count), out.key_comp(), out.get_allocator());
+		std::uint64_t expected = in.checksum.hash;
+		if (read_u64(in) != expected)
+			throw serialization_error("set dump: checksum mismatch");
+		Compare comp = loaded.key_comp();
+		if (std::adjacent_find(loaded.begin(), loaded.end(), [&comp](T const &a, T const &b) { return !comp(a, b); }) != loaded.end())
+			throw serialization_error("set dump: keys are not strictly increasing");
+		out = std::move(loaded);
+	}
+
+} // namespace myset_detail
+
+/*
+* Streams the dump through a 64 KiB buffer.
+*/
+template <typename T, typename Compare, typename Alloc, typename Stats>
+void serialize(set<T, Compare, Alloc, Stats> const &s, std::ostream &out) {
+	myset_detail::stream_writer writer(out);
+	myset_detail::save(s, writer);
+}
+
+/*
+* Appends the dump to out.
+*/
+template <typename T, typename Compare, typename Alloc, typename Stats>
+void serialize(set<T, Compare, Alloc, Stats> const &s, std::vector<char> &out) {
+	myset_detail::buffer_writer writer(out);
+	myset_detail::save(s, writer);
+}
+
+/*
+* Replaces the contents of out with the dump read from in, in O(n), one
+* element at a time. Reads exactly the dump's bytes, so whatever follows
+* it stays in the stream. Throws serialization_error on a malformed dump.
+*/
+template <typename T, typename Compare, typename Alloc, typename Stats>
+void deserialize(std::istream &in, set<T, Compare, Alloc, Stats> &out) {
+	myset_detail::stream_reader reader(in);
+	myset_detail::load(reader, out);
+}
+
+/*
+* Like the stream overload, from the size bytes at data. Returns the number
+* of bytes the dump occupied.
+*/
+template <typename T, typename Compare, typename Alloc, typename Stats>
+std::size_t deserialize(void const * data, std::size_t size, set<T, Compare, Alloc, Stats> &out) {
+	myset_detail::buffer_reader reader(static_cast<char const*>(data), size);
+	myset_detail::load(reader, out);
+	return size - reader.remaining();
+}
+
+#endif // SERIALIZATION_H
@@ -1,433 +1,2572 @@
-#define _SCL_SECURE_NO_WARNINGS
-
-#ifndef SET_H
-#define BITSEQ_H
-
-#include <memory>
-#include <cassert>
-#include <algorithm>
-#include <iterator>
-
-template <typename T>
-struct set {
-
-private:
-
-	struct base_node {
-		base_node* left;
-		base_node* right;
-		base_node *parent;
-
-		base_node()
-			: left(nullptr), right(nullptr), parent(nullptr)
-		{}
-
-		base_node(base_node * parent)
-			: left(nullptr), right(nullptr), parent(parent)
-		{}
-
-		base_node(base_node* left, base_node* right, base_node * par)
-			: left(left), right(right), parent(par)
-		{}
-
-		virtual ~base_node() {
-			delete left;
-			delete right;
-		}
-	};
-	struct node : base_node {
-		T value;
-
-		node(T const& value)
-			: set::base_node(), value(value)
-		{}
-
-		node(base_node * parent, T const& value)
-			: base_node(parent), value(value)
-		{}
-
-		node(base_node* left, base_node* right, base_node* par, const T& data)
-			: base_node(left, right, par), value(data)
-		{}
-	};
-
-	base_node root;
-
-	base_node * get_root() const;
-
-public:
-
-	set() : root() {};
-	set(set const &other);
-	set& operator=(set rhs) noexcept;
-	~set();
-
-	base_node * destroy(base_node * cur_node) {
-		if (cur_node != nullptr) {
-			if (cur_node->left == nullptr && cur_node->right == nullptr) {
-				delete cur_node;
-				return nullptr;
-			}
-			cur_node->left = destroy(cur_node->left);
-			cur_node->right = destroy(cur_node->right);
-
-			if (cur_node->left == nullptr && cur_node->right == nullptr) {
-				delete cur_node;
-				return nullptr;
-			}
-			return cur_node;
-		}
-		else {
-			return cur_node;
-		}
-	}
-
-	void swap(set<T> &other) noexcept;
-
-	/*
-	* === === === === === === === === === === === === === === ===
-	*                      I T E R A T O R S
-	* === === === === === === === === === === === === === === ===
-	*/
-
-	template <typename U>
-	class Iterator {
-	public:
-		friend struct set;
-
-		using difference_type = std::ptrdiff_t;
-		using value_type = U;
-		using pointer = U * ;
-		using reference = U & ;
-		using iterator_category = std::bidirectional_iterator_tag;
-
-		Iterator() : Ptr_(nullptr)
-		{}
-
-		explicit Iterator(base_node* Ptr_) : Ptr_(Ptr_)
-		{}
-
-		template <typename V>
-		Iterator(Iterator<V> const& other);
-
-		Iterator& operator=(Iterator const& other) {
-			Ptr_ = other.Ptr_;
-			return *this;
-		}
-
-		pointer operator->() const {
-			return &(static_cast<node *>(Ptr_))->value;
-		}
-
-		reference operator*() const {
-			return (static_cast<node*>(Ptr_))->value;
-		}
-
-		Iterator& operator++() {
-			Ptr_ = next_node(Ptr_);
-			return *this;
-		}
-
-		Iterator operator++(int) {
-			auto tmp(*this);
-			++(*this);
-			return tmp;
-		}
-
-		Iterator& operator--() {
-			if (Ptr_->left) {
-				Ptr_ = Ptr_->left;
-				while (Ptr_->right)
-					Ptr_ = Ptr_->right;
-			}
-			else {
-				while (Ptr_->parent->left == Ptr_)
-					Ptr_ = Ptr_->parent;
-				Ptr_ = Ptr_->parent;
-			}
-			return *this;
-		}
-
-		Iterator operator--(int) {
-			auto tmp(*this);
-			--(*this);
-			return tmp;
-		}
-
-		friend bool operator==(const Iterator& lhs, const Iterator& rhs) {
-			return lhs.Ptr_ == rhs.Ptr_;
-		}
-		friend bool operator!=(const Iterator& lhs, const Iterator& rhs) {
-			return lhs.Ptr_ != rhs.Ptr_;
-		}
-
-	private:
-
-		base_node * Ptr_;
-	};
-
-	using iterator = Iterator<const T>;
-	using const_iterator = Iterator<const T>;
-	using reverse_iterator = std::reverse_iterator<iterator>;
-	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
-
-	iterator begin() const;
-	iterator end() const;
-	const_iterator cbegin() const;
-	const_iterator cend() const;
-	reverse_iterator rbegin() const { return reverse_iterator(end()); }
-	reverse_iterator rend() const { return reverse_iterator(begin()); }
-	const_reverse_iterator crbegin() const { return const_reverse_iterator(end()); }
-	const_reverse_iterator crend() const { return const_reverse_iterator(begin()); }
-
-	/*
-	 * === === === === === === === === === === === === === === ===
-	 *                 C O M M O N  M E T H O D S
-	 * === === === === === === === === === === === === === === ===
-	 */
-
-	const_iterator find(T const &value) const {
-		return find_dfs(root.left, value);	
-	}
-
-	const_iterator lower_bound(T const &value) const {
-		const_iterator result = end();
-		base_node * current = root.left;
-
-		while (current != nullptr) {
-			T cur_value = static_cast<node*>(current)->value;
-			if (value < cur_value || (!(cur_value < value) && !(value < cur_value))) {
-				if (result == end() || cur_value < *result) {
-					result = const_iterator(current);
-				}
-				current = current->left;
-			}
-			else {
-				current = current->right;
-			}
-		}
-		return result;
-	}
-	const_iterator upper_bound(T const &value) const {
-		const_iterator result = end();
-		base_node * cur = root.left;
-
-		while (cur != nullptr) {
-			T cur_value = static_cast<node*>(cur)->value;
-			if (value < cur_value) {
-				if (result == end() || cur_value < *result) {
-					result = const_iterator(cur);
-				}
-				cur = cur->left;
-			}
-			else {
-				cur = cur->right;
-			}
-		}
-		return result;
-	}
-
-	bool empty() const {
-		return root.left == nullptr;
-	}
-
-	void clear() {
-		//destroy(root.left);
-		delete root.left;
-		root.left = nullptr;
-	}
-
-	std::pair<iterator, bool> insert(T const &value)
-	{
-		if (root.left == nullptr) {
-			root.left = new node(&root, value);
-			return { iterator(root.left), true };
-		}
-		base_node * cur = root.left;
-		while (true) {
-			if (static_cast<node*>(cur)->value == value)
-				return { iterator(cur), false };
-			if (static_cast<node*>(cur)->value > value) {
-				if (cur->left)
-					cur = cur->left;
-				else {
-					cur->left = new node(cur, value);
-					return { iterator(cur->left), true };
-				}
-			}
-			if (static_cast<node*>(cur)->value < value) {
-				if (cur->right)
-					cur = cur->right;
-				else {
-					cur->right = new node(cur, value);
-					return { iterator(cur->right), true };
-				}
-			}
-		}
-	}
-
-	iterator erase(const_iterator pos) {
-		iterator ret = pos;
-		++ret;
-
-		if (pos.Ptr_->left && pos.Ptr_->right) {
-			auto next = pos;
-			++next;
-			const_iterator cur = detach(next);
-
-			if (pos.Ptr_->parent->left == pos.Ptr_)
-				pos.Ptr_->parent->left = cur.Ptr_;
-			else
-				pos.Ptr_->parent->right = cur.Ptr_;
-
-			if (pos.Ptr_->right)
-				pos.Ptr_->right->parent = cur.Ptr_;
-			if (pos.Ptr_->left)
-				pos.Ptr_->left->parent = cur.Ptr_;
-
-			cur.Ptr_->parent = pos.Ptr_->parent;
-			cur.Ptr_->left = pos.Ptr_->left;
-			cur.Ptr_->right = pos.Ptr_->right;
-		}
-		else {
-			detach(pos);
-		}
-		pos.Ptr_->right = pos.Ptr_->left = nullptr;
-		delete pos.Ptr_;
-		return ret;
-	}
-
-private:
-	/*
-	* === === === === === === === === === === === === === === ===
-	*                L O C A L  O P E R A T I O N S
-	* === === === === === === === === === === === === === === ===
-	*/
-
-	const_iterator find_dfs(base_node * cur, T const &val) const {
-		if (cur == nullptr) {
-			return end();
-		}
-		T cur_value = static_cast<node*>(cur)->value;
-		if (!(cur_value < val) && !(val < cur_value)) {
-			return const_iterator(cur);
-		}
-		if (val < static_cast<node*>(cur)->value) {
-			return find_dfs(cur->left, val);
-		}
-		return find_dfs(cur->right, val);
-	}
-
-	static const_iterator detach(const_iterator iter)
-	{
-		if (!iter.Ptr_->left && !iter.Ptr_->right)
-		{
-			if (iter.Ptr_->parent->left == iter.Ptr_)
-				iter.Ptr_->parent->left = nullptr;
-			else
-				iter.Ptr_->parent->right = nullptr;
-		}
-		else if (!iter.Ptr_->left && iter.Ptr_->right)
-		{
-			if (iter.Ptr_->parent->left == iter.Ptr_)
-				iter.Ptr_->parent->left = iter.Ptr_->right;
-			else
-				iter.Ptr_->parent->right = iter.Ptr_->right;
-			iter.Ptr_->right->parent = iter.Ptr_->parent;
-		}
-		else if (iter.Ptr_->left && !iter.Ptr_->right)
-		{
-			if (iter.Ptr_->parent->left == iter.Ptr_)
-				iter.Ptr_->parent->left = iter.Ptr_->left;
-			else
-				iter.Ptr_->parent->right = iter.Ptr_->left;
-			iter.Ptr_->left->parent = iter.Ptr_->parent;
-		}
-		return iter;
-	}
-
-	static base_node * minimum(base_node * cur) {
-		if (cur->left == nullptr)
-			return cur;
-		return minimum(cur->left);
-	}
-
-	static base_node * next_node(base_node * cur) {
-		if (cur->right != nullptr)
-			return minimum(cur->right);
-
-		base_node *y = cur->parent;
-		while (y != nullptr && cur == y->right) {
-			cur = y;
-			y = y->parent;
-		}
-		return y;
-	}
-};
-
-template<typename T>
-void set<T>::swap(set<T> &other) noexcept
-{
-	if (root.left && other.root.left)
-		std::swap(root.left->parent, other.root.left->parent);
-	else if (root.left)
-		root.left->parent = &other.root;
-	else if (other.root.left)
-		other.root.left->parent = &root;
-	std::swap(root.left, other.root.left);
-}
-
-template <typename T>
-void swap(set<T> &lhs, set<T> &rhs) noexcept {
-	lhs.swap(rhs);
-}
-
-template<typename T>
-set<T>::set(const set &other) : root() {
-	for (auto x : other) {
-		insert(x);
-	}
-}
-
-template<typename T>
-set<T>& set<T>::operator=(set<T> rhs) noexcept {
-	swap(rhs);
-	return *this;
-}
-
-template<typename T>
-set<T>::~set() {
-	//destroy(real_root());
-	delete root.left;
-	root.left = nullptr;
-}
-
-template<typename T>
-typename set<T>::iterator set<T>::begin() const {
-	base_node * cur = get_root();
-	while (cur->left)
-		cur = cur->left;
-	return set<T>::iterator(cur);
-}
-
-template<typename T>
-typename set<T>::iterator set<T>::end() const {
-	return set<T>::iterator(get_root());
-}
-
-template<typename T>
-typename set<T>::const_iterator set<T>::cbegin() const {
-	return set::const_iterator(begin());
-}
-
-template<typename T>
-typename set<T>::const_iterator set<T>::cend() const {
-	return set::const_iterator(end());
-}
-
-template<typename T>
-typename set<T>::base_node *set<T>::get_root() const {
-	return const_cast<typename set<T>::base_node*>(&root);
-}
-
+#define _SCL_SECURE_NO_WARNINGS
+
+#ifndef SET_H
+#define SET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <cassert>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "thread_pool.h"
+
+namespace myset_detail {
+
+	/*
+	* Stores a possibly empty comparator or allocator without spending a byte on it.
+	*/
+	template <typename U, int Tag, bool = std::is_empty<U>::value && !std::is_final<U>::value>
+	struct ebo_holder : private U {
+		ebo_holder() = default;
+		explicit ebo_holder(U const& value) : U(value) {}
+
+		U & get() noexcept { return *this; }
+		U const & get() const noexcept { return *this; }
+	};
+
+	template <typename U, int Tag>
+	struct ebo_holder<U, Tag, false> {
+		ebo_holder() : value() {}
+		explicit ebo_holder(U const& value) : value(value) {}
+
+		U & get() noexcept { return value; }
+		U const & get() const noexcept { return value; }
+
+	private:
+		U value;
+	};
+
+	enum rb_color : bool { red = false, black = true };
+
+	struct set_base_node {
+		set_base_node* left;
+		set_base_node* right;
+		set_base_node *parent;
+		std::size_t size;
+		rb_color color;
+
+		set_base_node()
+			: left(nullptr), right(nullptr), parent(nullptr), size(1), color(black)
+		{}
+	};
+
+	/*
+	* The end() node. left is the tree root; leftmost and rightmost cache the
+	* extreme nodes (the header itself when empty). A size of 0, which no
+	* element node has, tells iterators they are standing on the header.
+	*/
+	struct set_header : set_base_node {
+		set_base_node * leftmost;
+		set_base_node * rightmost;
+
+		set_header()
+			: leftmost(this), rightmost(this)
+		{
+			size = 0;
+		}
+
+		set_header(set_header const&) = delete;
+		set_header& operator=(set_header const&) = delete;
+	};
+
+	template <typename T>
+	struct set_node : set_base_node {
+		T value;
+
+		template <typename... Args>
+		explicit set_node(Args&&... args)
+			: set_base_node(), value(std::forward<Args>(args)...)
+		{}
+	};
+
+	template <typename A, typename = void>
+	struct has_release : std::false_type {};
+
+	template <typename A>
+	struct has_release<A, decltype(std::declval<A&>().release())> : std::true_type {};
+
+	inline void prefetch(void const * address) {
+#if defined(__GNUC__)
+		__builtin_prefetch(address);
+#else
+		(void)address;
+#endif
+	}
+
+} // namespace myset_detail
+
+/*
+* Tag for constructors that trust their input to be sorted and duplicate-free.
+*/
+struct assume_sorted_unique_t {
+	explicit assume_sorted_unique_t() = default;
+};
+
+inline constexpr assume_sorted_unique_t assume_sorted_unique{};
+
+/*
+* Whether allocate and deallocate of A may run on several threads at once.
+* The thread_pool overloads of set only allocate or free nodes in parallel
+* when it holds. is_always_equal says nothing about this: a stateless
+* allocator may still bump a shared counter. Specialize it to opt in.
+*/
+template <typename A>
+struct allows_concurrent_allocation : std::false_type {};
+
+template <typename U>
+struct allows_concurrent_allocation<std::allocator<U>> : std::true_type {};
+
+/*
+* === === === === === === === === === === === === === === ===
+*                    S T A T S  P O L I C I E S
+* === === === === === === === === === === === === === === ===
+*
+* set's fourth template parameter decides what the tree reports about
+* itself. A policy is notified of every comparison, node allocation, node
+* free and rotation, and opens a scope around every find, insert and
+* lower_bound. The hooks are const: lookups on a const set report too.
+*/
+
+enum class set_operation { find, insert, lower_bound };
+
+/*
+* The default: empty hooks that inline away, and no storage in the set.
+*/
+struct no_stats {
+	static constexpr bool enabled = false;
+
+	struct scope {
+		scope(no_stats const &, set_operation) {}
+	};
+
+	void compared() const {}
+	void allocated() const {}
+	void freed() const {}
+	void rotated() const {}
+};
+
+/*
+* What set::stats() returns. comparisons counts every comparison the set
+* made, including those of operations without their own entry (erase,
+* range insert, set algebra, ...).
+*/
+struct set_stats {
+	struct operation {
+		std::uint64_t calls = 0;
+		std::uint64_t comparisons = 0;
+	};
+
+	operation find;
+	operation insert;
+	operation lower_bound;
+	std::uint64_t comparisons = 0;
+	std::uint64_t allocations = 0;
+	std::uint64_t frees = 0;
+	std::uint64_t rotations = 0;
+	std::size_t size = 0;
+	std::size_t height = 0;
+	// depth_histogram[d] is the number of elements at depth d; the root is at depth 0.
+	std::vector<std::size_t> depth_histogram;
+};
+
+namespace myset_detail {
+
+	/*
+	* Counter bumped with a relaxed load and store instead of a locked add:
+	* as cheap as a plain increment, safe under concurrent lookups, but
+	* increments racing on one counter may be lost.
+	*/
+	struct stat_counter {
+		stat_counter() : value(0) {}
+		stat_counter(stat_counter const &) : value(0) {}
+		stat_counter& operator=(stat_counter const &) { return *this; }
+
+		void add(std::uint64_t n = 1) const {
+			value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+		}
+
+		std::uint64_t get() const {
+			return value.load(std::memory_order_relaxed);
+		}
+
+		void reset() const {
+			value.store(0, std::memory_order_relaxed);
+		}
+
+	private:
+		mutable std::atomic<std::uint64_t> value;
+	};
+
+} // namespace myset_detail
+
+/*
+* Counts everything a policy can see. Counters belong to one set object:
+* copies and moved-to sets start from zero. Under concurrent lookups the
+* counts are approximate, and an operation's comparisons may include some
+* made by another thread at the same time.
+*/
+struct counting_stats {
+	static constexpr bool enabled = true;
+
+	struct scope {
+		scope(counting_stats const &stats, set_operation op)
+			: made_(stats.operations_[static_cast<int>(op)].comparisons), total_(stats.comparisons_), start_(stats.comparisons_.get())
+		{
+			stats.operations_[static_cast<int>(op)].calls.add();
+		}
+
+		~scope() {
+			made_.add(total_.get() - start_);
+		}
+
+		scope(scope const &) = delete;
+		scope& operator=(scope const &) = delete;
+
+	private:
+		myset_detail::stat_counter const &made_;
+		myset_detail::stat_counter const &total_;
+		std::uint64_t start_;
+	};
+
+	void compared() const { comparisons_.add(); }
+	void allocated() const { allocations_.add(); }
+	void freed() const { frees_.add(); }
+	void rotated() const { rotations_.add(); }
+
+	/*
+	* Fills in the counters of out; size and shape are left to the set.
+	*/
+	void read(set_stats &out) const {
+		set_stats::operation * ops[] = { &out.find, &out.insert, &out.lower_bound };
+		for (int i = 0; i < 3; i++) {
+			ops[i]->calls = operations_[i].calls.get();
+			ops[i]->comparisons = operations_[i].comparisons.get();
+		}
+		out.comparisons = comparisons_.get();
+		out.allocations = allocations_.get();
+		out.frees = frees_.get();
+		out.rotations = rotations_.get();
+	}
+
+	void reset() const {
+		for (operation_counters const &op : operations_) {
+			op.calls.reset();
+			op.comparisons.reset();
+		}
+		comparisons_.reset();
+		allocations_.reset();
+		frees_.reset();
+		rotations_.reset();
+	}
+
+private:
+	struct operation_counters {
+		myset_detail::stat_counter calls;
+		myset_detail::stat_counter comparisons;
+	};
+
+	operation_counters operations_[3];
+	myset_detail::stat_counter comparisons_;
+	myset_detail::stat_counter allocations_;
+	myset_detail::stat_counter frees_;
+	myset_detail::stat_counter rotations_;
+};
+
+/*
+* Hands every number of s to emit(name, value) as a flat list of metrics
+* ("find.calls", "rotations", "depth.3", ...), for forwarding to a metrics
+* pipeline.
+*/
+template <typename Emit>
+void export_stats(set_stats const &s, Emit &&emit) {
+	std::pair<char const *, set_stats::operation const *> const ops[] = {
+		{ "find", &s.find }, { "insert", &s.insert }, { "lower_bound", &s.lower_bound }
+	};
+	for (auto const &op : ops) {
+		emit(std::string(op.first) + ".calls", op.second->calls);
+		emit(std::string(op.first) + ".comparisons", op.second->comparisons);
+	}
+	emit(std::string("comparisons"), s.comparisons);
+	emit(std::string("allocations"), s.allocations);
+	emit(std::string("frees"), s.frees);
+	emit(std::string("rotations"), s.rotations);
+	emit(std::string("size"), static_cast<std::uint64_t>(s.size));
+	emit(std::string("height"), static_cast<std::uint64_t>(s.height));
+	for (std::size_t d = 0; d < s.depth_histogram.size(); d++)
+		emit("depth." + std::to_string(d), static_cast<std::uint64_t>(s.depth_histogram[d]));
+}
+
+template <typename T, typename Compare = std::less<T>>
+struct frozen_set;
+
+template <typename T, typename Compare = std::less<T>, typename Alloc = std::allocator<T>, typename Stats = no_stats>
+struct set
+	: private myset_detail::ebo_holder<Compare, 0>
+	, private myset_detail::ebo_holder<typename std::allocator_traits<Alloc>::template rebind_alloc<myset_detail::set_node<T>>, 1>
+	, private myset_detail::ebo_holder<Stats, 2> {
+
+private:
+
+	using rb_color = myset_detail::rb_color;
+	using base_node = myset_detail::set_base_node;
+	using header_node = myset_detail::set_header;
+	using node = myset_detail::set_node<T>;
+
+	static constexpr rb_color red = myset_detail::red;
+	static constexpr rb_color black = myset_detail::black;
+
+	using node_allocator = typename std::allocator_traits<Alloc>::template rebind_alloc<node>;
+	using node_traits = std::allocator_traits<node_allocator>;
+	using compare_base = myset_detail::ebo_holder<Compare, 0>;
+	using alloc_base = myset_detail::ebo_holder<node_allocator, 1>;
+	using stats_base = myset_detail::ebo_holder<Stats, 2>;
+	using stats_scope = typename Stats::scope;
+
+	header_node root;
+
+	base_node * get_root() const;
+
+public:
+
+	using key_type = T;
+	using value_type = T;
+	using size_type = std::size_t;
+	using key_compare = Compare;
+	using value_compare = Compare;
+	using allocator_type = typename std::allocator_traits<Alloc>::template rebind_alloc<T>;
+
+	set() : root() {};
+	explicit set(Compare const &comp, Alloc const &alloc = Alloc())
+		: compare_base(comp), alloc_base(node_allocator(alloc)), root()
+	{}
+	explicit set(Alloc const &alloc)
+		: compare_base(), alloc_base(node_allocator(alloc)), root()
+	{}
+	set(set const &other);
+	set(set &&other) noexcept;
+
+	/*
+	* Builds the set from [first, last). A sorted, duplicate-free forward range
+	* is linked into a balanced tree in O(n); anything else is inserted one by one.
+	*/
+	template <typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+	set(InputIt first, InputIt last);
+
+	/*
+	* Links an already sorted, duplicate-free range in O(n) without a single
+	* comparison. Passing anything else breaks the set's invariants.
+	*/
+	template <typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+	set(assume_sorted_unique_t, InputIt first, InputIt last, Compare const &comp = Compare(), Alloc const &alloc = Alloc());
+
+	/*
+	* Links the n sorted, duplicate-free elements starting at first in O(n).
+	* first is advanced exactly n times, so it may be a single-pass iterator.
+	*/
+	template <typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+	set(assume_sorted_unique_t, InputIt first, size_type n, Compare const &comp = Compare(), Alloc const &alloc = Alloc());
+
+	/*
+	* Builds the set from an arbitrary batch on pool: the batch is copied,
+	* merge-sorted and deduplicated in parallel and the tree is linked in
+	* parallel subtrees. Of equivalent elements the first one is kept.
+	* Nodes are only allocated concurrently when allows_concurrent_allocation
+	* holds for the allocator; otherwise allocation runs on the calling thread.
+	*/
+	template <typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+	set(thread_pool &pool, InputIt first, InputIt last, Compare const &comp = Compare(), Alloc const &alloc = Alloc());
+	set& operator=(set const &rhs);
+	set& operator=(set &&rhs) noexcept(std::allocator_traits<node_allocator>::propagate_on_container_move_assignment::value
+		|| std::allocator_traits<node_allocator>::is_always_equal::value);
+	~set();
+
+	void swap(set &other) noexcept;
+
+	allocator_type get_allocator() const {
+		return allocator_type(alloc_base::get());
+	}
+
+	key_compare key_comp() const {
+		return compare_base::get();
+	}
+
+	value_compare value_comp() const {
+		return compare_base::get();
+	}
+
+	/*
+	* === === === === === === === === === === === === === === ===
+	*                      I T E R A T O R S
+	* === === === === === === === === === === === === === === ===
+	*/
+
+	template <typename U>
+	class Iterator {
+	public:
+		friend struct set;
+
+		using difference_type = std::ptrdiff_t;
+		using value_type = U;
+		using pointer = U * ;
+		using reference = U & ;
+		using iterator_category = std::bidirectional_iterator_tag;
+
+		Iterator() : Ptr_(nullptr)
+		{}
+
+		explicit Iterator(base_node* Ptr_) : Ptr_(Ptr_)
+		{}
+
+		template <typename V>
+		Iterator(Iterator<V> const& other);
+
+		Iterator& operator=(Iterator const& other) {
+			Ptr_ = other.Ptr_;
+			return *this;
+		}
+
+		pointer operator->() const {
+			return &(static_cast<node *>(Ptr_))->value;
+		}
+
+		reference operator*() const {
+			return (static_cast<node*>(Ptr_))->value;
+		}
+
+		Iterator& operator++() {
+			Ptr_ = next_node(Ptr_);
+			return *this;
+		}
+
+		Iterator operator++(int) {
+			auto tmp(*this);
+			++(*this);
+			return tmp;
+		}
+
+		Iterator& operator--() {
+			if (Ptr_->size == 0) {
+				Ptr_ = static_cast<header_node*>(Ptr_)->rightmost;
+			}
+			else if (Ptr_->left) {
+				Ptr_ = Ptr_->left;
+				while (Ptr_->right)
+					Ptr_ = Ptr_->right;
+			}
+			else {
+				while (Ptr_->parent->left == Ptr_)
+					Ptr_ = Ptr_->parent;
+				Ptr_ = Ptr_->parent;
+			}
+			return *this;
+		}
+
+		Iterator operator--(int) {
+			auto tmp(*this);
+			--(*this);
+			return tmp;
+		}
+
+		friend bool operator==(const Iterator& lhs, const Iterator& rhs) {
+			return lhs.Ptr_ == rhs.Ptr_;
+		}
+		friend bool operator!=(const Iterator& lhs, const Iterator& rhs) {
+			return lhs.Ptr_ != rhs.Ptr_;
+		}
+
+	private:
+
+		base_node * Ptr_;
+	};
+
+	using iterator = Iterator<const T>;
+	using const_iterator = Iterator<const T>;
+	using reverse_iterator = std::reverse_iterator<iterator>;
+	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+	iterator begin() const;
+	iterator end() const;
+	const_iterator cbegin() const;
+	const_iterator cend() const;
+	reverse_iterator rbegin() const { return reverse_iterator(end()); }
+	reverse_iterator rend() const { return reverse_iterator(begin()); }
+	const_reverse_iterator crbegin() const { return const_reverse_iterator(end()); }
+	const_reverse_iterator crend() const { return const_reverse_iterator(begin()); }
+
+	/*
+	 * === === === === === === === === === === === === === === ===
+	 *                 C O M M O N  M E T H O D S
+	 * === === === === === === === === === === === === === === ===
+	 */
+
+	const_iterator find(T const &value) const {
+		stats_scope scope(stats_policy(), set_operation::find);
+		return const_iterator(find_node(value));
+	}
+
+	const_iterator lower_bound(T const &value) const {
+		stats_scope scope(stats_policy(), set_operation::lower_bound);
+		return const_iterator(lower_bound_node(value));
+	}
+
+	const_iterator upper_bound(T const &value) const {
+		return const_iterator(upper_bound_node(value));
+	}
+
+	bool contains(T const &value) const {
+		stats_scope scope(stats_policy(), set_operation::find);
+		return find_node(value) != get_root();
+	}
+
+	size_type count(T const &value) const {
+		return contains(value) ? 1 : 0;
+	}
+
+	/*
+	* Heterogeneous lookup, available when Compare declares is_transparent
+	* (e.g. std::less<>): the key is compared against stored values directly.
+	*/
+	template <typename K, typename C = Compare, typename = typename C::is_transparent>
+	const_iterator find(K const &key) const {
+		stats_scope scope(stats_policy(), set_operation::find);
+		return const_iterator(find_node(key));
+	}
+
+	template <typename K, typename C = Compare, typename = typename C::is_transparent>
+	const_iterator lower_bound(K const &key) const {
+		stats_scope scope(stats_policy(), set_operation::lower_bound);
+		return const_iterator(lower_bound_node(key));
+	}
+
+	template <typename K, typename C = Compare, typename = typename C::is_transparent>
+	const_iterator upper_bound(K const &key) const {
+		return const_iterator(upper_bound_node(key));
+	}
+
+	template <typename K, typename C = Compare, typename = typename C::is_transparent>
+	bool contains(K const &key) const {
+		stats_scope scope(stats_policy(), set_operation::find);
+		return find_node(key) != get_root();
+	}
+
+	template <typename K, typename C = Compare, typename = typename C::is_transparent>
+	size_type count(K const &key) const {
+		return contains(key) ? 1 : 0;
+	}
+
+	/*
+	* === === === === === === === === === === === === === === ===
+	*                 B A T C H E D  L O O K U P
+	* === === === === === === === === === === === === === === ===
+	*
+	* Look up every key of [first, last) and write one result per key to out,
+	* in order. Descents for up to batch_width keys advance in lockstep, one
+	* level per round, each prefetching the node it steps to, so the cache
+	* misses of different keys overlap instead of queueing up one after the
+	* other. Keys are compared against stored values as they are, so with a
+	* comparator that is not transparent they should already be T.
+	*/
+
+	static constexpr std::size_t batch_width = 16;
+
+	template <typename ForwardIt, typename OutputIt>
+	OutputIt find_batch(ForwardIt first, ForwardIt last, OutputIt out) const {
+		lower_bound_batch_impl(first, last, [this, &out](auto const &key, base_node * found) {
+			*out++ = const_iterator(found == get_root() || less(key, value_of(found)) ? get_root() : found);
+		});
+		return out;
+	}
+
+	template <typename ForwardIt, typename OutputIt>
+	OutputIt contains_batch(ForwardIt first, ForwardIt last, OutputIt out) const {
+		lower_bound_batch_impl(first, last, [this, &out](auto const &key, base_node * found) {
+			*out++ = found != get_root() && !less(key, value_of(found));
+		});
+		return out;
+	}
+
+	template <typename ForwardIt, typename OutputIt>
+	OutputIt lower_bound_batch(ForwardIt first, ForwardIt last, OutputIt out) const {
+		lower_bound_batch_impl(first, last, [&out](auto const &, base_node * found) {
+			*out++ = const_iterator(found);
+		});
+		return out;
+	}
+
+	bool empty() const {
+		return root.left == nullptr;
+	}
+
+	size_type size() const {
+		return subtree_size(root.left);
+	}
+
+	/*
+	* === === === === === === === === === === === === === === ===
+	*               O R D E R  S T A T I S T I C S
+	* === === === === === === === === === === === === === === ===
+	*/
+
+	/*
+	* The k-th smallest element (0-based), or end() if k >= size().
+	*/
+	const_iterator nth(size_type k) const {
+		base_node * cur = root.left;
+		while (cur != nullptr) {
+			size_type left = subtree_size(cur->left);
+			if (k < left) {
+				cur = cur->left;
+			}
+			else if (k == left) {
+				return const_iterator(cur);
+			}
+			else {
+				k -= left + 1;
+				cur = cur->right;
+			}
+		}
+		return end();
+	}
+
+	/*
+	* Number of elements less than value.
+	*/
+	size_type rank(T const &value) const {
+		return rank_of(value);
+	}
+
+	template <typename K, typename C = Compare, typename = typename C::is_transparent>
+	size_type rank(K const &key) const {
+		return rank_of(key);
+	}
+
+	/*
+	* Position of pos in sorted order; size() for end().
+	*/
+	size_type index_of(const_iterator pos) const {
+		base_node * cur = pos.Ptr_;
+		if (cur == get_root())
+			return size();
+		size_type index = subtree_size(cur->left);
+		while (cur->parent != get_root()) {
+			if (cur == cur->parent->right)
+				index += subtree_size(cur->parent->left) + 1;
+			cur = cur->parent;
+		}
+		return index;
+	}
+
+	/*
+	* Number of elements in [lo, hi).
+	*/
+	size_type count_range(T const &lo, T const &hi) const {
+		return count_range_of(lo, hi);
+	}
+
+	template <typename K1, typename K2, typename C = Compare, typename = typename C::is_transparent>
+	size_type count_range(K1 const &lo, K2 const &hi) const {
+		return count_range_of(lo, hi);
+	}
+
+	void clear() {
+		destroy(root.left);
+		root.left = nullptr;
+		root.leftmost = root.rightmost = &root;
+		release_storage(myset_detail::has_release<node_allocator>());
+	}
+
+	std::pair<iterator, bool> insert(T const &value) {
+		stats_scope scope(stats_policy(), set_operation::insert);
+		return emplace_key(value, value);
+	}
+
+	std::pair<iterator, bool> insert(T &&value) {
+		stats_scope scope(stats_policy(), set_operation::insert);
+		return emplace_key(value, std::move(value));
+	}
+
+	iterator insert(const_iterator hint, T const &value) {
+		return emplace_hint(hint, value);
+	}
+
+	iterator insert(const_iterator hint, T &&value) {
+		return emplace_hint(hint, std::move(value));
+	}
+
+	/*
+	* Sorted, duplicate-free input is appended through hints or merged with the
+	* existing elements in O(n + m), whichever is cheaper; other input is
+	* inserted element by element.
+	*/
+	template <typename InputIt, typename = typename std::iterator_traits<InputIt>::iterator_category>
+	void insert(InputIt first, InputIt last) {
+		insert_range(first, last, typename std::iterator_traits<InputIt>::iterator_category());
+	}
+
+	/*
+	* Constructs the element in place. When the only argument is already a T
+	* the duplicate check runs first, so a rejected duplicate costs no allocation.
+	*/
+	template <typename... Args>
+	std::pair<iterator, bool> emplace(Args&&... args) {
+		stats_scope scope(stats_policy(), set_operation::insert);
+		return emplace_dispatch(is_key_arg<Args...>(), std::forward<Args>(args)...);
+	}
+
+	/*
+	* Like emplace, but takes O(1) amortized time when the element belongs
+	* immediately before hint.
+	*/
+	template <typename... Args>
+	iterator emplace_hint(const_iterator hint, Args&&... args) {
+		stats_scope scope(stats_policy(), set_operation::insert);
+		return emplace_hint_dispatch(hint, is_key_arg<Args...>(), std::forward<Args>(args)...);
+	}
+
+	iterator erase(const_iterator pos) {
+		base_node * z = pos.Ptr_;
+		iterator ret(next_node(z));
+		unlink_node(z);
+		destroy_node(z);
+		return ret;
+	}
+
+	/*
+	* Removes [first, last) in O(log n + k) for k removed elements: the tree
+	* is split just before first and just before last, the middle part is
+	* freed whole and the outer parts are joined once. Iterators outside the
+	* range stay valid. The comparator must not throw.
+	*/
+	iterator erase(const_iterator first, const_iterator last) {
+		base_node * from = first.Ptr_;
+		base_node * to = last.Ptr_;
+		if (from == to)
+			return iterator(to);
+		if (from == root.leftmost && to == get_root()) {
+			clear();
+			return end();
+		}
+		if (next_node(from) == to)
+			return erase(first);
+		split_result below = split(detach_tree(), value_of(from));
+		destroy_node(below.found);
+		if (to == get_root()) {
+			destroy(below.right);
+			attach_tree(below.left);
+		}
+		else {
+			split_result above = split(below.right, value_of(to));
+			destroy(above.left);
+			attach_tree(join(below.left, above.found, above.right));
+		}
+		return iterator(to);
+	}
+
+	size_type erase(T const &value) {
+		return erase_key(value);
+	}
+
+	template <typename K, typename C = Compare, typename = typename C::is_transparent,
+		typename = std::enable_if_t<!std::is_convertible<K const &, const_iterator>::value>>
+	size_type erase(K const &key) {
+		return erase_key(key);
+	}
+
+	/*
+	* Removes the elements in [lo, hi) and returns how many there were.
+	*/
+	size_type erase_range(T const &lo, T const &hi) {
+		return erase_range_of(lo, hi);
+	}
+
+	template <typename K1, typename K2, typename C = Compare, typename = typename C::is_transparent>
+	size_type erase_range(K1 const &lo, K2 const &hi) {
+		return erase_range_of(lo, hi);
+	}
+
+	/*
+	* Removes the elements satisfying pred and returns how many there were.
+	* pred runs over the whole set before anything changes, so if it throws
+	* the set is untouched. When at least a quarter of the set goes, the
+	* survivors are relinked into a balanced tree in O(n) instead of the
+	* victims being unlinked one at a time.
+	*/
+	template <typename Pred>
+	size_type erase_if(Pred pred) {
+		std::vector<base_node*> doomed;
+		for (base_node * cur = root.leftmost; cur != get_root(); cur = next_node(cur))
+			if (pred(value_of(cur)))
+				doomed.push_back(cur);
+		if (doomed.size() < size() / 4) {
+			for (base_node * z : doomed) {
+				unlink_node(z);
+				destroy_node(z);
+			}
+			return doomed.size();
+		}
+		std::vector<base_node*> kept;
+		kept.reserve(size() - doomed.size());
+		auto next_doomed = doomed.begin();
+		for (base_node * cur = root.leftmost; cur != get_root(); cur = next_node(cur)) {
+			if (next_doomed != doomed.end() && *next_doomed == cur)
+				++next_doomed;
+			else
+				kept.push_back(cur);
+		}
+		for (base_node * z : doomed)
+			destroy_node(z);
+		link_nodes(kept.data(), kept.size());
+		return doomed.size();
+	}
+
+	/*
+	* The smallest and largest elements; both are cached, so these and the
+	* pops below take O(1) amortized time. The set must not be empty.
+	*/
+	T const & front() const {
+		assert(!empty());
+		return value_of(root.leftmost);
+	}
+
+	T const & back() const {
+		assert(!empty());
+		return value_of(root.rightmost);
+	}
+
+	void pop_front() {
+		assert(!empty());
+		erase(const_iterator(root.leftmost));
+	}
+
+	void pop_back() {
+		assert(!empty());
+		erase(const_iterator(root.rightmost));
+	}
+
+	/*
+	* Number of nodes on the longest root-to-leaf path, 0 for an empty set.
+	*/
+	std::size_t height() const {
+		return height(root.left);
+	}
+
+	/*
+	* The stats policy's counters plus the current size, height and depth
+	* histogram; the shape is measured on the spot, in O(n). Needs an enabled
+	* policy such as counting_stats.
+	*/
+	template <typename S = Stats, typename = std::enable_if_t<S::enabled>>
+	set_stats stats() const {
+		set_stats result;
+		stats_policy().read(result);
+		result.size = size();
+		std::vector<std::pair<base_node*, std::size_t>> pending;
+		if (root.left != nullptr)
+			pending.emplace_back(root.left, 0);
+		while (!pending.empty()) {
+			auto [cur, depth] = pending.back();
+			pending.pop_back();
+			if (result.depth_histogram.size() <= depth)
+				result.depth_histogram.resize(depth + 1, 0);
+			++result.depth_histogram[depth];
+			if (cur->left)
+				pending.emplace_back(cur->left, depth + 1);
+			if (cur->right)
+				pending.emplace_back(cur->right, depth + 1);
+		}
+		result.height = result.depth_histogram.size();
+		return result;
+	}
+
+	/*
+	* Zeroes the stats policy's counters.
+	*/
+	template <typename S = Stats, typename = std::enable_if_t<S::enabled>>
+	void reset_stats() {
+		stats_policy().reset();
+	}
+
+	/*
+	* Read-only copy laid out for fast lookups; see frozen_set.h. O(n).
+	*/
+	frozen_set<T, Compare> freeze() const;
+
+	/*
+	* === === === === === === === === === === === === === === ===
+	*          N O D E  H A N D L E S,  S P L I T,  J O I N
+	* === === === === === === === === === === === === === === ===
+	*
+	* All of these relink existing nodes; none of them allocates or copies T.
+	* Moving nodes between sets requires their allocators to compare equal.
+	*/
+
+	class node_handle {
+	public:
+		using value_type = T;
+		using allocator_type = typename set::allocator_type;
+
+		node_handle() noexcept : ptr_(nullptr)
+		{}
+
+		node_handle(node_handle &&other) noexcept
+			: ptr_(other.ptr_), alloc_(std::move(other.alloc_))
+		{
+			other.ptr_ = nullptr;
+			other.alloc_.reset();
+		}
+
+		node_handle& operator=(node_handle &&other) noexcept {
+			if (this != &other) {
+				reset();
+				ptr_ = other.ptr_;
+				alloc_ = std::move(other.alloc_);
+				other.ptr_ = nullptr;
+				other.alloc_.reset();
+			}
+			return *this;
+		}
+
+		~node_handle() {
+			reset();
+		}
+
+		bool empty() const noexcept {
+			return ptr_ == nullptr;
+		}
+
+		explicit operator bool() const noexcept {
+			return ptr_ != nullptr;
+		}
+
+		value_type & value() const {
+			return ptr_->value;
+		}
+
+		allocator_type get_allocator() const {
+			return allocator_type(*alloc_);
+		}
+
+		void swap(node_handle &other) noexcept {
+			std::swap(ptr_, other.ptr_);
+			std::swap(alloc_, other.alloc_);
+		}
+
+		friend void swap(node_handle &lhs, node_handle &rhs) noexcept {
+			lhs.swap(rhs);
+		}
+
+	private:
+		friend struct set;
+
+		node_handle(node * ptr, node_allocator const &alloc)
+			: ptr_(ptr), alloc_(alloc)
+		{}
+
+		node * release() noexcept {
+			node * result = ptr_;
+			ptr_ = nullptr;
+			alloc_.reset();
+			return result;
+		}
+
+		void reset() noexcept {
+			if (ptr_ != nullptr) {
+				node_traits::destroy(*alloc_, ptr_);
+				node_traits::deallocate(*alloc_, ptr_, 1);
+				ptr_ = nullptr;
+			}
+			alloc_.reset();
+		}
+
+		node * ptr_;
+		std::optional<node_allocator> alloc_;
+	};
+
+	using node_type = node_handle;
+
+	struct insert_return_type {
+		iterator position;
+		bool inserted;
+		node_type node;
+	};
+
+	node_type extract(const_iterator pos) {
+		base_node * z = pos.Ptr_;
+		unlink_node(z);
+		z->left = z->right = z->parent = nullptr;
+		z->size = 1;
+		return node_type(static_cast<node*>(z), alloc_base::get());
+	}
+
+	node_type extract(T const &value) {
+		base_node * found = find_node(value);
+		if (found == get_root())
+			return node_type();
+		return extract(const_iterator(found));
+	}
+
+	/*
+	* Links the handle's node into the set; on a duplicate the handle is
+	* handed back untouched in the result.
+	*/
+	insert_return_type insert(node_type &&handle) {
+		if (handle.empty())
+			return { end(), false, node_type() };
+		assert(*handle.alloc_ == alloc_base::get());
+		insert_pos pos = find_insert_pos(handle.ptr_->value);
+		if (pos.existing != nullptr)
+			return { iterator(pos.existing), false, std::move(handle) };
+		base_node * linked = handle.release();
+		link_node(linked, pos);
+		return { iterator(linked), true, node_type() };
+	}
+
+	iterator insert(const_iterator hint, node_type &&handle) {
+		if (handle.empty())
+			return end();
+		assert(*handle.alloc_ == alloc_base::get());
+		insert_pos pos = find_insert_pos(hint, handle.ptr_->value);
+		if (pos.existing != nullptr)
+			return iterator(pos.existing);
+		base_node * linked = handle.release();
+		link_node(linked, pos);
+		return iterator(linked);
+	}
+
+	/*
+	* Moves every node of source whose key is not already here into this set;
+	* duplicates stay behind in source.
+	*/
+	void merge(set &source) {
+		if (&source == this)
+			return;
+		assert(alloc_base::get() == static_cast<alloc_base&>(source).get());
+		base_node * cur = source.leftmost();
+		while (cur != source.get_root()) {
+			base_node * next = next_node(cur);
+			insert_pos pos = find_insert_pos(value_of(cur));
+			if (pos.existing == nullptr) {
+				source.unlink_node(cur);
+				cur->left = cur->right = nullptr;
+				link_node(cur, pos);
+			}
+			cur = next;
+		}
+	}
+
+	void merge(set &&source) {
+		merge(source);
+	}
+
+	/*
+	* Moves the elements into two sets, those less than key and the rest,
+	* leaving this set empty. O(log n).
+	*/
+	std::pair<set, set> split(T const &key) {
+		set below(key_comp(), get_allocator());
+		set above(key_comp(), get_allocator());
+		split_result parts = split(detach_tree(), key);
+		if (parts.found)
+			parts.right = join(subtree{ nullptr, 0 }, parts.found, parts.right);
+		below.attach_tree(parts.left);
+		above.attach_tree(parts.right);
+		return { std::move(below), std::move(above) };
+	}
+
+	/*
+	* Concatenates two sets where every element of left is less than every
+	* element of right, in O(log n).
+	*/
+	static set join(set &&left, set &&right) {
+		assert(left.empty() || right.empty() || left.less(value_of(left.rightmost()), value_of(right.leftmost())));
+		if (static_cast<alloc_base&>(left).get() != static_cast<alloc_base&>(right).get()) {
+			set same_alloc(assume_sorted_unique, right.begin(), right.end(), left.key_comp(), left.get_allocator());
+			return join(std::move(left), std::move(same_alloc));
+		}
+		subtree lower = left.detach_tree();
+		subtree upper = right.detach_tree();
+		left.attach_tree(left.join(lower, upper));
+		return std::move(left);
+	}
+
+private:
+	/*
+	* === === === === === === === === === === === === === === ===
+	*                L O C A L  O P E R A T I O N S
+	* === === === === === === === === === === === === === === ===
+	*/
+
+	static T const & value_of(base_node * cur) {
+		return static_cast<node*>(cur)->value;
+	}
+
+	template <typename K>
+	base_node * lower_bound_node(K const &key) const {
+		base_node * result = get_root();
+		base_node * cur = root.left;
+		while (cur != nullptr) {
+			if (!less(value_of(cur), key)) {
+				result = cur;
+				cur = cur->left;
+			}
+			else {
+				cur = cur->right;
+			}
+		}
+		return result;
+	}
+
+	template <typename K>
+	base_node * upper_bound_node(K const &key) const {
+		base_node * result = get_root();
+		base_node * cur = root.left;
+		while (cur != nullptr) {
+			if (less(key, value_of(cur))) {
+				result = cur;
+				cur = cur->left;
+			}
+			else {
+				cur = cur->right;
+			}
+		}
+		return result;
+	}
+
+	/*
+	* lower_bound_node for a group of keys at a time; emit(key, node) is
+	* called for every key in input order.
+	*/
+	template <typename ForwardIt, typename Emit>
+	void lower_bound_batch_impl(ForwardIt first, ForwardIt last, Emit emit) const {
+		ForwardIt keys[batch_width];
+		base_node * cur[batch_width];
+		base_node * result[batch_width];
+		while (first != last) {
+			std::size_t n = 0;
+			for (; n < batch_width && first != last; ++n, ++first) {
+				keys[n] = first;
+				cur[n] = root.left;
+				result[n] = get_root();
+			}
+			for (bool active = true; active; ) {
+				active = false;
+				for (std::size_t i = 0; i < n; i++) {
+					if (cur[i] == nullptr)
+						continue;
+					bool go_left = !less(value_of(cur[i]), *keys[i]);
+					result[i] = go_left ? cur[i] : result[i];
+					cur[i] = go_left ? cur[i]->left : cur[i]->right;
+					if (cur[i] != nullptr) {
+						myset_detail::prefetch(cur[i]);
+						active = true;
+					}
+				}
+			}
+			for (std::size_t i = 0; i < n; i++)
+				emit(*keys[i], result[i]);
+		}
+	}
+
+	template <typename K>
+	base_node * find_node(K const &key) const {
+		base_node * found = lower_bound_node(key);
+		if (found == get_root() || less(key, value_of(found)))
+			return get_root();
+		return found;
+	}
+
+	struct insert_pos {
+		base_node * parent;
+		bool left;
+		base_node * existing;
+	};
+
+	template <typename... Args>
+	using is_key_arg = std::integral_constant<bool, sizeof...(Args) == 1
+		&& std::conjunction<std::is_same<std::remove_cv_t<std::remove_reference_t<Args>>, T>...>::value>;
+
+	template <typename K>
+	insert_pos find_insert_pos(K const &key) const {
+		base_node * parent = get_root();
+		base_node * cur = root.left;
+		base_node * pred = nullptr;
+		bool go_left = true;
+		while (cur != nullptr) {
+			parent = cur;
+			go_left = less(key, value_of(cur));
+			if (go_left) {
+				cur = cur->left;
+			}
+			else {
+				pred = cur;
+				cur = cur->right;
+			}
+		}
+		if (pred != nullptr && !less(value_of(pred), key))
+			return { nullptr, false, pred };
+		return { parent, go_left, nullptr };
+	}
+
+	/*
+	* Finds where key goes given that it probably belongs right before hint;
+	* falls back to a full descent when the hint is wrong.
+	*/
+	template <typename K>
+	insert_pos find_insert_pos(const_iterator hint, K const &key) const {
+		base_node * pos = hint.Ptr_;
+		if (pos == get_root()) {
+			if (root.left != nullptr && less(value_of(rightmost()), key))
+				return { rightmost(), false, nullptr };
+			return find_insert_pos(key);
+		}
+		if (less(key, value_of(pos))) {
+			if (pos == leftmost())
+				return { pos, true, nullptr };
+			base_node * before = (--hint).Ptr_;
+			if (less(value_of(before), key)) {
+				if (before->right == nullptr)
+					return { before, false, nullptr };
+				return { pos, true, nullptr };
+			}
+			return find_insert_pos(key);
+		}
+		if (less(value_of(pos), key)) {
+			if (pos == rightmost())
+				return { pos, false, nullptr };
+			base_node * after = next_node(pos);
+			if (less(key, value_of(after))) {
+				if (pos->right == nullptr)
+					return { pos, false, nullptr };
+				return { after, true, nullptr };
+			}
+			return find_insert_pos(key);
+		}
+		return { nullptr, false, pos };
+	}
+
+	void link_node(base_node * created, insert_pos const &pos) {
+		for (base_node * cur = pos.parent; cur != get_root(); cur = cur->parent)
+			++cur->size;
+		created->size = 1;
+		created->parent = pos.parent;
+		if (pos.left)
+			pos.parent->left = created;
+		else
+			pos.parent->right = created;
+		if (pos.parent == get_root())
+			root.leftmost = root.rightmost = created;
+		else if (pos.left && pos.parent == root.leftmost)
+			root.leftmost = created;
+		else if (!pos.left && pos.parent == root.rightmost)
+			root.rightmost = created;
+		insert_fixup(created, &root);
+	}
+
+	/*
+	* Takes z out of the tree, keeping the cached extremes current.
+	*/
+	void unlink_node(base_node * z) {
+		base_node * first = root.leftmost;
+		if (z == root.rightmost)
+			root.rightmost = z == first ? get_root() : prev_node(z);
+		if (z == first)
+			root.leftmost = next_node(z);
+		erase_fixup(z, &root);
+	}
+
+	/*
+	* Recomputes the cached extremes after the tree was replaced wholesale.
+	*/
+	void reset_extremes() {
+		root.leftmost = root.left ? minimum(root.left) : get_root();
+		root.rightmost = root.left ? maximum(root.left) : get_root();
+	}
+
+	/*
+	* Takes other's tree and cached extremes in O(1), leaving other empty;
+	* the current tree must be empty and the allocators equal.
+	*/
+	void take_nodes(set &other) noexcept {
+		root.left = other.root.left;
+		if (root.left) {
+			root.left->parent = get_root();
+			root.leftmost = other.root.leftmost;
+			root.rightmost = other.root.rightmost;
+		}
+		other.root.left = nullptr;
+		other.root.leftmost = other.root.rightmost = other.get_root();
+	}
+
+	template <typename K, typename... Args>
+	std::pair<iterator, bool> emplace_key(K const &key, Args&&... args) {
+		insert_pos pos = find_insert_pos(key);
+		if (pos.existing != nullptr)
+			return { iterator(pos.existing), false };
+		base_node * created = create_node(std::forward<Args>(args)...);
+		link_node(created, pos);
+		return { iterator(created), true };
+	}
+
+	template <typename Arg>
+	std::pair<iterator, bool> emplace_dispatch(std::true_type, Arg &&arg) {
+		return emplace_key(arg, std::forward<Arg>(arg));
+	}
+
+	template <typename... Args>
+	std::pair<iterator, bool> emplace_dispatch(std::false_type, Args&&... args) {
+		node * created = create_node(std::forward<Args>(args)...);
+		insert_pos pos;
+		try {
+			pos = find_insert_pos(created->value);
+		}
+		catch (...) {
+			destroy_node(created);
+			throw;
+		}
+		if (pos.existing != nullptr) {
+			destroy_node(created);
+			return { iterator(pos.existing), false };
+		}
+		link_node(created, pos);
+		return { iterator(created), true };
+	}
+
+	template <typename Arg>
+	iterator emplace_hint_dispatch(const_iterator hint, std::true_type, Arg &&arg) {
+		insert_pos pos = find_insert_pos(hint, arg);
+		if (pos.existing != nullptr)
+			return iterator(pos.existing);
+		base_node * created = create_node(std::forward<Arg>(arg));
+		link_node(created, pos);
+		return iterator(created);
+	}
+
+	template <typename... Args>
+	iterator emplace_hint_dispatch(const_iterator hint, std::false_type, Args&&... args) {
+		node * created = create_node(std::forward<Args>(args)...);
+		insert_pos pos;
+		try {
+			pos = find_insert_pos(hint, created->value);
+		}
+		catch (...) {
+			destroy_node(created);
+			throw;
+		}
+		if (pos.existing != nullptr) {
+			destroy_node(created);
+			return iterator(pos.existing);
+		}
+		link_node(created, pos);
+		return iterator(created);
+	}
+
+	base_node * leftmost() const {
+		return root.leftmost;
+	}
+
+	base_node * rightmost() const {
+		return root.rightmost;
+	}
+
+	static size_type subtree_size(base_node * cur) {
+		return cur ? cur->size : 0;
+	}
+
+	static void update_size(base_node * cur) {
+		cur->size = subtree_size(cur->left) + subtree_size(cur->right) + 1;
+	}
+
+	template <typename K>
+	size_type rank_of(K const &key) const {
+		size_type result = 0;
+		base_node * cur = root.left;
+		while (cur != nullptr) {
+			if (less(value_of(cur), key)) {
+				result += subtree_size(cur->left) + 1;
+				cur = cur->right;
+			}
+			else {
+				cur = cur->left;
+			}
+		}
+		return result;
+	}
+
+	template <typename K1, typename K2>
+	size_type count_range_of(K1 const &lo, K2 const &hi) const {
+		size_type below_hi = rank_of(hi);
+		size_type below_lo = rank_of(lo);
+		return below_hi > below_lo ? below_hi - below_lo : 0;
+	}
+
+	template <typename K>
+	size_type erase_key(K const &key) {
+		base_node * found = find_node(key);
+		if (found == get_root())
+			return 0;
+		unlink_node(found);
+		destroy_node(found);
+		return 1;
+	}
+
+	template <typename K1, typename K2>
+	size_type erase_range_of(K1 const &lo, K2 const &hi) {
+		size_type count = count_range_of(lo, hi);
+		if (count != 0)
+			erase(const_iterator(lower_bound_node(lo)), const_iterator(lower_bound_node(hi)));
+		return count;
+	}
+
+	template <typename L, typename R>
+	bool less(L const &lhs, R const &rhs) const {
+		stats_policy().compared();
+		return compare_base::get()(lhs, rhs);
+	}
+
+	Stats const & stats_policy() const {
+		return stats_base::get();
+	}
+
+	template <typename... Args>
+	node * create_node(Args&&... args) {
+		node_allocator &alloc = alloc_base::get();
+		node * created = node_traits::allocate(alloc, 1);
+		try {
+			node_traits::construct(alloc, created, std::forward<Args>(args)...);
+		}
+		catch (...) {
+			node_traits::deallocate(alloc, created, 1);
+			throw;
+		}
+		stats_policy().allocated();
+		return created;
+	}
+
+	void destroy_node(base_node * cur) {
+		stats_policy().freed();
+		node_allocator &alloc = alloc_base::get();
+		node_traits::destroy(alloc, static_cast<node*>(cur));
+		node_traits::deallocate(alloc, static_cast<node*>(cur), 1);
+	}
+
+	void release_storage(std::true_type) {
+		alloc_base::get().release();
+	}
+
+	void release_storage(std::false_type) {
+	}
+
+	/*
+	* Frees a detached subtree in O(n) time and O(1) stack: left children are
+	* rotated up until the current node has none, at which point it is freed
+	* and the walk continues down its right spine.
+	*/
+	void destroy(base_node * cur) {
+		while (cur != nullptr) {
+			base_node * left = cur->left;
+			if (left != nullptr) {
+				cur->left = left->right;
+				left->right = cur;
+				cur = left;
+			}
+			else {
+				base_node * right = cur->right;
+				destroy_node(cur);
+				cur = right;
+			}
+		}
+	}
+
+	template <typename InputIt>
+	void insert_range(InputIt first, InputIt last, std::input_iterator_tag) {
+		for (; first != last; ++first)
+			insert(*first);
+	}
+
+	template <typename ForwardIt>
+	void insert_range(ForwardIt first, ForwardIt last, std::forward_iterator_tag) {
+		if (first == last)
+			return;
+		if (std::adjacent_find(first, last, [this](T const &a, T const &b) { return !less(a, b); }) != last) {
+			insert_range(first, last, std::input_iterator_tag());
+			return;
+		}
+		size_type m = static_cast<size_type>(std::distance(first, last));
+		size_type n = size();
+		if (n == 0) {
+			link_sorted(first, m);
+			return;
+		}
+		size_type log_n = 0;
+		while ((size_type(1) << log_n) < n)
+			++log_n;
+		if (m * log_n <= n + m || less(value_of(rightmost()), *first)) {
+			// Few elements, or a pure append: walk forward from the previous insertion point.
+			const_iterator hint = lower_bound(*first);
+			for (; first != last; ++first) {
+				hint = emplace_hint(hint, *first);
+				++hint;
+			}
+			return;
+		}
+		merge_sorted(first, m);
+	}
+
+	/*
+	* Merges m sorted, unique elements into the tree in O(n + m): existing nodes
+	* are kept (so iterators stay valid) and everything is relinked at once.
+	*/
+	template <typename ForwardIt>
+	void merge_sorted(ForwardIt first, size_type m) {
+		std::vector<base_node*> merged;
+		std::vector<base_node*> fresh;
+		merged.reserve(size() + m);
+		fresh.reserve(m);
+		try {
+			base_node * cur = leftmost();
+			for (size_type i = 0; i < m; ++i, ++first) {
+				while (cur != get_root() && less(value_of(cur), *first)) {
+					merged.push_back(cur);
+					cur = next_node(cur);
+				}
+				if (cur != get_root() && !less(*first, value_of(cur)))
+					continue;
+				fresh.push_back(nullptr);
+				fresh.back() = create_node(*first);
+				merged.push_back(fresh.back());
+			}
+			for (; cur != get_root(); cur = next_node(cur))
+				merged.push_back(cur);
+		}
+		catch (...) {
+			for (base_node * created : fresh)
+				if (created != nullptr)
+					destroy_node(created);
+			throw;
+		}
+		link_nodes(merged.data(), merged.size());
+	}
+
+	/*
+	* Replaces the (empty) tree with the n sorted, unique elements starting at first.
+	*/
+	template <typename InputIt>
+	void link_sorted(InputIt first, size_type n) {
+		auto next = [this, &first]() -> base_node * {
+			base_node * created = create_node(*first);
+			++first;
+			return created;
+		};
+		link_balanced(next, n);
+	}
+
+	/*
+	* Relinks n detached nodes, given in sorted order, into a balanced tree that
+	* replaces the current one. Never allocates or compares.
+	*/
+	void link_nodes(base_node * const * nodes, size_type n) {
+		auto next = [&nodes]() { return *nodes++; };
+		link_balanced(next, n);
+	}
+
+	template <typename NextNode>
+	void link_balanced(NextNode &next, size_type n) {
+		std::size_t red_depth = 0;
+		while ((std::size_t(2) << red_depth) <= n + 1)
+			++red_depth;
+		root.left = build_sorted(next, n, 0, red_depth);
+		if (root.left)
+			root.left->parent = &root;
+		reset_extremes();
+	}
+
+	/*
+	* Links the next n nodes into a subtree whose subtree sizes differ by at most one,
+	* so every leaf sits at depth red_depth - 1 or red_depth. Coloring exactly the
+	* nodes at red_depth red gives a valid red-black tree without any rotations.
+	*/
+	template <typename NextNode>
+	base_node * build_sorted(NextNode &next, size_type n, std::size_t depth, std::size_t red_depth) {
+		if (n == 0)
+			return nullptr;
+		base_node * left = build_sorted(next, n / 2, depth + 1, red_depth);
+		base_node * cur;
+		try {
+			cur = next();
+		}
+		catch (...) {
+			destroy(left);
+			throw;
+		}
+		cur->left = left;
+		if (left)
+			left->parent = cur;
+		try {
+			cur->right = build_sorted(next, n - n / 2 - 1, depth + 1, red_depth);
+		}
+		catch (...) {
+			cur->right = nullptr;
+			destroy(cur);
+			throw;
+		}
+		if (cur->right)
+			cur->right->parent = cur;
+		cur->size = n;
+		cur->color = depth == red_depth ? red : black;
+		return cur;
+	}
+
+	/*
+	* build_sorted over an array of detached nodes, linking both halves of
+	* large subtrees concurrently. Gives exactly the tree build_sorted would.
+	*/
+	static base_node * build_linked(thread_pool &pool, base_node * const * nodes, size_type n, std::size_t depth, std::size_t red_depth) {
+		if (n == 0)
+			return nullptr;
+		base_node * cur = nodes[n / 2];
+		auto link_left = [&] { cur->left = build_linked(pool, nodes, n / 2, depth + 1, red_depth); };
+		auto link_right = [&] { cur->right = build_linked(pool, nodes + n / 2 + 1, n - n / 2 - 1, depth + 1, red_depth); };
+		if (n >= myset_detail::parallel_grain) {
+			pool.invoke(link_left, link_right);
+		}
+		else {
+			link_left();
+			link_right();
+		}
+		if (cur->left)
+			cur->left->parent = cur;
+		if (cur->right)
+			cur->right->parent = cur;
+		cur->size = n;
+		cur->color = depth == red_depth ? red : black;
+		return cur;
+	}
+
+	/*
+	* Moves the n sorted, unique values into new nodes and links them in
+	* parallel, replacing the (empty) tree.
+	*/
+	void link_sorted_parallel(thread_pool &pool, T * values, size_type n) {
+		std::vector<base_node*> nodes(n, nullptr);
+		auto create = [&](std::size_t first, std::size_t last) {
+			for (std::size_t i = first; i < last; i++)
+				nodes[i] = create_node(std::move(values[i]));
+		};
+		try {
+			if (allows_concurrent_allocation<node_allocator>::value)
+				pool.parallel_for(n, myset_detail::parallel_grain, create);
+			else
+				create(0, n);
+		}
+		catch (...) {
+			for (base_node * created : nodes)
+				if (created != nullptr)
+					destroy_node(created);
+			throw;
+		}
+		std::size_t red_depth = 0;
+		while ((std::size_t(2) << red_depth) <= n + 1)
+			++red_depth;
+		root.left = build_linked(pool, nodes.data(), n, 0, red_depth);
+		if (root.left)
+			root.left->parent = &root;
+		reset_extremes();
+	}
+
+	static std::size_t height(base_node * cur) {
+		if (cur == nullptr)
+			return 0;
+		return 1 + std::max(height(cur->left), height(cur->right));
+	}
+
+	static bool is_black(base_node * cur) {
+		return cur == nullptr || cur->color == black;
+	}
+
+	void rotate_left(base_node * x) const {
+		stats_policy().rotated();
+		base_node * y = x->right;
+		x->right = y->left;
+		if (y->left)
+			y->left->parent = x;
+		y->parent = x->parent;
+		if (x->parent->left == x)
+			x->parent->left = y;
+		else
+			x->parent->right = y;
+		y->left = x;
+		x->parent = y;
+		y->size = x->size;
+		update_size(x);
+	}
+
+	void rotate_right(base_node * x) const {
+		stats_policy().rotated();
+		base_node * y = x->left;
+		x->left = y->right;
+		if (y->right)
+			y->right->parent = x;
+		y->parent = x->parent;
+		if (x->parent->left == x)
+			x->parent->left = y;
+		else
+			x->parent->right = y;
+		y->right = x;
+		x->parent = y;
+		y->size = x->size;
+		update_size(x);
+	}
+
+	/*
+	* Restores the red-black invariants after the red leaf x was linked in
+	* below header. Returns true if the root had to be blackened, i.e. the
+	* black height of the tree grew by one.
+	*/
+	bool insert_fixup(base_node * x, base_node * header) const {
+		x->color = red;
+		while (x != header->left && x->parent->color == red) {
+			base_node * xp = x->parent;
+			base_node * xpp = xp->parent;
+			if (xp == xpp->left) {
+				base_node * uncle = xpp->right;
+				if (uncle && uncle->color == red) {
+					xp->color = black;
+					uncle->color = black;
+					xpp->color = red;
+					x = xpp;
+				}
+				else {
+					if (x == xp->right) {
+						x = xp;
+						rotate_left(x);
+						xp = x->parent;
+					}
+					xp->color = black;
+					xpp->color = red;
+					rotate_right(xpp);
+				}
+			}
+			else {
+				base_node * uncle = xpp->left;
+				if (uncle && uncle->color == red) {
+					xp->color = black;
+					uncle->color = black;
+					xpp->color = red;
+					x = xpp;
+				}
+				else {
+					if (x == xp->left) {
+						x = xp;
+						rotate_right(x);
+						xp = x->parent;
+					}
+					xp->color = black;
+					xpp->color = red;
+					rotate_left(xpp);
+				}
+			}
+		}
+		bool grew = header->left->color == red;
+		header->left->color = black;
+		return grew;
+	}
+
+	/*
+	* Unlinks z from the tree and rebalances it. Nodes are relinked rather
+	* than having their values swapped, so iterators to other elements stay valid.
+	*/
+	void erase_fixup(base_node * z, base_node * header) const {
+		base_node * y = z;
+		base_node * x;
+		base_node * x_parent;
+
+		if (y->left == nullptr)
+			x = y->right;
+		else if (y->right == nullptr)
+			x = y->left;
+		else {
+			y = minimum(y->right);
+			x = y->right;
+		}
+		for (base_node * cur = y->parent; cur != header; cur = cur->parent)
+			--cur->size;
+
+		if (y != z) {
+			z->left->parent = y;
+			y->left = z->left;
+			if (y != z->right) {
+				x_parent = y->parent;
+				if (x)
+					x->parent = y->parent;
+				y->parent->left = x;
+				y->right = z->right;
+				z->right->parent = y;
+			}
+			else {
+				x_parent = y;
+			}
+			if (z->parent->left == z)
+				z->parent->left = y;
+			else
+				z->parent->right = y;
+			y->parent = z->parent;
+			y->size = z->size;
+			std::swap(y->color, z->color);
+		}
+		else {
+			x_parent = y->parent;
+			if (x)
+				x->parent = y->parent;
+			if (z->parent->left == z)
+				z->parent->left = x;
+			else
+				z->parent->right = x;
+		}
+
+		if (z->color == red)
+			return;
+
+		while (x != header->left && is_black(x)) {
+			if (x == x_parent->left) {
+				base_node * w = x_parent->right;
+				if (w->color == red) {
+					w->color = black;
+					x_parent->color = red;
+					rotate_left(x_parent);
+					w = x_parent->right;
+				}
+				if (is_black(w->left) && is_black(w->right)) {
+					w->color = red;
+					x = x_parent;
+					x_parent = x_parent->parent;
+				}
+				else {
+					if (is_black(w->right)) {
+						w->left->color = black;
+						w->color = red;
+						rotate_right(w);
+						w = x_parent->right;
+					}
+					w->color = x_parent->color;
+					x_parent->color = black;
+					if (w->right)
+						w->right->color = black;
+					rotate_left(x_parent);
+					break;
+				}
+			}
+			else {
+				base_node * w = x_parent->left;
+				if (w->color == red) {
+					w->color = black;
+					x_parent->color = red;
+					rotate_right(x_parent);
+					w = x_parent->left;
+				}
+				if (is_black(w->right) && is_black(w->left)) {
+					w->color = red;
+					x = x_parent;
+					x_parent = x_parent->parent;
+				}
+				else {
+					if (is_black(w->left)) {
+						w->right->color = black;
+						w->color = red;
+						rotate_left(w);
+						w = x_parent->left;
+					}
+					w->color = x_parent->color;
+					x_parent->color = black;
+					if (w->left)
+						w->left->color = black;
+					rotate_right(x_parent);
+					break;
+				}
+			}
+		}
+		if (x)
+			x->color = black;
+	}
+
+	/*
+	* === === === === === === === === === === === === === === ===
+	*                J O I N  A N D  S P L I T
+	* === === === === === === === === === === === === === === ===
+	*
+	* These work on detached subtrees (root->parent == nullptr) tagged with
+	* their black height: the number of black nodes on any path from the
+	* root down to a leaf, the root included. Join and split follow
+	* Blelloch, Ferizovic and Sun, "Just Join for Parallel Ordered Sets".
+	*/
+
+	struct subtree {
+		base_node * root;
+		int black_height;
+	};
+
+	struct split_result {
+		subtree left;
+		base_node * found;
+		subtree right;
+	};
+
+	enum class set_op { unite, intersect, subtract, symmetric_subtract };
+
+	/*
+	* How the set operations run their two independent recursive calls:
+	* one after the other, or on a thread pool once the subproblem is large.
+	*/
+	struct sequential_fork {
+		template <typename F, typename G>
+		void operator()(size_type, F &&f, G &&g) const {
+			f();
+			g();
+		}
+	};
+
+	struct parallel_fork {
+		thread_pool &pool;
+
+		template <typename F, typename G>
+		void operator()(size_type n, F &&f, G &&g) const {
+			if (n >= myset_detail::parallel_grain) {
+				pool.invoke(f, g);
+			}
+			else {
+				f();
+				g();
+			}
+		}
+	};
+
+	static int black_height(base_node * cur) {
+		int result = 0;
+		for (; cur != nullptr; cur = cur->left)
+			if (cur->color == black)
+				++result;
+		return result;
+	}
+
+	subtree detach_tree() {
+		subtree result{ root.left, black_height(root.left) };
+		if (result.root)
+			result.root->parent = nullptr;
+		root.left = nullptr;
+		reset_extremes();
+		return result;
+	}
+
+	void attach_tree(subtree t) {
+		root.left = t.root;
+		if (t.root) {
+			t.root->parent = &root;
+			t.root->color = black;
+		}
+		reset_extremes();
+	}
+
+	static subtree child_subtree(base_node * cur, int parent_black_height, bool left) {
+		base_node * child = left ? cur->left : cur->right;
+		if (child)
+			child->parent = nullptr;
+		return { child, parent_black_height - (cur->color == black ? 1 : 0) };
+	}
+
+	static void blacken_root(subtree &t) {
+		if (t.root && t.root->color == red) {
+			t.root->color = black;
+			++t.black_height;
+		}
+	}
+
+	/*
+	* Links l, k and r (all keys of l < k < all keys of r) into one tree in
+	* O(|black_height(l) - black_height(r)| + 1).
+	*/
+	subtree join(subtree l, base_node * k, subtree r) const {
+		blacken_root(l);
+		blacken_root(r);
+		if (l.black_height == r.black_height) {
+			k->left = l.root;
+			k->right = r.root;
+			if (l.root)
+				l.root->parent = k;
+			if (r.root)
+				r.root->parent = k;
+			k->parent = nullptr;
+			k->color = red;
+			update_size(k);
+			return { k, l.black_height };
+		}
+
+		bool taller_left = l.black_height > r.black_height;
+		subtree &tall = taller_left ? l : r;
+		subtree &low = taller_left ? r : l;
+
+		// Walk down the inner spine of the taller tree to the first black
+		// node whose black height matches the lower tree, and hang k there.
+		base_node header;
+		header.left = tall.root;
+		tall.root->parent = &header;
+		base_node * parent = &header;
+		base_node * cur = tall.root;
+		int height = tall.black_height;
+		while (!(is_black(cur) && height == low.black_height)) {
+			if (cur->color == black)
+				--height;
+			parent = cur;
+			cur = taller_left ? cur->right : cur->left;
+		}
+
+		if (taller_left) {
+			parent->right = k;
+			k->left = cur;
+			k->right = low.root;
+		}
+		else {
+			parent->left = k;
+			k->left = low.root;
+			k->right = cur;
+		}
+		k->parent = parent;
+		if (cur)
+			cur->parent = k;
+		if (low.root)
+			low.root->parent = k;
+		update_size(k);
+		for (base_node * up = parent; up != &header; up = up->parent)
+			up->size += subtree_size(low.root) + 1;
+
+		int result_height = tall.black_height + (insert_fixup(k, &header) ? 1 : 0);
+		base_node * result = header.left;
+		result->parent = nullptr;
+		return { result, result_height };
+	}
+
+	/*
+	* join without a middle key: the smallest node of r is unlinked and used as one.
+	*/
+	subtree join(subtree l, subtree r) const {
+		if (l.root == nullptr)
+			return r;
+		if (r.root == nullptr)
+			return l;
+		base_node header;
+		header.left = r.root;
+		r.root->parent = &header;
+		base_node * k = minimum(r.root);
+		erase_fixup(k, &header);
+		r.root = header.left;
+		if (r.root)
+			r.root->parent = nullptr;
+		r.black_height = black_height(r.root);
+		return join(l, k, r);
+	}
+
+	/*
+	* Splits t into the keys below key and the keys above it; a node equal to
+	* key is detached and returned in found. O(log n).
+	*/
+	template <typename K>
+	split_result split(subtree t, K const &key) const {
+		if (t.root == nullptr)
+			return { { nullptr, 0 }, nullptr, { nullptr, 0 } };
+		base_node * cur = t.root;
+		subtree l = child_subtree(cur, t.black_height, true);
+		subtree r = child_subtree(cur, t.black_height, false);
+		if (less(key, value_of(cur))) {
+			split_result result = split(l, key);
+			result.right = join(result.right, cur, r);
+			return result;
+		}
+		if (less(value_of(cur), key)) {
+			split_result result = split(r, key);
+			result.left = join(l, cur, result.left);
+			return result;
+		}
+		cur->left = cur->right = cur->parent = nullptr;
+		cur->size = 1;
+		return { l, cur, r };
+	}
+
+	void destroy(subtree t) {
+		destroy(t.root);
+	}
+
+	template <typename Fork>
+	subtree unite(subtree a, subtree b, Fork const &fork) {
+		if (a.root == nullptr)
+			return b;
+		if (b.root == nullptr)
+			return a;
+		size_type n = subtree_size(a.root) + subtree_size(b.root);
+		base_node * pivot = a.root;
+		subtree l = child_subtree(pivot, a.black_height, true);
+		subtree r = child_subtree(pivot, a.black_height, false);
+		split_result parts = split(b, value_of(pivot));
+		if (parts.found)
+			destroy_node(parts.found);
+		subtree left, right;
+		fork(n, [&] { left = unite(l, parts.left, fork); }, [&] { right = unite(r, parts.right, fork); });
+		return join(left, pivot, right);
+	}
+
+	template <typename Fork>
+	subtree intersect(subtree a, subtree b, Fork const &fork) {
+		if (a.root == nullptr || b.root == nullptr) {
+			destroy(a);
+			destroy(b);
+			return { nullptr, 0 };
+		}
+		size_type n = subtree_size(a.root) + subtree_size(b.root);
+		base_node * pivot = a.root;
+		subtree l = child_subtree(pivot, a.black_height, true);
+		subtree r = child_subtree(pivot, a.black_height, false);
+		split_result parts = split(b, value_of(pivot));
+		subtree left, right;
+		fork(n, [&] { left = intersect(l, parts.left, fork); }, [&] { right = intersect(r, parts.right, fork); });
+		if (parts.found) {
+			destroy_node(parts.found);
+			return join(left, pivot, right);
+		}
+		destroy_node(pivot);
+		return join(left, right);
+	}
+
+	template <typename Fork>
+	subtree subtract(subtree a, subtree b, Fork const &fork) {
+		if (a.root == nullptr || b.root == nullptr) {
+			destroy(b);
+			return a;
+		}
+		size_type n = subtree_size(a.root) + subtree_size(b.root);
+		base_node * pivot = b.root;
+		subtree l = child_subtree(pivot, b.black_height, true);
+		subtree r = child_subtree(pivot, b.black_height, false);
+		split_result parts = split(a, value_of(pivot));
+		destroy_node(pivot);
+		if (parts.found)
+			destroy_node(parts.found);
+		subtree left, right;
+		fork(n, [&] { left = subtract(parts.left, l, fork); }, [&] { right = subtract(parts.right, r, fork); });
+		return join(left, right);
+	}
+
+	template <typename Fork>
+	subtree symmetric_subtract(subtree a, subtree b, Fork const &fork) {
+		if (a.root == nullptr)
+			return b;
+		if (b.root == nullptr)
+			return a;
+		size_type n = subtree_size(a.root) + subtree_size(b.root);
+		base_node * pivot = a.root;
+		subtree l = child_subtree(pivot, a.black_height, true);
+		subtree r = child_subtree(pivot, a.black_height, false);
+		split_result parts = split(b, value_of(pivot));
+		subtree left, right;
+		fork(n, [&] { left = symmetric_subtract(l, parts.left, fork); }, [&] { right = symmetric_subtract(r, parts.right, fork); });
+		if (parts.found) {
+			destroy_node(parts.found);
+			destroy_node(pivot);
+			return join(left, right);
+		}
+		return join(left, pivot, right);
+	}
+
+	/*
+	* Combines two sets, consuming both and reusing their nodes. The comparator
+	* must not throw: a failure halfway through would leave nodes unowned.
+	*/
+	template <typename Fork>
+	static set combine(set &&a, set &&b, set_op op, Fork const &fork) {
+		if (static_cast<alloc_base&>(a).get() != static_cast<alloc_base&>(b).get()) {
+			set same_alloc(assume_sorted_unique, b.begin(), b.end(), a.key_comp(), a.get_allocator());
+			return combine(std::move(a), std::move(same_alloc), op, fork);
+		}
+		subtree lhs = a.detach_tree();
+		subtree rhs = b.detach_tree();
+		switch (op) {
+		case set_op::unite:
+			a.attach_tree(a.unite(lhs, rhs, fork));
+			break;
+		case set_op::intersect:
+			a.attach_tree(a.intersect(lhs, rhs, fork));
+			break;
+		case set_op::subtract:
+			a.attach_tree(a.subtract(lhs, rhs, fork));
+			break;
+		case set_op::symmetric_subtract:
+			a.attach_tree(a.symmetric_subtract(lhs, rhs, fork));
+			break;
+		}
+		return std::move(a);
+	}
+
+	/*
+	* combine on pool. Duplicates are freed from several threads at once, so
+	* the recursion only forks when allows_concurrent_allocation holds.
+	*/
+	static set combine(thread_pool &pool, set &&a, set &&b, set_op op) {
+		if (allows_concurrent_allocation<node_allocator>::value)
+			return combine(std::move(a), std::move(b), op, parallel_fork{ pool });
+		return combine(std::move(a), std::move(b), op, sequential_fork());
+	}
+
+	template <typename U, typename C, typename A, typename S>
+	friend set<U, C, A, S> set_union(set<U, C, A, S> &&a, set<U, C, A, S> &&b);
+	template <typename U, typename C, typename A, typename S>
+	friend set<U, C, A, S> set_intersection(set<U, C, A, S> &&a, set<U, C, A, S> &&b);
+	template <typename U, typename C, typename A, typename S>
+	friend set<U, C, A, S> set_difference(set<U, C, A, S> &&a, set<U, C, A, S> &&b);
+	template <typename U, typename C, typename A, typename S>
+	friend set<U, C, A, S> set_symmetric_difference(set<U, C, A, S> &&a, set<U, C, A, S> &&b);
+	template <typename U, typename C, typename A, typename S>
+	friend set<U, C, A, S> set_union(thread_pool &pool, set<U, C, A, S> &&a, set<U, C, A, S> &&b);
+	template <typename U, typename C, typename A, typename S>
+	friend set<U, C, A, S> set_intersection(thread_pool &pool, set<U, C, A, S> &&a, set<U, C, A, S> &&b);
+	template <typename U, typename C, typename A, typename S>
+	friend set<U, C, A, S> set_difference(thread_pool &pool, set<U, C, A, S> &&a, set<U, C, A, S> &&b);
+	template <typename U, typename C, typename A, typename S>
+	friend set<U, C, A, S> set_symmetric_difference(thread_pool &pool, set<U, C, A, S> &&a, set<U, C, A, S> &&b);
+
+	static base_node * maximum(base_node * cur) {
+		while (cur->right)
+			cur = cur->right;
+		return cur;
+	}
+
+	/*
+	* In-order predecessor of a node that has one.
+	*/
+	static base_node * prev_node(base_node * cur) {
+		if (cur->left != nullptr)
+			return maximum(cur->left);
+		while (cur->parent->left == cur)
+			cur = cur->parent;
+		return cur->parent;
+	}
+
+	static base_node * minimum(base_node * cur) {
+		if (cur->left == nullptr)
+			return cur;
+		return minimum(cur->left);
+	}
+
+	static base_node * next_node(base_node * cur) {
+		if (cur->right != nullptr)
+			return minimum(cur->right);
+
+		base_node *y = cur->parent;
+		while (y != nullptr && cur == y->right) {
+			cur = y;
+			y = y->parent;
+		}
+		return y;
+	}
+};
+
+template<typename T, typename Compare, typename Alloc, typename Stats>
+void set<T, Compare, Alloc, Stats>::swap(set &other) noexcept
+{
+	using std::swap;
+	swap(compare_base::get(), static_cast<compare_base&>(other).get());
+	if (node_traits::propagate_on_container_swap::value)
+		swap(alloc_base::get(), static_cast<alloc_base&>(other).get());
+	if (root.left && other.root.left)
+		std::swap(root.left->parent, other.root.left->parent);
+	else if (root.left)
+		root.left->parent = &other.root;
+	else if (other.root.left)
+		other.root.left->parent = &root;
+	std::swap(root.left, other.root.left);
+	std::swap(root.leftmost, other.root.leftmost);
+	std::swap(root.rightmost, other.root.rightmost);
+	// An empty side caches the other header; point it back at its own.
+	if (!root.left)
+		root.leftmost = root.rightmost = get_root();
+	if (!other.root.left)
+		other.root.leftmost = other.root.rightmost = other.get_root();
+}
+
+template <typename T, typename Compare, typename Alloc, typename Stats>
+void swap(set<T, Compare, Alloc, Stats> &lhs, set<T, Compare, Alloc, Stats> &rhs) noexcept {
+	lhs.swap(rhs);
+}
+
+template <typename T, typename Compare, typename Alloc, typename Stats, typename Pred>
+typename set<T, Compare, Alloc, Stats>::size_type erase_if(set<T, Compare, Alloc, Stats> &s, Pred pred) {
+	return s.erase_if(pred);
+}
+
+template<typename T, typename Compare, typename Alloc, typename Stats>
+set<T, Compare, Alloc, Stats>::set(const set &other)
+	: compare_base(other.key_comp())
+	, alloc_base(node_traits::select_on_container_copy_construction(static_cast<alloc_base const&>(other).get()))
+	, stats_base()
+	, root()
+{
+	link_sorted(other.begin(), static_cast<std::size_t>(std::distance(other.begin(), other.end())));
+}
+
+template<typename T, typename Compare, typename Alloc, typename Stats>
+template<typename InputIt, typename>
+set<T, Compare, Alloc, Stats>::set(InputIt first, InputIt last) : root() {
+	insert(first, last);
+}
+
+template<typename T, typename Compare, typename Alloc, typename Stats>
+template<typename InputIt, typename>
+set<T, Compare, Alloc, Stats>::set(assume_sorted_unique_t, InputIt first, InputIt last, Compare const &comp, Alloc const &alloc)
+	: compare_base(comp), alloc_base(node_allocator(alloc)), root()
+{
+	if constexpr (std::is_base_of<std::forward_iterator_tag, typename std::iterator_traits<InputIt>::iterator_category>::value) {
+		link_sorted(first, static_cast<size_type>(std::distance(first, last)));
+	}
+	else {
+		for (; first != last; ++first)
+			emplace_hint(end(), *first);
+	}
+}
+
+template<typename T, typename Compare, typename Alloc, typename Stats>
+template<typename InputIt, typename>
+set<T, Compare, Alloc, Stats>::set(assume_sorted_unique_t, InputIt first, size_type n, Compare const &comp, Alloc const &alloc)
+	: compare_base(comp), alloc_base(node_allocator(alloc)), root()
+{
+	link_sorted(first, n);
+}
+
+template<typename T, typename Compare, typename Alloc, typename Stats>
+template<typename InputIt, typename>
+set<T, Compare, Alloc, Stats>::set(thread_pool &pool, InputIt first, InputIt last, Compare const &comp, Alloc const &alloc)
+	: compare_base(comp), alloc_base(node_allocator(alloc)), root()
+{
+	std::vector<T> values(first, last);
+	// Sorting and deduplication assign into scratch, so it only needs live
+	// objects; copying values into it is the fallback for types without a
+	// default constructor.
+	std::vector<T> scratch;
+	if constexpr (std::is_default_constructible<T>::value)
+		scratch.resize(values.size());
+	else
+		scratch = values;
+	myset_detail::parallel_sort(pool, values.data(), scratch.data(), values.size(), false, value_comp());
+	size_type n = myset_detail::parallel_unique(pool, values.data(), values.size(), scratch.data(), value_comp());
+	link_sorted_parallel(pool, scratch.data(), n);
+}
+
+template<typename T, typename Compare, typename Alloc, typename Stats>
+set<T, Compare, Alloc, Stats>::set(set &&other) noexcept
+	: compare_base(static_cast<compare_base&&>(other))
+	, alloc_base(static_cast<alloc_base&&>(other))
+	, root()
+{
+	take_nodes(other);
+}
+
+template<typename T, typename Compare, typename Alloc, typename Stats>
+set<T, Compare, Alloc, Stats>& set<T, Compare, Alloc, Stats>::operator=(set const &rhs) {
+	if (this != &rhs) {
+		constexpr bool propagate = node_traits::propagate_on_container_copy_assignment::value;
+		set tmp(rhs.key_comp(), propagate ? rhs.get_allocator() : get_allocator());
+		tmp.link_sorted(rhs.begin(), rhs.size());
+		clear();
+		if (propagate)
+			alloc_base::get() = static_cast<alloc_base&>(tmp).get();
+		compare_base::get() = static_cast<compare_base&>(tmp).get();
+		take_nodes(tmp);
+	}
+	return *this;
+}
+
+template<typename T, typename Compare, typename Alloc, typename Stats>
+set<T, Compare, Alloc, Stats>& set<T, Compare, Alloc, Stats>::operator=(set &&rhs) noexcept(std::allocator_traits<node_allocator>::propagate_on_container_move_assignment::value
+	|| std::allocator_traits<node_allocator>::is_always_equal::value) {
+	if (this == &rhs)
+		return *this;
+	if (node_traits::propagate_on_container_move_assignment::value
+		|| alloc_base::get() == static_cast<alloc_base&>(rhs).get()) {
+		clear();
+		if (node_traits::propagate_on_container_move_assignment::value)
+			alloc_base::get() = static_cast<alloc_base&>(rhs).get();
+		compare_base::get() = static_cast<compare_base&>(rhs).get();
+		take_nodes(rhs);
+	}
+	else {
+		set tmp(key_comp(), get_allocator());
+		for (base_node * cur = rhs.leftmost(); cur != rhs.get_root(); cur = next_node(cur))
+			tmp.emplace_hint(tmp.end(), std::move(static_cast<node*>(cur)->value));
+		rhs.clear();
+		swap(tmp);
+	}
+	return *this;
+}
+
+template<typename T, typename Compare, typename Alloc, typename Stats>
+set<T, Compare, Alloc, Stats>::~set() {
+	destroy(root.left);
+}
+
+template<typename T, typename Compare, typename Alloc, typename Stats>
+typename set<T, Compare, Alloc, Stats>::iterator set<T, Compare, Alloc, Stats>::begin() const {
+	return set<T, Compare, Alloc, Stats>::iterator(root.leftmost);
+}
+
+template<typename T, typename Compare, typename Alloc, typename Stats>
+typename set<T, Compare, Alloc, Stats>::iterator set<T, Compare, Alloc, Stats>::end() const {
+	return set<T, Compare, Alloc, Stats>::iterator(get_root());
+}
+
+template<typename T, typename Compare, typename Alloc, typename Stats>
+typename set<T, Compare, Alloc, Stats>::const_iterator set<T, Compare, Alloc, Stats>::cbegin() const {
+	return set::const_iterator(begin());
+}
+
+template<typename T, typename Compare, typename Alloc, typename Stats>
+typename set<T, Compare, Alloc, Stats>::const_iterator set<T, Compare, Alloc, Stats>::cend() const {
+	return set::const_iterator(end());
+}
+
+template<typename T, typename Compare, typename Alloc, typename Stats>
+typename set<T, Compare, Alloc, Stats>::base_node *set<T, Compare, Alloc, Stats>::get_root() const {
+	return const_cast<typename set<T, Compare, Alloc, Stats>::header_node*>(&root);
+}
+
+/*
+* === === === === === === === === === === === === === === ===
+*                   S E T  A L G E B R A
+* === === === === === === === === === === === === === === ===
+*
+* The rvalue overloads consume both operands and relink their nodes with
+* join/split, in O(m log(n / m + 1)) for sizes m <= n. The const overloads
+* leave the operands intact and copy what they need.
+*/
+
+template <typename T, typename Compare, typename Alloc, typename Stats>
+set<T, Compare, Alloc, Stats> set_union(set<T, Compare, Alloc, Stats> &&a, set<T, Compare, Alloc, Stats> &&b) {
+	using set_type = set<T, Compare, Alloc, Stats>;
+	return set_type::combine(std::move(a), std::move(b), set_type::set_op::unite, typename set_type::sequential_fork());
+}
+
+template <typename T, typename Compare, typename Alloc, typename Stats>
+set<T, Compare, Alloc, Stats> set_intersection(set<T, Compare, Alloc, Stats> &&a, set<T, Compare, Alloc, Stats> &&b) {
+	using set_type = set<T, Compare, Alloc, Stats>;
+	return set_type::combine(std::move(a), std::move(b), set_type::set_op::intersect, typename set_type::sequential_fork());
+}
+
+template <typename T, typename Compare, typename Alloc, typename Stats>
+set<T, Compare, Alloc, Stats> set_difference(set<T, Compare, Alloc, Stats> &&a, set<T, Compare, Alloc, Stats> &&b) {
+	using set_type = set<T, Compare, Alloc, Stats>;
+	return set_type::combine(std::move(a), std::move(b), set_type::set_op::subtract, typename set_type::sequential_fork());
+}
+
+template <typename T, typename Compare, typename Alloc, typename Stats>
+set<T, Compare, Alloc, Stats> set_symmetric_difference(set<T, Compare, Alloc, Stats> &&a, set<T, Compare, Alloc, Stats> &&b) {
+	using set_type = set<T, Compare, Alloc, Stats>;
+	return set_type::combine(std::move(a), std::move(b), set_type::set_op::symmetric_subtract, typename set_type::sequential_fork());
+}
+
+template <typename T, typename Compare, typename Alloc, typename Stats>
+set<T, Compare, Alloc, Stats> set_union(set<T, Compare, Alloc, Stats> const &a, set<T, Compare, Alloc, Stats> const &b) {
+	return set_union(set<T, Compare, Alloc, Stats>(a), set<T, Compare, Alloc, Stats>(b));
+}
+
+/*
+* Looks every element of the smaller set up in the larger one: O(m log n).
+*/
+template <typename T, typename Compare, typename Alloc, typename Stats>
+set<T, Compare, Alloc, Stats> set_intersection(set<T, Compare, Alloc, Stats> const &a, set<T, Compare, Alloc, Stats> const &b) {
+	set<T, Compare, Alloc, Stats> const &small = a.size() <= b.size() ? a : b;
+	set<T, Compare, Alloc, Stats> const &large = a.size() <= b.size() ? b : a;
+	set<T, Compare, Alloc, Stats> result(a.key_comp(), a.get_allocator());
+	for (T const &value : small)
+		if (large.contains(value))
+			result.emplace_hint(result.end(), value);
+	return result;
+}
+
+template <typename T, typename Compare, typename Alloc, typename Stats>
+set<T, Compare, Alloc, Stats> set_difference(set<T, Compare, Alloc, Stats> const &a, set<T, Compare, Alloc, Stats> const &b) {
+	if (a.size() > b.size())
+		return set_difference(set<T, Compare, Alloc, Stats>(a), set<T, Compare, Alloc, Stats>(b));
+	set<T, Compare, Alloc, Stats> result(a.key_comp(), a.get_allocator());
+	for (T const &value : a)
+		if (!b.contains(value))
+			result.emplace_hint(result.end(), value);
+	return result;
+}
+
+template <typename T, typename Compare, typename Alloc, typename Stats>
+set<T, Compare, Alloc, Stats> set_symmetric_difference(set<T, Compare, Alloc, Stats> const &a, set<T, Compare, Alloc, Stats> const &b) {
+	return set_symmetric_difference(set<T, Compare, Alloc, Stats>(a), set<T, Compare, Alloc, Stats>(b));
+}
+
+/*
+* The same operations with both recursive calls of every large step run
+* concurrently on pool, for O(m log(n / m + 1)) work and O(log^2 n) span.
+* The comparator must be safe to call from several threads at once. They
+* run sequentially unless allows_concurrent_allocation holds for Alloc,
+* since the recursion frees duplicate nodes.
+*/
+
+template <typename T, typename Compare, typename Alloc, typename Stats>
+set<T, Compare, Alloc, Stats> set_union(thread_pool &pool, set<T, Compare, Alloc, Stats> &&a, set<T, Compare, Alloc, Stats> &&b) {
+	using set_type = set<T, Compare, Alloc, Stats>;
+	return set_type::combine(pool, std::move(a), std::move(b), set_type::set_op::unite);
+}
+
+template <typename T, typename Compare, typename Alloc, typename Stats>
+set<T, Compare, Alloc, Stats> set_intersection(thread_pool &pool, set<T, Compare, Alloc, Stats> &&a, set<T, Compare, Alloc, Stats> &&b) {
+	using set_type = set<T, Compare, Alloc, Stats>;
+	return set_type::combine(pool, std::move(a), std::move(b), set_type::set_op::intersect);
+}
+
+template <typename T, typename Compare, typename Alloc, typename Stats>
+set<T, Compare, Alloc, Stats> set_difference(thread_pool &pool, set<T, Compare, Alloc, Stats> &&a, set<T, Compare, Alloc, Stats> &&b) {
+	using set_type = set<T, Compare, Alloc, Stats>;
+	return set_type::combine(pool, std::move(a), std::move(b), set_type::set_op::subtract);
+}
+
+template <typename T, typename Compare, typename Alloc, typename Stats>
+set<T, Compare, Alloc, Stats> set_symmetric_difference(thread_pool &pool, set<T, Compare, Alloc, Stats> &&a, set<T, Compare, Alloc, Stats> &&b) {
+	using set_type = set<T, Compare, Alloc, Stats>;
+	return set_type::combine(pool, std::move(a), std::move(b), set_type::set_op::symmetric_subtract);
+}
+
+template <typename T, typename Compare, typename Alloc, typename Stats>
+set<T, Compare, Alloc, Stats> set_union(thread_pool &pool, set<T, Compare, Alloc, Stats> const &a, set<T, Compare, Alloc, Stats> const &b) {
+	return set_union(pool, set<T, Compare, Alloc, Stats>(a), set<T, Compare, Alloc, Stats>(b));
+}
+
+template <typename T, typename Compare, typename Alloc, typename Stats>
+set<T, Compare, Alloc, Stats> set_intersection(thread_pool &pool, set<T, Compare, Alloc, Stats> const &a, set<T, Compare, Alloc, Stats> const &b) {
+	return set_intersection(pool, set<T, Compare, Alloc, Stats>(a), set<T, Compare, Alloc, Stats>(b));
+}
+
+template <typename T, typename Compare, typename Alloc, typename Stats>
+set<T, Compare, Alloc, Stats> set_difference(thread_pool &pool, set<T, Compare, Alloc, Stats> const &a, set<T, Compare, Alloc, Stats> const &b) {
+	return set_difference(pool, set<T, Compare, Alloc, Stats>(a), set<T, Compare, Alloc, Stats>(b));
+}
+
+template <typename T, typename Compare, typename Alloc, typename Stats>
+set<T, Compare, Alloc, Stats> set_symmetric_difference(thread_pool &pool, set<T, Compare, Alloc, Stats> const &a, set<T, Compare, Alloc, Stats> const &b) {
+	return set_symmetric_difference(pool, set<T, Compare, Alloc, Stats>(a), set<T, Compare, Alloc, Stats>(b));
+}
+
+#include "frozen_set.h"
+
+template <typename T, typename Compare, typename Alloc, typename Stats>
+frozen_set<T, Compare> set<T, Compare, Alloc, Stats>::freeze() const {
+	return frozen_set<T, Compare>(begin(), size(), key_comp());
+}
+
 #endif // SET_H
\ No newline at end of file
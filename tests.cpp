@@ -2,15 +2,35 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <cstdio>
 #include <cstdlib>
+#include <ctime>
+#include <map>
+#include <numeric>
+#include <set>
+#include <sstream>
+#include <stdexcept>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <gtest/gtest.h>
 #include <iterator>
+#include <memory>
 #include <random>
+#include <thread>
 
 #include "set.h"
+#include "pool_allocator.h"
+#include "btree_set.h"
+#include "flat_set.h"
+#include "concurrent_set.h"
+#include "persistent_set.h"
+#include "serialization.h"
+#include "mapped_set.h"
+#include "index_set.h"
+#include "lean_set.h"
 
 template<typename C, typename T>
 void mass_push_back(C &c, std::initializer_list<T> elems) {
@@ -751,6 +771,1912 @@ TEST(exceptions, less_operator) {
 	}
 }
 
+std::size_t rb_height_limit(std::size_t n) {
+	return static_cast<std::size_t>(2 * std::log2(double(n) + 1));
+}
+
+TEST(balance, ascending_million) {
+	const int n = 1000000;
+	set<int> s;
+	for (int i = 0; i < n; i++)
+		ASSERT_TRUE(s.insert(i).second);
+	ASSERT_LE(s.height(), rb_height_limit(n));
+
+	int expected = 0;
+	for (int x : s)
+		ASSERT_EQ(expected++, x);
+	ASSERT_EQ(n, expected);
+
+	for (int i = 0; i < n; i += 997) {
+		ASSERT_EQ(i, *s.find(i));
+		ASSERT_EQ(i, *s.lower_bound(i));
+	}
+	ASSERT_EQ(s.end(), s.find(n));
+	ASSERT_FALSE(s.insert(n / 2).second);
+}
+
+TEST(balance, descending_with_erase) {
+	const int n = 100000;
+	set<int> s;
+	for (int i = n; i > 0; i--)
+		s.insert(i);
+	ASSERT_LE(s.height(), rb_height_limit(n));
+
+	for (int i = 1; i <= n; i += 2)
+		s.erase(s.find(i));
+	ASSERT_LE(s.height(), rb_height_limit(n / 2));
+
+	int expected = 2;
+	for (int x : s) {
+		ASSERT_EQ(expected, x);
+		expected += 2;
+	}
+	ASSERT_EQ(n + 2, expected);
+}
+
+TEST(balance, random_against_std) {
+	std::mt19937 gen(42);
+	std::uniform_int_distribution<int> dist(0, 5000);
+	std::set<int> a;
+	set<int> b;
+	for (int i = 0; i < 20000; i++) {
+		int x = dist(gen);
+		if (i % 3 == 0) {
+			auto it = b.find(x);
+			ASSERT_EQ(a.count(x) == 1, it != b.end());
+			if (it != b.end()) {
+				a.erase(x);
+				b.erase(it);
+			}
+		}
+		else {
+			ASSERT_EQ(a.insert(x).second, b.insert(x).second);
+		}
+	}
+	ASSERT_LE(b.height(), rb_height_limit(a.size()));
+	ASSERT_TRUE(std::equal(a.begin(), a.end(), b.begin(), b.end()));
+}
+
+std::size_t min_height(std::size_t n) {
+	std::size_t h = 0;
+	while ((std::size_t(1) << h) < n + 1)
+		h++;
+	return h;
+}
+
+TEST(copy, balanced_copy) {
+	for (int n : { 0, 1, 2, 3, 7, 8, 1000, 100000 }) {
+		set<int> a;
+		for (int i = 0; i < n; i++)
+			a.insert(i);
+		set<int> b(a);
+		ASSERT_EQ(min_height(n), b.height());
+		ASSERT_TRUE(std::equal(a.begin(), a.end(), b.begin(), b.end()));
+	}
+}
+
+TEST(copy, copy_stays_valid_under_updates) {
+	set<int> a;
+	for (int i = 0; i < 5000; i++)
+		a.insert(i * 2);
+	set<int> b(a);
+	std::set<int> c(a.begin(), a.end());
+	for (int i = 0; i < 5000; i++) {
+		ASSERT_EQ(c.insert(i * 3).second, b.insert(i * 3).second);
+		if (i % 2 == 0) {
+			c.erase(i * 2);
+			b.erase(b.find(i * 2));
+		}
+	}
+	ASSERT_LE(b.height(), rb_height_limit(c.size()));
+	ASSERT_TRUE(std::equal(c.begin(), c.end(), b.begin(), b.end()));
+	ASSERT_EQ(4999 * 2, *--a.end());
+}
+
+TEST(copy, range_constructor) {
+	std::vector<int> sorted;
+	for (int i = 0; i < 1023; i++)
+		sorted.push_back(i);
+	set<int> a(sorted.begin(), sorted.end());
+	ASSERT_EQ(min_height(sorted.size()), a.height());
+	ASSERT_TRUE(std::equal(sorted.begin(), sorted.end(), a.begin(), a.end()));
+
+	std::vector<int> unsorted = { 5, 1, 4, 1, 3, 5 };
+	set<int> b(unsorted.begin(), unsorted.end());
+	expect_eq(b, { 1, 3, 4, 5 });
+}
+
+TEST(destruction, clear_large_and_reuse) {
+	set<std::string> s;
+	for (int i = 0; i < 300000; i++)
+		s.insert(std::to_string(i));
+	set<std::string> copy(s);
+	s.clear();
+	EXPECT_TRUE(s.empty());
+	EXPECT_EQ(s.begin(), s.end());
+	s.insert("x");
+	expect_eq(s, { std::string("x") });
+	EXPECT_EQ("0", *copy.begin());
+}
+
+using pooled_set = set<int, std::less<int>, pool_allocator<int>>;
+
+TEST(allocator, pool_churn_matches_std) {
+	std::mt19937 gen(7);
+	std::uniform_int_distribution<int> dist(0, 2000);
+	std::set<int> a;
+	pooled_set b;
+	for (int i = 0; i < 50000; i++) {
+		int x = dist(gen);
+		auto it = b.find(x);
+		if (it != b.end()) {
+			a.erase(x);
+			b.erase(it);
+		}
+		else {
+			a.insert(x);
+			b.insert(x);
+		}
+	}
+	ASSERT_TRUE(std::equal(a.begin(), a.end(), b.begin(), b.end()));
+}
+
+TEST(allocator, pool_released_on_clear) {
+	pooled_set s;
+	for (int i = 0; i < 10000; i++)
+		s.insert(i);
+	EXPECT_LT(0u, s.get_allocator().chunk_count());
+	s.clear();
+	EXPECT_EQ(0u, s.get_allocator().chunk_count());
+	s.insert(1);
+	expect_eq(s, { 1 });
+}
+
+TEST(allocator, pool_copy_and_swap) {
+	pooled_set a;
+	mass_push_back(a, { 3, 1, 2 });
+	pooled_set b(a);
+	EXPECT_TRUE(a.get_allocator() != b.get_allocator());
+	b.insert(4);
+	a.clear();
+	expect_eq(b, { 1, 2, 3, 4 });
+
+	pooled_set c;
+	mass_push_back(c, { 10 });
+	swap(b, c);
+	expect_eq(b, { 10 });
+	expect_eq(c, { 1, 2, 3, 4 });
+	b = c;
+	expect_eq(b, { 1, 2, 3, 4 });
+}
+
+TEST(comparator, greater) {
+	set<int, std::greater<int>> s;
+	mass_push_back(s, { 1, 5, 3, 4, 2 });
+	expect_eq(s, { 5, 4, 3, 2, 1 });
+	EXPECT_EQ(3, *s.lower_bound(3));
+	EXPECT_EQ(2, *s.upper_bound(3));
+	EXPECT_EQ(s.end(), s.find(6));
+	set<int, std::greater<int>> copy(s);
+	expect_eq(copy, { 5, 4, 3, 2, 1 });
+}
+
+struct copy_counter {
+	static int copies;
+	int x;
+
+	copy_counter(int x) : x(x) {}
+	copy_counter(copy_counter const &other) : x(other.x) { copies++; }
+
+	friend bool operator<(copy_counter const &a, copy_counter const &b) { return a.x < b.x; }
+};
+
+int copy_counter::copies = 0;
+
+TEST(comparator, lookups_do_not_copy) {
+	set<copy_counter> s;
+	for (int i = 0; i < 100; i++)
+		s.insert(copy_counter(i));
+	copy_counter key(50);
+	copy_counter::copies = 0;
+	EXPECT_EQ(50, s.find(key)->x);
+	EXPECT_EQ(50, s.lower_bound(key)->x);
+	EXPECT_EQ(51, s.upper_bound(key)->x);
+	EXPECT_TRUE(s.contains(key));
+	EXPECT_EQ(0, copy_counter::copies);
+}
+
+TEST(comparator, transparent_lookup) {
+	set<std::string, std::less<>> s;
+	mass_push_back(s, { std::string("apple"), std::string("banana"), std::string("cherry") });
+	std::string_view key = "banana";
+	EXPECT_EQ("banana", *s.find(key));
+	EXPECT_EQ("cherry", *s.upper_bound(key));
+	EXPECT_EQ("banana", *s.lower_bound(std::string_view("b")));
+	EXPECT_TRUE(s.contains(std::string_view("apple")));
+	EXPECT_EQ(0u, s.count(std::string_view("durian")));
+	EXPECT_EQ(1u, s.count("cherry"));
+	EXPECT_EQ(s.end(), s.find(std::string_view("a")));
+}
+
+template <typename T>
+struct counting_allocator {
+	using value_type = T;
+
+	static int allocations;
+
+	counting_allocator() = default;
+	template <typename U>
+	counting_allocator(counting_allocator<U> const &) {}
+
+	T * allocate(std::size_t n) {
+		allocations++;
+		return std::allocator<T>().allocate(n);
+	}
+
+	void deallocate(T * p, std::size_t n) {
+		std::allocator<T>().deallocate(p, n);
+	}
+
+	template <typename U>
+	friend bool operator==(counting_allocator const &, counting_allocator<U> const &) { return true; }
+	template <typename U>
+	friend bool operator!=(counting_allocator const &, counting_allocator<U> const &) { return false; }
+};
+
+template <typename T>
+int counting_allocator<T>::allocations = 0;
+
+inline std::map<void const*, int> &tagged_owners() {
+	static std::map<void const*, int> owners;
+	return owners;
+}
+
+inline int &tagged_mismatched_frees() {
+	static int count = 0;
+	return count;
+}
+
+/*
+* Stateful allocator that never propagates. Allocators with different ids
+* are unequal, and freeing a block through the wrong one is counted.
+*/
+template <typename T>
+struct tagged_allocator {
+	using value_type = T;
+	using propagate_on_container_copy_assignment = std::false_type;
+	using propagate_on_container_move_assignment = std::false_type;
+	using propagate_on_container_swap = std::false_type;
+	using is_always_equal = std::false_type;
+
+	int id;
+
+	explicit tagged_allocator(int id = 0) : id(id) {}
+	template <typename U>
+	tagged_allocator(tagged_allocator<U> const &other) : id(other.id) {}
+
+	T * allocate(std::size_t n) {
+		T * p = std::allocator<T>().allocate(n);
+		tagged_owners()[p] = id;
+		return p;
+	}
+
+	void deallocate(T * p, std::size_t n) {
+		auto it = tagged_owners().find(p);
+		if (it == tagged_owners().end() || it->second != id)
+			tagged_mismatched_frees()++;
+		if (it != tagged_owners().end())
+			tagged_owners().erase(it);
+		std::allocator<T>().deallocate(p, n);
+	}
+
+	template <typename U>
+	friend bool operator==(tagged_allocator const &lhs, tagged_allocator<U> const &rhs) { return lhs.id == rhs.id; }
+	template <typename U>
+	friend bool operator!=(tagged_allocator const &lhs, tagged_allocator<U> const &rhs) { return lhs.id != rhs.id; }
+};
+
+TEST(allocator, set_assignment_respects_allocators) {
+	using tagged_set = set<int, std::less<int>, tagged_allocator<int>>;
+	int mismatched = tagged_mismatched_frees();
+	{
+		tagged_set a(std::less<int>(), tagged_allocator<int>(1));
+		tagged_set b(std::less<int>(), tagged_allocator<int>(2));
+		for (int i = 0; i < 100; i++)
+			a.insert(i);
+		b.insert(-1);
+
+		// Neither assignment may hand b nodes from a's allocator.
+		b = a;
+		EXPECT_EQ(2, b.get_allocator().id);
+		EXPECT_TRUE(std::equal(a.begin(), a.end(), b.begin(), b.end()));
+		b.insert(100);
+		b = std::move(a);
+		EXPECT_EQ(2, b.get_allocator().id);
+		EXPECT_TRUE(a.empty());
+		EXPECT_EQ(100u, b.size());
+		EXPECT_EQ(99, *b.rbegin());
+
+		tagged_set c(std::less<int>(), tagged_allocator<int>(2));
+		c = std::move(b);
+		EXPECT_TRUE(b.empty());
+		EXPECT_EQ(0, *c.begin());
+		EXPECT_EQ(99, *c.rbegin());
+	}
+	EXPECT_EQ(mismatched, tagged_mismatched_frees());
+
+	// pool_allocator does not propagate on copy assignment: the target keeps its pool.
+	set<int, std::less<int>, pool_allocator<int>> p, q;
+	p.insert(1);
+	q.insert(2);
+	auto pool = p.get_allocator();
+	p = q;
+	EXPECT_TRUE(pool == p.get_allocator());
+	EXPECT_TRUE(q.get_allocator() != p.get_allocator());
+	EXPECT_EQ(2, *p.begin());
+}
+
+TEST(move, constructor_and_assignment) {
+	set<int> a;
+	mass_push_back(a, { 1, 2, 3 });
+	set<int> b(std::move(a));
+	EXPECT_TRUE(a.empty());
+	expect_eq(b, { 1, 2, 3 });
+	a.insert(7);
+	expect_eq(a, { 7 });
+
+	set<int> c;
+	mass_push_back(c, { 9, 8 });
+	c = std::move(b);
+	expect_eq(c, { 1, 2, 3 });
+	EXPECT_TRUE(b.empty());
+	expect_reverse_eq(c, { 3, 2, 1 });
+	c = std::move(c);
+	expect_eq(c, { 1, 2, 3 });
+}
+
+TEST(move, extremes_follow_the_tree) {
+	// swap and the moves carry the cached begin/end neighbours over instead of recomputing them.
+	set<int> a, b;
+	mass_push_back(a, { 5, 1, 9, 3 });
+	a.swap(b);
+	EXPECT_EQ(a.begin(), a.end());
+	EXPECT_EQ(1, *b.begin());
+	EXPECT_EQ(9, *--b.end());
+	a.insert(4);
+	EXPECT_EQ(4, *a.begin());
+	EXPECT_EQ(4, *a.rbegin());
+	a.swap(b);
+	EXPECT_EQ(9, *a.rbegin());
+	EXPECT_EQ(4, *b.begin());
+
+	set<int> c(std::move(a));
+	EXPECT_EQ(a.begin(), a.end());
+	EXPECT_EQ(a.rbegin(), a.rend());
+	EXPECT_EQ(1, *c.begin());
+	c.insert(0);
+	c.insert(10);
+	expect_eq(c, { 0, 1, 3, 5, 9, 10 });
+	expect_reverse_eq(c, { 10, 9, 5, 3, 1, 0 });
+	b = std::move(c);
+	EXPECT_EQ(c.begin(), c.end());
+	c.insert(2);
+	expect_eq(c, { 2 });
+	EXPECT_EQ(0, *b.begin());
+	EXPECT_EQ(10, *--b.end());
+}
+
+TEST(move, move_only_values) {
+	set<std::unique_ptr<int>> s;
+	auto p = std::make_unique<int>(5);
+	int * raw = p.get();
+	EXPECT_TRUE(s.insert(std::move(p)).second);
+	EXPECT_EQ(nullptr, p);
+	EXPECT_EQ(raw, s.begin()->get());
+	EXPECT_TRUE(s.emplace(new int(6)).second);
+	EXPECT_TRUE(s.emplace(nullptr).second);
+	set<std::unique_ptr<int>> t(std::move(s));
+	EXPECT_EQ(3, std::distance(t.begin(), t.end()));
+}
+
+TEST(move, emplace_duplicate_does_not_allocate) {
+	set<std::string, std::less<std::string>, counting_allocator<std::string>> s;
+	s.emplace(std::string("a"));
+	s.emplace(3, 'b');
+	EXPECT_EQ(2, counting_allocator<myset_detail::set_node<std::string>>::allocations);
+	std::string dup("a");
+	EXPECT_FALSE(s.emplace(dup).second);
+	EXPECT_FALSE(s.insert(std::string("bbb")).second);
+	EXPECT_EQ(2, counting_allocator<myset_detail::set_node<std::string>>::allocations);
+	expect_eq(s, { std::string("a"), std::string("bbb") });
+}
+
+TEST(move, emplace_hint) {
+	set<int> s;
+	for (int i = 0; i < 1000; i++)
+		EXPECT_EQ(i, *s.emplace_hint(s.end(), i));
+	EXPECT_LE(s.height(), rb_height_limit(1000));
+	for (int i = -1; i > -100; i--)
+		s.emplace_hint(s.begin(), i);
+	EXPECT_EQ(-99, *s.begin());
+	auto it = s.emplace_hint(s.find(500), 500);
+	EXPECT_EQ(500, *it);
+	s.emplace_hint(s.find(10), 5000);
+	s.emplace_hint(s.find(10), -5000);
+	EXPECT_EQ(-5000, *s.begin());
+	EXPECT_EQ(5000, *--s.end());
+	EXPECT_EQ(1101, std::distance(s.begin(), s.end()));
+	int prev = -6000;
+	for (int x : s) {
+		EXPECT_LT(prev, x);
+		prev = x;
+	}
+}
+
+TEST(order_statistics, empty) {
+	set<int> s;
+	EXPECT_EQ(0u, s.size());
+	EXPECT_EQ(s.end(), s.nth(0));
+	EXPECT_EQ(0u, s.rank(5));
+	EXPECT_EQ(0u, s.index_of(s.end()));
+	EXPECT_EQ(0u, s.count_range(1, 10));
+}
+
+TEST(order_statistics, random_against_sorted_vector) {
+	std::mt19937 gen(3);
+	std::uniform_int_distribution<int> dist(0, 3000);
+	std::set<int> a;
+	set<int> b;
+	for (int step = 0; step < 20000; step++) {
+		int x = dist(gen);
+		if (step % 4 == 0) {
+			auto it = b.find(x);
+			if (it != b.end()) {
+				a.erase(x);
+				b.erase(it);
+			}
+		}
+		else {
+			a.insert(x);
+			b.insert(x);
+		}
+		ASSERT_EQ(a.size(), b.size());
+	}
+
+	std::vector<int> v(a.begin(), a.end());
+	for (std::size_t k = 0; k < v.size(); k += 7) {
+		ASSERT_EQ(v[k], *b.nth(k));
+		ASSERT_EQ(k, b.index_of(b.nth(k)));
+		ASSERT_EQ(k, b.rank(v[k]));
+	}
+	ASSERT_EQ(b.end(), b.nth(v.size()));
+	ASSERT_EQ(v.size(), b.index_of(b.end()));
+	for (int i = 0; i < 100; i++) {
+		int lo = dist(gen), hi = dist(gen);
+		auto expected = std::lower_bound(v.begin(), v.end(), hi) - std::lower_bound(v.begin(), v.end(), lo);
+		ASSERT_EQ(std::size_t(std::max<std::ptrdiff_t>(expected, 0)), b.count_range(lo, hi));
+	}
+
+	set<int> copy(b);
+	ASSERT_EQ(b.size(), copy.size());
+	ASSERT_EQ(v[v.size() / 2], *copy.nth(v.size() / 2));
+}
+
+TEST(bulk_insert, hinted_insert) {
+	set<int> s;
+	auto hint = s.end();
+	for (int i = 0; i < 1000; i++)
+		hint = s.insert(s.end(), i);
+	EXPECT_EQ(999, *hint);
+	EXPECT_EQ(500, *s.insert(s.begin(), 500));
+	EXPECT_EQ(1000u, s.size());
+	EXPECT_LE(s.height(), rb_height_limit(1000));
+}
+
+TEST(bulk_insert, sorted_range_merge_keeps_iterators) {
+	set<int> s;
+	for (int i = 0; i < 1000; i += 3)
+		s.insert(i);
+	auto kept = s.find(300);
+	std::vector<int> batch;
+	for (int i = 0; i < 1000; i += 2)
+		batch.push_back(i);
+	s.insert(batch.begin(), batch.end());
+
+	std::set<int> expected;
+	for (int i = 0; i < 1000; i += 3)
+		expected.insert(i);
+	expected.insert(batch.begin(), batch.end());
+	ASSERT_TRUE(std::equal(expected.begin(), expected.end(), s.begin(), s.end()));
+	EXPECT_EQ(expected.size(), s.size());
+	EXPECT_EQ(300, *kept);
+	EXPECT_EQ(302, *++kept);
+	EXPECT_LE(s.height(), min_height(s.size()));
+}
+
+TEST(bulk_insert, small_sorted_and_unsorted_ranges) {
+	set<int> s;
+	for (int i = 0; i < 10000; i++)
+		s.insert(i * 10);
+	std::vector<int> few = { 5, 15, 20, 99995, 100000, 100010 };
+	s.insert(few.begin(), few.end());
+	EXPECT_EQ(10005u, s.size());
+	EXPECT_EQ(100010, *--s.end());
+	EXPECT_EQ(15, *s.nth(3));
+
+	std::vector<int> unsorted = { 7, 3, 7, 100020, -1 };
+	s.insert(unsorted.begin(), unsorted.end());
+	EXPECT_EQ(10009u, s.size());
+	EXPECT_EQ(-1, *s.begin());
+	EXPECT_LE(s.height(), rb_height_limit(s.size()));
+}
+
+TEST(bulk_insert, assume_sorted_unique) {
+	std::vector<std::string> dump = { "a", "b", "c", "d", "e" };
+	set<std::string> s(assume_sorted_unique, dump.begin(), dump.end());
+	EXPECT_EQ(5u, s.size());
+	EXPECT_EQ(min_height(5), s.height());
+	EXPECT_EQ("c", *s.nth(2));
+	s.insert("bb");
+	EXPECT_EQ("bb", *s.nth(2));
+}
+
+template <typename S>
+std::vector<int> to_vector(S const &s) {
+	return std::vector<int>(s.begin(), s.end());
+}
+
+TEST(set_algebra, against_std_algorithms) {
+	std::mt19937 gen(11);
+	for (int round = 0; round < 200; round++) {
+		int range = 1 + int(gen() % 2000);
+		set<int> a, b;
+		for (int i = int(gen() % 100); i > 0; i--)
+			a.insert(int(gen() % range));
+		for (int i = int(gen() % 1500); i > 0; i--)
+			b.insert(int(gen() % range));
+		if (round % 2)
+			swap(a, b);
+
+		std::vector<int> u, in, d, sd;
+		std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(u));
+		std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(in));
+		std::set_difference(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(d));
+		std::set_symmetric_difference(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(sd));
+
+		ASSERT_EQ(u, to_vector(set_union(a, b)));
+		ASSERT_EQ(in, to_vector(set_intersection(a, b)));
+		ASSERT_EQ(d, to_vector(set_difference(a, b)));
+		ASSERT_EQ(sd, to_vector(set_symmetric_difference(a, b)));
+
+		set<int> joined = set_union(set<int>(a), set<int>(b));
+		ASSERT_EQ(u.size(), joined.size());
+		ASSERT_LE(joined.height(), rb_height_limit(joined.size()));
+		set<int> common = set_intersection(set<int>(a), set<int>(b));
+		ASSERT_EQ(in, to_vector(common));
+		ASSERT_LE(common.height(), rb_height_limit(common.size()));
+		ASSERT_EQ(d, to_vector(set_difference(set<int>(a), set<int>(b))));
+		ASSERT_EQ(sd, to_vector(set_symmetric_difference(set<int>(a), set<int>(b))));
+	}
+}
+
+TEST(set_algebra, in_place_reuses_nodes) {
+	set<int> index;
+	for (int i = 0; i < 100000; i++)
+		index.insert(i);
+	set<int> filter;
+	mass_push_back(filter, { -5, 10, 99999, 100001 });
+	int const * kept = &*index.find(10);
+
+	set<int> result = set_intersection(std::move(index), std::move(filter));
+	expect_eq(result, { 10, 99999 });
+	EXPECT_EQ(kept, &*result.find(10));
+	EXPECT_TRUE(index.empty());
+	EXPECT_TRUE(filter.empty());
+
+	set<int> extra;
+	mass_push_back(extra, { 1, 2, 3 });
+	int const * moved = &*extra.find(2);
+	result = set_union(std::move(result), std::move(extra));
+	expect_eq(result, { 1, 2, 3, 10, 99999 });
+	EXPECT_EQ(moved, &*result.find(2));
+	EXPECT_EQ(2, *result.nth(1));
+}
+
+TEST(set_algebra, distinct_pools) {
+	pooled_set a, b;
+	mass_push_back(a, { 1, 2, 3 });
+	mass_push_back(b, { 3, 4 });
+	pooled_set c = set_symmetric_difference(std::move(a), std::move(b));
+	b.insert(7);
+	b.clear();
+	expect_eq(c, { 1, 2, 4 });
+}
+
+TEST(node_handles, extract_and_insert) {
+	set<std::string> a, b;
+	mass_push_back(a, { std::string("x"), std::string("y"), std::string("z") });
+	std::string const * address = &*a.find("y");
+
+	auto handle = a.extract(a.find("y"));
+	ASSERT_FALSE(handle.empty());
+	EXPECT_EQ("y", handle.value());
+	expect_eq(a, { std::string("x"), std::string("z") });
+	EXPECT_TRUE(a.extract("missing").empty());
+
+	auto result = b.insert(std::move(handle));
+	EXPECT_TRUE(result.inserted);
+	EXPECT_TRUE(result.node.empty());
+	EXPECT_EQ(address, &*result.position);
+
+	auto moved = a.extract("x");
+	moved.value() = "y";
+	auto rejected = b.insert(std::move(moved));
+	EXPECT_FALSE(rejected.inserted);
+	EXPECT_EQ("y", rejected.node.value());
+	EXPECT_EQ(1u, b.size());
+
+	rejected.node.value() = "w";
+	EXPECT_EQ("w", *b.insert(b.begin(), std::move(rejected.node)));
+	expect_eq(b, { std::string("w"), std::string("y") });
+}
+
+TEST(node_handles, merge_leaves_duplicates) {
+	set<int> a, b;
+	mass_push_back(a, { 1, 3, 5 });
+	mass_push_back(b, { 2, 3, 4, 5, 6 });
+	int const * four = &*b.find(4);
+	a.merge(b);
+	expect_eq(a, { 1, 2, 3, 4, 5, 6 });
+	expect_eq(b, { 3, 5 });
+	EXPECT_EQ(four, &*a.find(4));
+	EXPECT_EQ(6u, a.size());
+	EXPECT_EQ(2u, b.size());
+}
+
+TEST(node_handles, split_and_join) {
+	set<int> s;
+	for (int i = 0; i < 10000; i++)
+		s.insert(i);
+	int const * middle = &*s.find(6000);
+
+	auto parts = s.split(6000);
+	EXPECT_TRUE(s.empty());
+	EXPECT_EQ(6000u, parts.first.size());
+	EXPECT_EQ(4000u, parts.second.size());
+	EXPECT_EQ(5999, *--parts.first.end());
+	EXPECT_EQ(middle, &*parts.second.begin());
+	EXPECT_LE(parts.first.height(), rb_height_limit(parts.first.size()));
+	EXPECT_LE(parts.second.height(), rb_height_limit(parts.second.size()));
+
+	auto low = parts.first.split(-1);
+	EXPECT_TRUE(low.first.empty());
+	EXPECT_EQ(6000u, low.second.size());
+
+	set<int> whole = set<int>::join(std::move(low.second), std::move(parts.second));
+	EXPECT_EQ(10000u, whole.size());
+	EXPECT_LE(whole.height(), rb_height_limit(whole.size()));
+	for (int i = 0; i < 10000; i += 37)
+		ASSERT_EQ(i, *whole.nth(std::size_t(i)));
+
+	set<int> empty;
+	whole = set<int>::join(std::move(empty), std::move(whole));
+	EXPECT_EQ(10000u, whole.size());
+}
+
+TEST(btree, matches_set_interface) {
+	btree_set<int> s;
+	EXPECT_TRUE(s.empty());
+	EXPECT_EQ(s.begin(), s.end());
+	mass_push_back(s, { 5, 3, 8, 1, 4, 7, 9, 2, 6 });
+	EXPECT_FALSE(s.insert(4).second);
+	expect_eq(s, { 1, 2, 3, 4, 5, 6, 7, 8, 9 });
+	expect_reverse_eq(s, { 9, 8, 7, 6, 5, 4, 3, 2, 1 });
+	EXPECT_EQ(4, *s.find(4));
+	EXPECT_EQ(s.end(), s.find(10));
+	EXPECT_EQ(s.end(), s.lower_bound(10));
+	EXPECT_EQ(1, *s.upper_bound(0));
+	EXPECT_EQ(s.end(), s.erase(s.find(9)));
+	EXPECT_EQ(3, *s.erase(s.find(2)));
+	expect_eq(s, { 1, 3, 4, 5, 6, 7, 8 });
+}
+
+/*
+* Values this wide leave three slots per node, so a few thousand
+* elements already give a deep tree with every rebalancing case.
+*/
+struct wide_key {
+	int key;
+	char padding[100];
+
+	wide_key(int key) : key(key), padding() {}
+
+	friend bool operator<(wide_key const &lhs, wide_key const &rhs) {
+		return lhs.key < rhs.key;
+	}
+};
+
+TEST(btree, random_against_std) {
+	static_assert(btree_set<wide_key>::node_slots == 3, "wide_key should give minimal nodes");
+	std::mt19937 gen(7);
+	std::uniform_int_distribution<int> dist(0, 3000);
+	std::set<int> a;
+	btree_set<wide_key> b;
+	for (int i = 0; i < 50000; i++) {
+		int x = dist(gen);
+		if (i % 2 == 0) {
+			auto it = b.find(x);
+			ASSERT_EQ(a.count(x) == 1, it != b.end());
+			if (it != b.end()) {
+				auto next = a.upper_bound(x);
+				auto after = b.erase(it);
+				a.erase(x);
+				if (next == a.end()) {
+					ASSERT_EQ(b.end(), after);
+				}
+				else {
+					ASSERT_EQ(*next, after->key);
+				}
+			}
+		}
+		else {
+			ASSERT_EQ(a.insert(x).second, b.insert(x).second);
+		}
+		ASSERT_EQ(a.size(), b.size());
+	}
+	std::vector<int> keys;
+	for (auto const &v : b)
+		keys.push_back(v.key);
+	ASSERT_TRUE(std::equal(a.begin(), a.end(), keys.begin(), keys.end()));
+	keys.clear();
+	for (auto it = b.rbegin(); it != b.rend(); ++it)
+		keys.push_back(it->key);
+	ASSERT_TRUE(std::equal(a.rbegin(), a.rend(), keys.begin(), keys.end()));
+
+	for (int x = -1; x <= 3001; x++) {
+		auto lb = b.lower_bound(x);
+		auto ub = b.upper_bound(x);
+		ASSERT_EQ(a.lower_bound(x) == a.end(), lb == b.end());
+		ASSERT_EQ(a.upper_bound(x) == a.end(), ub == b.end());
+		if (lb != b.end()) {
+			ASSERT_EQ(*a.lower_bound(x), lb->key);
+		}
+		if (ub != b.end()) {
+			ASSERT_EQ(*a.upper_bound(x), ub->key);
+		}
+	}
+}
+
+TEST(btree, shallow_and_compact) {
+	const int n = 1000000;
+	btree_set<int> s;
+	for (int i = 0; i < n; i++)
+		s.insert(i);
+	EXPECT_LE(s.height(), 4u);
+	EXPECT_LT(s.height(), min_height(n) / 3);
+	for (int i = 0; i < n; i += 2)
+		s.erase(s.find(i));
+	EXPECT_EQ(std::size_t(n / 2), s.size());
+	int expected = 1;
+	for (int x : s) {
+		ASSERT_EQ(expected, x);
+		expected += 2;
+	}
+}
+
+TEST(btree, copy_move_and_owning_values) {
+	btree_set<std::string> a;
+	for (int i = 0; i < 2000; i++)
+		a.insert(std::to_string(i));
+	btree_set<std::string> b(a);
+	for (int i = 0; i < 2000; i += 3)
+		b.erase(b.find(std::to_string(i)));
+	EXPECT_EQ(2000u, a.size());
+	EXPECT_EQ(1333u, b.size());
+	EXPECT_TRUE(a.contains("999"));
+	EXPECT_FALSE(b.contains("999"));
+
+	btree_set<std::string> c(std::move(b));
+	EXPECT_TRUE(b.empty());
+	EXPECT_EQ(1333u, c.size());
+	c = a;
+	EXPECT_TRUE(std::equal(a.begin(), a.end(), c.begin(), c.end()));
+	a.clear();
+	EXPECT_TRUE(a.empty());
+	EXPECT_EQ("999", *--c.end());
+}
+
+TEST(btree, assignment_respects_allocators) {
+	using tagged_btree_set = btree_set<std::string, std::less<std::string>, tagged_allocator<std::string>>;
+	int mismatched = tagged_mismatched_frees();
+	{
+		tagged_btree_set a(std::less<std::string>(), tagged_allocator<std::string>(1));
+		tagged_btree_set b(std::less<std::string>(), tagged_allocator<std::string>(2));
+		for (int i = 0; i < 500; i++)
+			a.insert(std::to_string(i));
+		b.insert("x");
+
+		// Unequal allocators that do not propagate: both assignments copy or move element-wise.
+		b = a;
+		EXPECT_EQ(2, b.get_allocator().id);
+		EXPECT_TRUE(std::equal(a.begin(), a.end(), b.begin(), b.end()));
+		b = std::move(a);
+		EXPECT_EQ(2, b.get_allocator().id);
+		EXPECT_TRUE(a.empty());
+		EXPECT_EQ(500u, b.size());
+		EXPECT_EQ("99", *--b.end());
+
+		tagged_btree_set c(std::less<std::string>(), tagged_allocator<std::string>(2));
+		c = std::move(b);
+		EXPECT_TRUE(b.empty());
+		EXPECT_EQ(500u, c.size());
+		swap(b, c);
+		EXPECT_EQ(2, c.get_allocator().id);
+		EXPECT_EQ(500u, b.size());
+	}
+	EXPECT_EQ(mismatched, tagged_mismatched_frees());
+}
+
+TEST(flat_set, lookups_against_std) {
+	std::mt19937 gen(11);
+	std::uniform_int_distribution<int> dist(0, 2000);
+	std::vector<int> keys;
+	for (int i = 0; i < 1500; i++)
+		keys.push_back(dist(gen));
+	std::set<int> a(keys.begin(), keys.end());
+	flat_set<int> f(keys.begin(), keys.end());
+	ASSERT_EQ(a.size(), f.size());
+	ASSERT_TRUE(std::equal(a.begin(), a.end(), f.begin(), f.end()));
+	for (int x = -1; x <= 2001; x++) {
+		ASSERT_EQ(a.count(x), f.count(x));
+		ASSERT_EQ(std::distance(a.begin(), a.lower_bound(x)), f.lower_bound(x) - f.begin());
+		ASSERT_EQ(std::distance(a.begin(), a.upper_bound(x)), f.upper_bound(x) - f.begin());
+		if (a.count(x)) {
+			ASSERT_EQ(x, *f.find(x));
+		}
+		else {
+			ASSERT_EQ(f.end(), f.find(x));
+		}
+	}
+	flat_set<int> empty;
+	EXPECT_EQ(empty.end(), empty.find(0));
+	EXPECT_EQ(empty.end(), empty.lower_bound(0));
+	EXPECT_EQ(empty.end(), empty.upper_bound(0));
+}
+
+TEST(flat_set, batched_updates) {
+	flat_set<int> f;
+	mass_push_back(f, { 10, 20, 30, 40 });
+	EXPECT_FALSE(f.insert(20).second);
+
+	std::vector<int> batch = { 35, 5, 20, 45, 5, 25 };
+	f.insert(batch.begin(), batch.end());
+	expect_eq(f, { 5, 10, 20, 25, 30, 35, 40, 45 });
+
+	std::vector<int> tail = { 50, 60 };
+	f.insert(assume_sorted_unique, tail.begin(), tail.end());
+	expect_eq(f, { 5, 10, 20, 25, 30, 35, 40, 45, 50, 60 });
+
+	EXPECT_EQ(1u, f.erase(25));
+	EXPECT_EQ(0u, f.erase(25));
+	EXPECT_EQ(35, *f.erase(f.find(30)));
+	f.erase(f.begin(), f.lower_bound(20));
+	expect_eq(f, { 20, 35, 40, 45, 50, 60 });
+	EXPECT_EQ(40, *f.nth(2));
+	EXPECT_EQ(2u, f.rank(40));
+
+	std::mt19937 gen(5);
+	std::set<int> a(f.begin(), f.end());
+	for (int round = 0; round < 50; round++) {
+		std::vector<int> more;
+		for (int i = 0; i < 40; i++)
+			more.push_back(int(gen() % 1000));
+		a.insert(more.begin(), more.end());
+		f.insert(more.begin(), more.end());
+		ASSERT_TRUE(std::equal(a.begin(), a.end(), f.begin(), f.end()));
+	}
+}
+
+TEST(flat_set, conversion_round_trip) {
+	set<std::string> s;
+	for (int i = 0; i < 1000; i++)
+		s.insert(std::to_string(i));
+	flat_set<std::string> f(s);
+	ASSERT_TRUE(std::equal(s.begin(), s.end(), f.begin(), f.end()));
+
+	set<std::string> copied = f.to_set();
+	EXPECT_LE(copied.height(), min_height(copied.size()));
+	EXPECT_TRUE(std::equal(s.begin(), s.end(), copied.begin(), copied.end()));
+
+	set<std::string> moved = std::move(f).to_set();
+	EXPECT_TRUE(f.empty());
+	EXPECT_TRUE(std::equal(s.begin(), s.end(), moved.begin(), moved.end()));
+}
+
+template <typename T, typename Frozen, typename Keys>
+void expect_frozen_matches(Frozen const &f, Keys const &keys, std::vector<T> const &probes) {
+	ASSERT_EQ(keys.size(), f.size());
+	ASSERT_TRUE(std::equal(keys.begin(), keys.end(), f.begin(), f.end()));
+	ASSERT_TRUE(std::equal(keys.rbegin(), keys.rend(), f.rbegin(), f.rend()));
+	for (T const &x : probes) {
+		auto lb = keys.lower_bound(x), ub = keys.upper_bound(x);
+		auto flb = f.lower_bound(x), fub = f.upper_bound(x);
+		ASSERT_EQ(lb == keys.end(), flb == f.end());
+		ASSERT_EQ(ub == keys.end(), fub == f.end());
+		if (lb != keys.end()) {
+			ASSERT_EQ(*lb, *flb);
+		}
+		if (ub != keys.end()) {
+			ASSERT_EQ(*ub, *fub);
+		}
+		ASSERT_EQ(keys.count(x) == 1, f.contains(x));
+	}
+}
+
+TEST(frozen, int_keys_every_size) {
+	std::vector<int> probes;
+	for (int x = -3; x < 700; x++)
+		probes.push_back(x);
+	for (int n : { 0, 1, 2, 15, 16, 17, 31, 48, 49, 100, 255, 256, 257, 300 }) {
+		set<int> s;
+		for (int i = 0; i < n; i++)
+			s.insert(2 * i + 1);
+		std::set<int> keys(s.begin(), s.end());
+		expect_frozen_matches(s.freeze(), keys, probes);
+
+		set<std::int64_t> wide(s.begin(), s.end());
+		std::set<std::int64_t> wide_keys(s.begin(), s.end());
+		expect_frozen_matches(wide.freeze(), wide_keys, std::vector<std::int64_t>(probes.begin(), probes.end()));
+	}
+}
+
+TEST(frozen, scalar_fallback_types) {
+	std::mt19937 gen(9);
+	std::set<double> dkeys;
+	std::set<std::string> skeys;
+	std::set<unsigned> ukeys;
+	for (int i = 0; i < 3000; i++) {
+		dkeys.insert(double(gen() % 10000) / 8);
+		skeys.insert(std::to_string(gen() % 5000));
+		ukeys.insert(unsigned(gen()));
+	}
+	std::vector<double> dprobes;
+	std::vector<std::string> sprobes;
+	std::vector<unsigned> uprobes(ukeys.begin(), ukeys.end());
+	for (int i = -8; i < 10008; i += 3)
+		dprobes.push_back(double(i) / 8);
+	for (int i = 0; i < 6000; i += 7)
+		sprobes.push_back(std::to_string(i));
+	for (int i = 0; i < 1000; i++)
+		uprobes.push_back(unsigned(gen()));
+
+	set<double> ds(dkeys.begin(), dkeys.end());
+	set<std::string> ss(skeys.begin(), skeys.end());
+	set<unsigned> us(ukeys.begin(), ukeys.end());
+	expect_frozen_matches(ds.freeze(), dkeys, dprobes);
+	expect_frozen_matches(ss.freeze(), skeys, sprobes);
+	expect_frozen_matches(us.freeze(), ukeys, uprobes);
+}
+
+TEST(frozen, copy_comparator_and_thaw) {
+	set<long long, std::greater<long long>> s;
+	for (long long i = 0; i < 1000; i++)
+		s.insert(i * 3);
+	frozen_set<long long, std::greater<long long>> f = s.freeze();
+	EXPECT_EQ(999 * 3, *f.begin());
+	EXPECT_EQ(300, *f.lower_bound(301));
+	EXPECT_EQ(297, *f.upper_bound(300));
+
+	auto copy = f;
+	auto moved = std::move(f);
+	EXPECT_TRUE(f.empty());
+	EXPECT_TRUE(std::equal(copy.begin(), copy.end(), s.begin(), s.end()));
+
+	auto thawed = moved.thaw();
+	EXPECT_TRUE(std::equal(thawed.begin(), thawed.end(), s.begin(), s.end()));
+	EXPECT_LE(thawed.height(), min_height(thawed.size()));
+}
+
+template <typename S>
+void expect_extremes(S const &s, std::set<int> const &expected) {
+	ASSERT_EQ(expected.size(), s.size());
+	ASSERT_EQ(expected.empty(), s.begin() == s.end());
+	if (expected.empty())
+		return;
+	ASSERT_EQ(*expected.begin(), *s.begin());
+	ASSERT_EQ(*expected.begin(), s.front());
+	ASSERT_EQ(*expected.rbegin(), *s.rbegin());
+	ASSERT_EQ(*expected.rbegin(), s.back());
+	ASSERT_EQ(*expected.rbegin(), *--s.end());
+}
+
+TEST(extremes, ordered_queue) {
+	set<int> s;
+	std::set<int> expected;
+	std::mt19937 gen(3);
+	for (int round = 0; round < 20000; round++) {
+		int x = int(gen() % 1000);
+		switch (gen() % 4) {
+		case 0:
+			if (!s.empty()) {
+				expected.erase(expected.begin());
+				s.pop_front();
+			}
+			break;
+		case 1:
+			if (!s.empty()) {
+				expected.erase(std::prev(expected.end()));
+				s.pop_back();
+			}
+			break;
+		default:
+			expected.insert(x);
+			s.insert(x);
+		}
+		expect_extremes(s, expected);
+	}
+	while (!s.empty())
+		s.pop_front();
+	EXPECT_EQ(s.begin(), s.end());
+	s.insert(5);
+	EXPECT_EQ(5, s.front());
+	EXPECT_EQ(5, s.back());
+}
+
+TEST(extremes, bulk_operations_keep_cache) {
+	set<int> a, b;
+	for (int i = 0; i < 100; i++)
+		a.insert(i);
+	std::set<int> ea(a.begin(), a.end()), eb;
+	a.swap(b);
+	expect_extremes(a, eb);
+	expect_extremes(b, ea);
+
+	set<int> moved(std::move(b));
+	expect_extremes(b, eb);
+	expect_extremes(moved, ea);
+	b = std::move(moved);
+	expect_extremes(moved, eb);
+	expect_extremes(b, ea);
+
+	auto parts = b.split(40);
+	expect_extremes(b, eb);
+	expect_extremes(parts.first, std::set<int>(ea.begin(), ea.find(40)));
+	expect_extremes(parts.second, std::set<int>(ea.find(40), ea.end()));
+	set<int> joined = set<int>::join(std::move(parts.first), std::move(parts.second));
+	expect_extremes(joined, ea);
+
+	std::vector<int> more = { -5, 150, 151 };
+	joined.insert(more.begin(), more.end());
+	ea.insert(more.begin(), more.end());
+	expect_extremes(joined, ea);
+
+	set<int> low;
+	low.insert(-10);
+	low.insert(200);
+	joined.merge(low);
+	ea.insert(-10);
+	ea.insert(200);
+	expect_extremes(joined, ea);
+
+	set<int> evens;
+	for (int i = -10; i <= 200; i += 2)
+		evens.insert(i);
+	set<int> both = set_intersection(std::move(joined), std::move(evens));
+	EXPECT_EQ(-10, both.front());
+	EXPECT_EQ(200, both.back());
+	both.extract(both.begin());
+	both.extract(200);
+	EXPECT_EQ(0, both.front());
+	EXPECT_EQ(150, both.back());
+	both.clear();
+	expect_extremes(both, eb);
+}
+
+TEST(concurrent, single_thread_semantics) {
+	concurrent_set<int> s;
+	EXPECT_TRUE(s.empty());
+	EXPECT_FALSE(s.lower_bound(0).has_value());
+	for (int i = 0; i < 1000; i += 2)
+		EXPECT_TRUE(s.insert(i));
+	EXPECT_FALSE(s.insert(10));
+	EXPECT_EQ(500u, s.size());
+	EXPECT_TRUE(s.contains(10));
+	EXPECT_FALSE(s.contains(11));
+	EXPECT_EQ(12, *s.lower_bound(11));
+	EXPECT_EQ(12, *s.upper_bound(10));
+	EXPECT_EQ(10, *s.find(10));
+	EXPECT_FALSE(s.upper_bound(998).has_value());
+	EXPECT_TRUE(s.erase(10));
+	EXPECT_FALSE(s.erase(10));
+	EXPECT_EQ(12, *s.lower_bound(9));
+
+	set<int> copy = s.to_set();
+	EXPECT_EQ(499u, copy.size());
+	EXPECT_EQ(0, copy.front());
+	EXPECT_EQ(998, copy.back());
+}
+
+TEST(concurrent, readers_and_writers) {
+	// Even keys are permanent; writers churn the odd ones.
+	const int n = 4000;
+	concurrent_set<int> s;
+	for (int i = 0; i < n; i += 2)
+		s.insert(i);
+
+	std::atomic<bool> stop{ false };
+	std::atomic<int> reader_errors{ 0 };
+	std::vector<std::thread> threads;
+	for (int w = 0; w < 2; w++) {
+		threads.emplace_back([&, w] {
+			std::mt19937 gen(w);
+			for (int round = 0; round < 20000; round++) {
+				int x = 2 * int(gen() % (n / 2)) + 1;
+				if (gen() % 2)
+					s.insert(x);
+				else
+					s.erase(x);
+			}
+		});
+	}
+	for (int r = 0; r < 3; r++) {
+		threads.emplace_back([&, r] {
+			std::mt19937 gen(100 + r);
+			while (!stop.load()) {
+				int x = 2 * int(gen() % (n / 2));
+				if (!s.contains(x) || *s.lower_bound(x) != x || *s.lower_bound(x - 1) > x)
+					reader_errors++;
+			}
+		});
+	}
+	threads[0].join();
+	threads[1].join();
+	stop = true;
+	for (std::size_t i = 2; i < threads.size(); i++)
+		threads[i].join();
+	EXPECT_EQ(0, reader_errors.load());
+
+	int previous = -1;
+	std::size_t seen = 0;
+	s.for_each([&](int x) {
+		EXPECT_LT(previous, x);
+		previous = x;
+		seen++;
+	});
+	EXPECT_EQ(s.size(), seen);
+	for (int i = 0; i < n; i += 2)
+		ASSERT_TRUE(s.contains(i));
+}
+
+TEST(persistent, snapshots_are_isolated) {
+	std::mt19937 gen(16);
+	persistent_set<int> s;
+	std::set<int> live;
+	std::vector<persistent_set<int>> snaps;
+	std::vector<std::set<int>> expected;
+	for (int round = 0; round < 4000; round++) {
+		int x = int(gen() % 500);
+		if (gen() % 3)
+			EXPECT_EQ(live.insert(x).second, s.insert(x));
+		else
+			EXPECT_EQ(live.erase(x) == 1, s.erase(x));
+		if (round % 500 == 0) {
+			snaps.push_back(s.snapshot());
+			expected.push_back(live);
+		}
+	}
+	EXPECT_TRUE(std::equal(s.begin(), s.end(), live.begin(), live.end()));
+	EXPECT_TRUE(std::equal(s.rbegin(), s.rend(), live.rbegin(), live.rend()));
+	EXPECT_LE(s.height(), std::size_t(1.45 * std::log2(s.size() + 2)));
+	for (std::size_t i = 0; i < snaps.size(); i++) {
+		ASSERT_EQ(expected[i].size(), snaps[i].size());
+		EXPECT_TRUE(std::equal(snaps[i].begin(), snaps[i].end(), expected[i].begin()));
+	}
+
+	persistent_set<int> const &last = snaps.back();
+	for (int x = -1; x <= 500; x++) {
+		auto lo = expected.back().lower_bound(x);
+		auto it = last.lower_bound(x);
+		ASSERT_EQ(lo == expected.back().end(), it == last.end());
+		if (it != last.end()) {
+			EXPECT_EQ(*lo, *it);
+		}
+		EXPECT_EQ(std::size_t(std::distance(expected.back().begin(), lo)), last.rank(x));
+	}
+	EXPECT_EQ(*last.nth(3), *std::next(expected.back().begin(), 3));
+	set<int> copy = last.to_set();
+	EXPECT_TRUE(std::equal(copy.begin(), copy.end(), expected.back().begin(), expected.back().end()));
+}
+
+TEST(persistent, update_copies_only_the_path) {
+	persistent_set<copy_counter> s;
+	for (int i = 0; i < 1024; i++)
+		s.insert(copy_counter(i));
+	std::size_t height = s.height();
+
+	copy_counter::copies = 0;
+	persistent_set<copy_counter> snap = s.snapshot();
+	EXPECT_EQ(0, copy_counter::copies);
+	s.insert(copy_counter(5000));
+	EXPECT_GT(copy_counter::copies, 0);
+	EXPECT_LE(std::size_t(copy_counter::copies), height + 1);
+
+	copy_counter::copies = 0;
+	s.erase(copy_counter(512));
+	EXPECT_LE(std::size_t(copy_counter::copies), 2 * height);
+
+	// Without live snapshots updates work in place; the one copy is the new element.
+	snap.clear();
+	copy_counter::copies = 0;
+	s.insert(copy_counter(6000));
+	s.erase(copy_counter(100));
+	EXPECT_EQ(1, copy_counter::copies);
+
+	EXPECT_EQ(1024u, s.size());
+	EXPECT_FALSE(s.contains(copy_counter(512)));
+}
+
+TEST(parallel, bulk_build) {
+	thread_pool pool(4);
+	std::mt19937 gen(17);
+	std::vector<int> keys(100000);
+	for (int &k : keys)
+		k = int(gen() % 60000);
+	set<int> s(pool, keys.begin(), keys.end());
+	std::set<int> expected(keys.begin(), keys.end());
+	ASSERT_EQ(expected.size(), s.size());
+	EXPECT_TRUE(std::equal(s.begin(), s.end(), expected.begin()));
+	EXPECT_LE(s.height(), rb_height_limit(s.size()));
+	EXPECT_EQ(*expected.begin(), s.front());
+	EXPECT_EQ(*expected.rbegin(), s.back());
+
+	// Allocators that do not opt in get their nodes on the calling thread.
+	pooled_set p(pool, keys.begin(), keys.end());
+	EXPECT_TRUE(std::equal(p.begin(), p.end(), expected.begin(), expected.end()));
+
+	// Always equal, but its counter is not atomic.
+	static_assert(allows_concurrent_allocation<std::allocator<myset_detail::set_node<int>>>::value, "");
+	static_assert(!allows_concurrent_allocation<counting_allocator<myset_detail::set_node<int>>>::value, "");
+	int before = counting_allocator<myset_detail::set_node<int>>::allocations;
+	set<int, std::less<int>, counting_allocator<int>> counted(pool, keys.begin(), keys.end());
+	EXPECT_EQ(expected.size(), std::size_t(counting_allocator<myset_detail::set_node<int>>::allocations - before));
+
+	std::vector<std::string> words{ "b", "a", "c", "a" };
+	set<std::string> w(pool, words.begin(), words.end());
+	expect_eq(w, { "a", "b", "c" });
+}
+
+struct copied_key {
+	static int copies;
+	int x = 0;
+
+	copied_key() = default;
+	copied_key(int x) : x(x) {}
+	copied_key(copied_key const &other) : x(other.x) { copies++; }
+	copied_key(copied_key &&) = default;
+	copied_key& operator=(copied_key const &other) { x = other.x; copies++; return *this; }
+	copied_key& operator=(copied_key &&) = default;
+
+	friend bool operator<(copied_key const &a, copied_key const &b) { return a.x < b.x; }
+};
+
+int copied_key::copies = 0;
+
+TEST(parallel, bulk_build_copies_input_once) {
+	thread_pool pool(2);
+	std::vector<copied_key> keys;
+	for (int i = 0; i < 20000; i++)
+		keys.emplace_back(int((i * 7919) % 15000));
+	copied_key::copies = 0;
+	set<copied_key> s(pool, keys.begin(), keys.end());
+	EXPECT_EQ(int(keys.size()), copied_key::copies);
+	EXPECT_EQ(15000u, s.size());
+	EXPECT_EQ(14999, s.back().x);
+}
+
+TEST(parallel, set_algebra_matches_sequential) {
+	thread_pool pool(3);
+	std::mt19937 gen(170);
+	std::vector<int> xs(50000), ys(30000);
+	for (int &x : xs)
+		x = int(gen() % 80000);
+	for (int &y : ys)
+		y = int(gen() % 80000);
+	set<int> a(xs.begin(), xs.end());
+	set<int> b(ys.begin(), ys.end());
+
+	auto check = [&](set<int> const &parallel, set<int> const &sequential) {
+		ASSERT_EQ(sequential.size(), parallel.size());
+		EXPECT_TRUE(std::equal(parallel.begin(), parallel.end(), sequential.begin()));
+		EXPECT_LE(parallel.height(), rb_height_limit(parallel.size()));
+	};
+	check(set_union(pool, a, b), set_union(a, b));
+	check(set_intersection(pool, a, b), set_intersection(a, b));
+	check(set_difference(pool, a, b), set_difference(a, b));
+	check(set_symmetric_difference(pool, a, b), set_symmetric_difference(a, b));
+	check(set_union(pool, set<int>(a), set<int>()), a);
+}
+
+TEST(parallel, pool_rethrows_after_both_halves) {
+	thread_pool pool(2);
+	std::atomic<int> finished{ 0 };
+	EXPECT_THROW(pool.invoke([] { throw std::runtime_error("left"); }, [&] { finished++; }), std::runtime_error);
+	EXPECT_EQ(1, finished.load());
+	std::vector<int> hits(10000, 0);
+	pool.parallel_for(hits.size(), 100, [&](std::size_t first, std::size_t last) {
+		for (std::size_t i = first; i < last; i++)
+			hits[i]++;
+	});
+	EXPECT_EQ(hits.size(), std::size_t(std::count(hits.begin(), hits.end(), 1)));
+}
+
+TEST(batch, matches_single_lookups) {
+	std::mt19937 gen(18);
+	set<int> s;
+	for (int i = 0; i < 5000; i++)
+		s.insert(int(gen() % 20000));
+	std::vector<int> probes(1000 + 7);
+	for (int &p : probes)
+		p = int(gen() % 20002) - 1;
+
+	std::vector<set<int>::const_iterator> found, lower;
+	std::vector<bool> present;
+	s.find_batch(probes.begin(), probes.end(), std::back_inserter(found));
+	s.lower_bound_batch(probes.begin(), probes.end(), std::back_inserter(lower));
+	s.contains_batch(probes.begin(), probes.end(), std::back_inserter(present));
+	ASSERT_EQ(probes.size(), found.size());
+	ASSERT_EQ(probes.size(), lower.size());
+	ASSERT_EQ(probes.size(), present.size());
+	for (std::size_t i = 0; i < probes.size(); i++) {
+		EXPECT_TRUE(found[i] == s.find(probes[i]));
+		EXPECT_TRUE(lower[i] == s.lower_bound(probes[i]));
+		EXPECT_EQ(s.contains(probes[i]), present[i]);
+	}
+
+	set<int> empty;
+	bool flags[3] = { true, true, true };
+	EXPECT_EQ(flags + 3, empty.contains_batch(probes.begin(), probes.begin() + 3, flags));
+	EXPECT_FALSE(flags[0] || flags[1] || flags[2]);
+}
+
+TEST(batch, transparent_keys) {
+	set<std::string, std::less<>> s;
+	s.insert("apple");
+	s.insert("cherry");
+	std::vector<std::string_view> keys{ "cherry", "banana", "apple", "zebra" };
+	std::vector<set<std::string, std::less<>>::const_iterator> lower(keys.size());
+	s.lower_bound_batch(keys.begin(), keys.end(), lower.begin());
+	EXPECT_EQ("cherry", *lower[0]);
+	EXPECT_EQ("cherry", *lower[1]);
+	EXPECT_EQ("apple", *lower[2]);
+	EXPECT_TRUE(lower[3] == s.end());
+}
+
+TEST(range_erase, matches_std_set) {
+	std::mt19937 gen(19);
+	for (int round = 0; round < 200; round++) {
+		int n = int(gen() % 300);
+		set<int> s;
+		std::set<int> expected;
+		for (int i = 0; i < n; i++) {
+			int x = int(gen() % 1000);
+			s.insert(x);
+			expected.insert(x);
+		}
+		int lo = int(gen() % 1100) - 50;
+		int hi = lo + int(gen() % 600);
+		std::size_t removed = std::distance(expected.lower_bound(lo), expected.lower_bound(hi));
+		expected.erase(expected.lower_bound(lo), expected.lower_bound(hi));
+		ASSERT_EQ(removed, s.erase_range(lo, hi));
+		ASSERT_EQ(expected.size(), s.size());
+		ASSERT_TRUE(std::equal(s.begin(), s.end(), expected.begin()));
+		ASSERT_LE(s.height(), rb_height_limit(s.size()));
+		if (!expected.empty()) {
+			EXPECT_EQ(*expected.begin(), s.front());
+			EXPECT_EQ(*expected.rbegin(), s.back());
+		}
+	}
+}
+
+TEST(range_erase, iterators_and_keys) {
+	set<int> s;
+	for (int i = 0; i < 100; i++)
+		s.insert(i);
+	set<int>::const_iterator before = s.find(9);
+	set<int>::const_iterator after = s.find(60);
+	set<int>::iterator next = s.erase(s.find(10), after);
+	EXPECT_TRUE(next == after);
+	EXPECT_EQ(9, *before);
+	EXPECT_EQ(60, *++before);
+	EXPECT_EQ(60, *after);
+	EXPECT_EQ(9, *--after);
+	EXPECT_EQ(50u, s.size());
+
+	EXPECT_EQ(1u, s.erase(9));
+	EXPECT_EQ(0u, s.erase(9));
+	EXPECT_EQ(0u, s.erase_range(70, 70));
+	EXPECT_EQ(0u, s.erase_range(80, 70));
+	EXPECT_TRUE(s.erase(s.find(90), s.end()) == s.end());
+	EXPECT_EQ(89, s.back());
+	s.erase(s.begin(), s.end());
+	EXPECT_TRUE(s.empty());
+	EXPECT_TRUE(s.begin() == s.end());
+
+	set<std::string, std::less<>> words;
+	words.insert("a");
+	words.insert("b");
+	words.insert("c");
+	EXPECT_EQ(1u, words.erase(std::string_view("b")));
+	EXPECT_EQ(1u, words.erase_range(std::string_view("a"), std::string_view("b")));
+	expect_eq(words, { "c" });
+}
+
+TEST(range_erase, erase_if) {
+	set<int> s;
+	for (int i = 0; i < 1000; i++)
+		s.insert(i);
+	// Few victims: unlinked one by one.
+	EXPECT_EQ(10u, erase_if(s, [](int x) { return x % 100 == 0; }));
+	EXPECT_EQ(990u, s.size());
+	EXPECT_FALSE(s.contains(500));
+	// Most of the set: rebuilt.
+	set<int>::const_iterator survivor = s.find(7);
+	EXPECT_EQ(890u, s.erase_if([](int x) { return x % 10 != 7; }));
+	EXPECT_EQ(100u, s.size());
+	EXPECT_EQ(7, *survivor);
+	EXPECT_EQ(17, *++survivor);
+	EXPECT_LE(s.height(), rb_height_limit(s.size()));
+	int expected = 7;
+	for (int x : s) {
+		EXPECT_EQ(expected, x);
+		expected += 10;
+	}
+	EXPECT_EQ(7, s.front());
+	EXPECT_EQ(997, s.back());
+
+	EXPECT_THROW(s.erase_if([](int x) -> bool { if (x > 500) throw std::runtime_error("pred"); return true; }), std::runtime_error);
+	EXPECT_EQ(100u, s.size());
+}
+
+TEST(serialization, round_trips) {
+	set<int> ints;
+	for (int i = 0; i < 10000; i++)
+		ints.insert(i * 7 % 10007);
+	std::vector<char> dump;
+	serialize(ints, dump);
+	set<int> loaded;
+	loaded.insert(-1);
+	EXPECT_EQ(dump.size(), deserialize(dump.data(), dump.size(), loaded));
+	EXPECT_TRUE(std::equal(loaded.begin(), loaded.end(), ints.begin(), ints.end()));
+	EXPECT_LE(loaded.height(), min_height(loaded.size()) + 1);
+
+	set<std::string> words;
+	words.insert("");
+	words.insert("delta");
+	words.insert(std::string(100000, 'x'));
+	std::stringstream stream;
+	serialize(words, stream);
+	stream << "tail";
+	set<std::string> loaded_words;
+	deserialize(stream, loaded_words);
+	EXPECT_TRUE(std::equal(loaded_words.begin(), loaded_words.end(), words.begin(), words.end()));
+	std::string rest;
+	stream >> rest;
+	EXPECT_EQ("tail", rest);
+
+	set<int> empty, loaded_empty;
+	dump.clear();
+	serialize(empty, dump);
+	deserialize(dump.data(), dump.size(), loaded_empty);
+	EXPECT_TRUE(loaded_empty.empty());
+}
+
+TEST(serialization, rejects_bad_dumps) {
+	set<int> s;
+	for (int i = 0; i < 100; i++)
+		s.insert(i);
+	std::vector<char> dump;
+	serialize(s, dump);
+
+	set<int> target;
+	target.insert(42);
+	auto expect_rejected = [&](std::vector<char> const &bytes) {
+		EXPECT_THROW(deserialize(bytes.data(), bytes.size(), target), serialization_error);
+		expect_eq(target, { 42 });
+	};
+	std::vector<char> corrupt = dump;
+	corrupt[40] ^= 1;
+	expect_rejected(corrupt);
+	expect_rejected(std::vector<char>(dump.begin(), dump.end() - 9));
+	std::vector<char> magic = dump;
+	magic[0] = 'X';
+	expect_rejected(magic);
+
+	set<long long> wrong_type;
+	EXPECT_THROW(deserialize(dump.data(), dump.size(), wrong_type), serialization_error);
+	set<std::string> strings;
+	EXPECT_THROW(deserialize(dump.data(), dump.size(), strings), serialization_error);
+}
+
+std::string mapped_test_path(char const * name) {
+	std::string path = testing::TempDir() + name;
+	std::remove(path.c_str());
+	return path;
+}
+
+TEST(mapped, sync_publishes_to_readers) {
+	std::string path = mapped_test_path("myset_mapped_sync");
+	{
+		mapped_set<int> writer(path, map_mode::read_write);
+		for (int i = 0; i < 1000; i++)
+			EXPECT_TRUE(writer.insert(i * 3));
+		EXPECT_FALSE(writer.insert(3));
+		writer.sync();
+
+		mapped_set<int> reader(path, map_mode::read_only);
+		EXPECT_EQ(1000u, reader.size());
+		EXPECT_TRUE(reader.contains(2997));
+		EXPECT_EQ(3, *reader.upper_bound(0));
+		EXPECT_THROW(mapped_set<int>(path, map_mode::read_write), std::system_error);
+
+		// Unsynced updates stay invisible; the reader keeps its tree until refresh().
+		for (int i = 0; i < 1000; i += 2)
+			EXPECT_TRUE(writer.erase(i * 3));
+		writer.insert(-1);
+		EXPECT_EQ(501u, writer.size());
+		EXPECT_TRUE(reader.contains(0));
+		reader.refresh();
+		EXPECT_TRUE(reader.contains(0));
+		writer.sync();
+		EXPECT_TRUE(reader.contains(0));
+		reader.refresh();
+		EXPECT_FALSE(reader.contains(0));
+		EXPECT_EQ(501u, reader.size());
+		EXPECT_EQ(-1, *reader.begin());
+		EXPECT_EQ(2997, *reader.rbegin());
+
+		writer.insert(5000);
+	}
+	// The insert of 5000 was never synced.
+	mapped_set<int> reopened(path, map_mode::read_write);
+	EXPECT_EQ(501u, reopened.size());
+	EXPECT_FALSE(reopened.contains(5000));
+	EXPECT_TRUE(reopened.insert(5000));
+	EXPECT_THROW(mapped_set<long long>(path, map_mode::read_only), std::runtime_error);
+	std::remove(path.c_str());
+}
+
+TEST(mapped, matches_std_set_across_growth) {
+	std::string path = mapped_test_path("myset_mapped_random");
+	mapped_set<long long> writer(path, map_mode::read_write);
+	std::set<long long> expected;
+	std::mt19937 gen(21);
+	for (int round = 0; round < 60000; round++) {
+		long long x = gen() % 20000;
+		if (gen() % 3)
+			ASSERT_EQ(expected.insert(x).second, writer.insert(x));
+		else
+			ASSERT_EQ(expected.erase(x) == 1, writer.erase(x));
+		if (round % 5000 == 0)
+			writer.sync();
+	}
+	writer.sync();
+	mapped_set<long long> reader(path, map_mode::read_only);
+	ASSERT_EQ(expected.size(), reader.size());
+	EXPECT_TRUE(std::equal(reader.begin(), reader.end(), expected.begin(), expected.end()));
+	EXPECT_TRUE(std::equal(writer.rbegin(), writer.rend(), expected.rbegin(), expected.rend()));
+	for (long long x = -1; x <= 20000; x += 7) {
+		auto it = reader.lower_bound(x);
+		auto lo = expected.lower_bound(x);
+		ASSERT_EQ(lo == expected.end(), it == reader.end());
+		if (lo != expected.end()) {
+			EXPECT_EQ(*lo, *it);
+		}
+	}
+	std::remove(path.c_str());
+}
+
+TEST(mapped, refresh_races_sync) {
+	std::string path = mapped_test_path("myset_mapped_race");
+	mapped_set<long long> writer(path, map_mode::read_write);
+	writer.sync();
+	mapped_set<long long> reader(path, map_mode::read_only);
+	constexpr long long rounds = 3000;
+
+	// Every published tree holds 0 .. size - 1, so a torn root or count shows.
+	std::thread sync_thread([&writer] {
+		for (long long i = 0; i < rounds; i++) {
+			writer.insert(i);
+			writer.sync();
+		}
+	});
+	std::size_t last = 0;
+	int torn = 0;
+	while (last < rounds) {
+		reader.refresh();
+		long long size = static_cast<long long>(reader.size());
+		if (size < static_cast<long long>(last))
+			torn++;
+		else if (size != 0 && (*reader.begin() != 0 || *reader.rbegin() != size - 1 || !reader.contains(size / 2)))
+			torn++;
+		last = static_cast<std::size_t>(size);
+	}
+	sync_thread.join();
+	EXPECT_EQ(0, torn);
+	std::remove(path.c_str());
+}
+
+using counted_stats_set = set<int, std::less<int>, std::allocator<int>, counting_stats>;
+
+TEST(stats, counts_operations) {
+	counted_stats_set s;
+	for (int i = 0; i < 1000; i++)
+		s.insert(i);
+	EXPECT_FALSE(s.insert(500).second);
+	for (int i = 0; i < 2000; i += 2)
+		s.contains(i);
+	s.lower_bound(-1);
+	s.erase(7);
+
+	set_stats st = s.stats();
+	EXPECT_EQ(1001u, st.insert.calls);
+	EXPECT_EQ(1000u, st.find.calls);
+	EXPECT_EQ(1u, st.lower_bound.calls);
+	EXPECT_GT(st.find.comparisons, st.find.calls);
+	EXPECT_LE(st.lower_bound.comparisons, st.height);
+	EXPECT_GT(st.comparisons, st.find.comparisons + st.insert.comparisons + st.lower_bound.comparisons);
+	EXPECT_EQ(1000u, st.allocations);
+	EXPECT_EQ(1u, st.frees);
+	EXPECT_GT(st.rotations, 0u);
+	EXPECT_EQ(999u, st.size);
+	EXPECT_EQ(s.height(), st.height);
+	ASSERT_EQ(st.height, st.depth_histogram.size());
+	EXPECT_EQ(1u, st.depth_histogram[0]);
+	EXPECT_EQ(st.size, std::accumulate(st.depth_histogram.begin(), st.depth_histogram.end(), std::size_t(0)));
+
+	// Copies start with fresh counters; reset_stats() zeroes them.
+	counted_stats_set copy(s);
+	EXPECT_EQ(0u, copy.stats().find.calls);
+	s.reset_stats();
+	st = s.stats();
+	EXPECT_EQ(0u, st.insert.calls + st.comparisons + st.allocations + st.rotations);
+	EXPECT_EQ(999u, st.size);
+}
+
+TEST(stats, export_and_default_policy) {
+	counted_stats_set s;
+	for (int i = 0; i < 10; i++)
+		s.insert(i);
+	s.find(3);
+	std::map<std::string, std::uint64_t> metrics;
+	export_stats(s.stats(), [&metrics](std::string const &name, std::uint64_t value) { metrics[name] = value; });
+	EXPECT_EQ(10u, metrics["insert.calls"]);
+	EXPECT_EQ(1u, metrics["find.calls"]);
+	EXPECT_EQ(10u, metrics["size"]);
+	EXPECT_EQ(1u, metrics["depth.0"]);
+	EXPECT_EQ(0u, metrics.count("depth." + std::to_string(metrics["height"])));
+
+	// The default policy takes no space and the sets behave the same.
+	EXPECT_EQ(sizeof(set<int>), sizeof(myset_detail::set_header));
+	set<int> plain(s.begin(), s.end());
+	EXPECT_TRUE(std::equal(plain.begin(), plain.end(), s.begin(), s.end()));
+
+	// Counters are per instance: a copy starts from zero.
+	counted_stats_set copy(s);
+	EXPECT_EQ(0u, copy.stats().insert.calls);
+	EXPECT_EQ(10u, copy.stats().size);
+	flat_set<int> flat(s);
+	EXPECT_TRUE(std::equal(flat.begin(), flat.end(), s.begin(), s.end()));
+}
+
+TEST(index_set, random_against_std) {
+	std::mt19937 gen(24);
+	std::set<int> expected;
+	index_set<int> s;
+	for (int round = 0; round < 40000; round++) {
+		int x = int(gen() % 3000);
+		switch (gen() % 4) {
+		case 0:
+		case 1:
+			ASSERT_EQ(expected.insert(x).second, s.insert(x).second);
+			break;
+		case 2:
+			ASSERT_EQ(expected.erase(x), s.erase(x));
+			break;
+		default: {
+			auto it = s.lower_bound(x);
+			auto want = expected.lower_bound(x);
+			ASSERT_EQ(want == expected.end(), it == s.end());
+			if (it != s.end()) {
+				ASSERT_EQ(*want, *it);
+				auto next = s.erase(it);
+				auto want_next = expected.erase(want);
+				ASSERT_EQ(want_next == expected.end(), next == s.end());
+				if (next != s.end()) {
+					ASSERT_EQ(*want_next, *next);
+				}
+			}
+		}
+		}
+	}
+	ASSERT_EQ(expected.size(), s.size());
+	EXPECT_TRUE(std::equal(s.begin(), s.end(), expected.begin(), expected.end()));
+	EXPECT_TRUE(std::equal(s.rbegin(), s.rend(), expected.rbegin(), expected.rend()));
+	EXPECT_LE(s.height(), 2 * std::log2(s.size() + 1));
+	for (int x = -1; x <= 3001; x++) {
+		ASSERT_EQ(expected.count(x), s.count(x));
+		auto ub = s.upper_bound(x);
+		auto want = expected.upper_bound(x);
+		ASSERT_EQ(want == expected.end(), ub == s.end());
+		if (ub != s.end()) {
+			ASSERT_EQ(*want, *ub);
+		}
+	}
+}
+
+TEST(index_set, compact_nodes_and_ranges) {
+	static_assert(sizeof(myset_detail::index_node<int>) == 16, "int nodes should take 16 bytes");
+	std::vector<int> sorted(1000);
+	std::iota(sorted.begin(), sorted.end(), 0);
+	index_set<int> s(sorted.begin(), sorted.end());
+	EXPECT_EQ(1000u, s.size());
+	EXPECT_LE(s.height(), 10u);
+	EXPECT_EQ(999, *std::prev(s.end()));
+
+	// Erasing moves nodes around; the range bounds must still come out right.
+	auto it = s.erase(s.find(100), s.find(900));
+	EXPECT_EQ(900, *it);
+	EXPECT_EQ(200u, s.size());
+	EXPECT_EQ(99, *std::prev(s.find(900)));
+	EXPECT_TRUE(std::is_sorted(s.begin(), s.end()));
+	EXPECT_EQ(s.end(), s.erase(s.find(950), s.end()));
+	EXPECT_EQ(150u, s.size());
+
+	index_set<int> copy(s);
+	index_set<int> moved(std::move(s));
+	EXPECT_TRUE(s.empty());
+	EXPECT_EQ(s.end(), s.begin());
+	EXPECT_TRUE(std::equal(copy.begin(), copy.end(), moved.begin(), moved.end()));
+
+	set<std::string> strings;
+	for (int i = 0; i < 100; i++)
+		strings.insert(std::to_string(i));
+	index_set<std::string> from_set(strings);
+	EXPECT_TRUE(std::equal(strings.begin(), strings.end(), from_set.begin(), from_set.end()));
+	EXPECT_FALSE(from_set.emplace("42").second);
+	EXPECT_TRUE(from_set.emplace(3, 'x').second);
+	EXPECT_EQ("xxx", *from_set.find("xxx"));
+}
+
+TEST(lean_set, random_against_std) {
+	std::mt19937 gen(25);
+	std::set<int> expected;
+	lean_set<int> s;
+	for (int round = 0; round < 40000; round++) {
+		int x = int(gen() % 3000);
+		switch (gen() % 4) {
+		case 0:
+		case 1: {
+			auto want = expected.insert(x);
+			auto got = s.insert(x);
+			ASSERT_EQ(want.second, got.second);
+			ASSERT_EQ(x, *got.first);
+			break;
+		}
+		case 2:
+			ASSERT_EQ(expected.erase(x), s.erase(x));
+			break;
+		default: {
+			auto it = s.lower_bound(x);
+			auto want = expected.lower_bound(x);
+			ASSERT_EQ(want == expected.end(), it == s.end());
+			if (it != s.end()) {
+				ASSERT_EQ(*want, *it);
+				auto next = s.erase(it);
+				auto want_next = expected.erase(want);
+				ASSERT_EQ(want_next == expected.end(), next == s.end());
+				if (next != s.end()) {
+					ASSERT_EQ(*want_next, *next);
+				}
+			}
+		}
+		}
+	}
+	ASSERT_EQ(expected.size(), s.size());
+	EXPECT_TRUE(std::equal(s.begin(), s.end(), expected.begin(), expected.end()));
+	EXPECT_TRUE(std::equal(s.rbegin(), s.rend(), expected.rbegin(), expected.rend()));
+	EXPECT_LE(s.height(), 1.45 * std::log2(s.size() + 2));
+	for (int x = -1; x <= 3001; x++) {
+		ASSERT_EQ(expected.count(x), s.count(x));
+		ASSERT_EQ(expected.count(x) != 0, s.find(x) != s.end());
+		auto ub = s.upper_bound(x);
+		auto want = expected.upper_bound(x);
+		ASSERT_EQ(want == expected.end(), ub == s.end());
+		if (ub != s.end()) {
+			ASSERT_EQ(*want, *ub);
+		}
+	}
+}
+
+TEST(lean_set, two_word_nodes_and_ranges) {
+	static_assert(sizeof(myset_detail::lean_node<void*>) == 3 * sizeof(void*), "nodes should hold two links and the value");
+	std::vector<int> sorted(1000);
+	std::iota(sorted.begin(), sorted.end(), 0);
+	lean_set<int> s(sorted.begin(), sorted.end());
+	EXPECT_EQ(1000u, s.size());
+	EXPECT_EQ(10u, s.height());
+	EXPECT_EQ(999, *std::prev(s.end()));
+	EXPECT_EQ(0, *std::next(s.rbegin(), 999));
+
+	// Built trees must carry correct balance bits for later erasures to rebalance.
+	auto it = s.erase(s.find(100), s.find(900));
+	EXPECT_EQ(900, *it);
+	EXPECT_EQ(200u, s.size());
+	EXPECT_EQ(99, *std::prev(s.find(900)));
+	EXPECT_EQ(s.end(), s.erase(s.find(950), s.end()));
+	EXPECT_EQ(150u, s.size());
+	EXPECT_LE(s.height(), 1.45 * std::log2(s.size() + 2));
+
+	lean_set<int> copy(s);
+	lean_set<int> moved(std::move(s));
+	EXPECT_TRUE(s.empty());
+	EXPECT_EQ(s.end(), s.begin());
+	EXPECT_TRUE(std::equal(copy.begin(), copy.end(), moved.begin(), moved.end()));
+	EXPECT_EQ(copy.height(), moved.height());
+
+	set<std::string> strings;
+	for (int i = 0; i < 100; i++)
+		strings.insert(std::to_string(i));
+	lean_set<std::string> from_set(strings);
+	std::string const &ref = *from_set.find("42");
+	EXPECT_TRUE(std::equal(strings.begin(), strings.end(), from_set.begin(), from_set.end()));
+	EXPECT_FALSE(from_set.emplace("42").second);
+	EXPECT_TRUE(from_set.emplace(3, 'x').second);
+	for (int i = 0; i < 100; i += 2)
+		from_set.erase(std::to_string(i + 1));
+	EXPECT_EQ("42", ref);
+	EXPECT_EQ("xxx", *from_set.find("xxx"));
+}
+
+TEST(lean_set, assignment_respects_allocators) {
+	using tagged_lean_set = lean_set<int, std::less<int>, tagged_allocator<int>>;
+	int mismatched = tagged_mismatched_frees();
+	{
+		tagged_lean_set a(std::less<int>(), tagged_allocator<int>(1));
+		tagged_lean_set b(std::less<int>(), tagged_allocator<int>(2));
+		for (int i = 0; i < 100; i++)
+			a.insert(i);
+		b.insert(-1);
+
+		// Neither assignment may hand b nodes from a's allocator.
+		b = a;
+		EXPECT_EQ(2, b.get_allocator().id);
+		EXPECT_TRUE(std::equal(a.begin(), a.end(), b.begin(), b.end()));
+		b.insert(100);
+		b = std::move(a);
+		EXPECT_EQ(2, b.get_allocator().id);
+		EXPECT_TRUE(a.empty());
+		EXPECT_EQ(100u, b.size());
+		EXPECT_EQ(99, *b.rbegin());
+
+		tagged_lean_set c(std::less<int>(), tagged_allocator<int>(2));
+		c = std::move(b);
+		EXPECT_TRUE(b.empty());
+		EXPECT_EQ(100u, c.size());
+	}
+	EXPECT_EQ(mismatched, tagged_mismatched_frees());
+
+	// pool_allocator does not propagate on copy assignment: the target keeps its pool.
+	lean_set<int, std::less<int>, pool_allocator<int>> p, q;
+	p.insert(1);
+	q.insert(2);
+	auto pool = p.get_allocator();
+	p = q;
+	EXPECT_TRUE(pool == p.get_allocator());
+	EXPECT_TRUE(q.get_allocator() != p.get_allocator());
+	EXPECT_EQ(2, *p.begin());
+}
+
 int main(int argc, char *argv[]) {
 	srand(unsigned(time(NULL)));
 	testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,280 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <cstddef>
+#include <atomic>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+* Fork-join pool for the parallel set operations. The calling thread takes
+* part in the work, so a pool of n threads starts n - 1 workers, and a pool
+* of one thread runs everything inline.
+*
+* invoke() runs two closures, possibly concurrently, and returns when both
+* are done. A thread waiting for its forked half runs other queued jobs in
+* the meantime, so nested invoke() calls never block a worker idle and the
+* pool cannot deadlock on recursion.
+*/
+struct thread_pool {
+
+	explicit thread_pool(std::size_t threads = std::thread::hardware_concurrency())
+		: stop_(false)
+	{
+		for (std::size_t i = 1; i < threads; i++)
+			workers_.emplace_back([this] { work(); });
+	}
+
+	thread_pool(thread_pool const &) = delete;
+	thread_pool& operator=(thread_pool const &) = delete;
+
+	~thread_pool() {
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stop_ = true;
+		}
+		ready_.notify_all();
+		for (std::thread &worker : workers_)
+			worker.join();
+	}
+
+	/*
+	* Number of threads working on a parallel call, the caller included.
+	*/
+	std::size_t concurrency() const {
+		return workers_.size() + 1;
+	}
+
+	/*
+	* Runs f and g and returns once both have finished. If either throws, the
+	* first exception (f's if both do) is rethrown after both are done.
+	*/
+	template <typename F, typename G>
+	void invoke(F &&f, G &&g) {
+		if (workers_.empty()) {
+			f();
+			g();
+			return;
+		}
+		job forked(g);
+		push(&forked);
+		std::exception_ptr error;
+		try {
+			f();
+		}
+		catch (...) {
+			error = std::current_exception();
+		}
+		if (take_back(&forked))
+			forked.execute();
+		while (!forked.done.load(std::memory_order_acquire))
+			if (!run_one())
+				std::this_thread::yield();
+		if (error)
+			std::rethrow_exception(error);
+		if (forked.error)
+			std::rethrow_exception(forked.error);
+	}
+
+	/*
+	* Calls f(begin, end) on subranges of [0, n) no longer than grain.
+	*/
+	template <typename F>
+	void parallel_for(std::size_t n, std::size_t grain, F const &f) {
+		for_range(0, n, std::max<std::size_t>(grain, 1), f);
+	}
+
+private:
+
+	struct job {
+		template <typename F>
+		explicit job(F &f)
+			: run([](void * context) { (*static_cast<F*>(context))(); }), context(&f), done(false)
+		{}
+
+		void execute() {
+			try {
+				run(context);
+			}
+			catch (...) {
+				error = std::current_exception();
+			}
+			done.store(true, std::memory_order_release);
+		}
+
+		void (*run)(void *);
+		void * context;
+		std::atomic<bool> done;
+		std::exception_ptr error;
+	};
+
+	template <typename F>
+	void for_range(std::size_t begin, std::size_t end, std::size_t grain, F const &f) {
+		if (end - begin <= grain) {
+			if (begin != end)
+				f(begin, end);
+			return;
+		}
+		std::size_t mid = begin + (end - begin) / 2;
+		invoke([&] { for_range(begin, mid, grain, f); }, [&] { for_range(mid, end, grain, f); });
+	}
+
+	void push(job * j) {
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			queue_.push_back(j);
+		}
+		ready_.notify_one();
+	}
+
+	/*
+	* Removes j from the queue if no thread has picked it up yet.
+	*/
+	bool take_back(job * j) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		auto it = std::find(queue_.rbegin(), queue_.rend(), j);
+		if (it == queue_.rend())
+			return false;
+		queue_.erase(std::next(it).base());
+		return true;
+	}
+
+	/*
+	* Runs the newest queued job, which is the smallest piece of work
+	* around; idle workers take the oldest ones instead.
+	*/
+	bool run_one() {
+		job * j;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (queue_.empty())
+				return false;
+			j = queue_.back();
+			queue_.pop_back();
+		}
+		j->execute();
+		return true;
+	}
+
+	void work() {
+		std::unique_lock<std::mutex> lock(mutex_);
+		for (;;) {
+			ready_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+			if (queue_.empty())
+				return;
+			job * j = queue_.front();
+			queue_.pop_front();
+			lock.unlock();
+			j->execute();
+			lock.lock();
+		}
+	}
+
+	std::mutex mutex_;
+	std::condition_variable ready_;
+	std::deque<job*> queue_;
+	bool stop_;
+	std::vector<std::thread> workers_;
+};
+
+namespace myset_detail {
+
+	// Below this many elements a parallel step runs sequentially.
+	constexpr std::size_t parallel_grain = 4096;
+
+	/*
+	* Stable merge of the sorted runs a and b into out, moving the elements.
+	* The larger run is halved and the other split at the matching key, so
+	* both halves are merged independently.
+	*/
+	template <typename T, typename Compare>
+	void parallel_merge(thread_pool &pool, T * a, std::size_t na, T * b, std::size_t nb, T * out, Compare const &comp) {
+		if (na + nb <= parallel_grain) {
+			std::merge(std::make_move_iterator(a), std::make_move_iterator(a + na),
+				std::make_move_iterator(b), std::make_move_iterator(b + nb), out, comp);
+			return;
+		}
+		std::size_t ia, ib;
+		if (na >= nb) {
+			ia = na / 2;
+			ib = static_cast<std::size_t>(std::lower_bound(b, b + nb, a[ia], comp) - b);
+		}
+		else {
+			ib = nb / 2;
+			ia = static_cast<std::size_t>(std::upper_bound(a, a + na, b[ib], comp) - a);
+		}
+		pool.invoke([&] { parallel_merge(pool, a, ia, b, ib, out, comp); },
+			[&] { parallel_merge(pool, a + ia, na - ia, b + ib, nb - ib, out + ia + ib, comp); });
+	}
+
+	/*
+	* Stable merge sort of data[0, n) using buf[0, n) as scratch; the result
+	* ends up in buf if into_buf is set and in data otherwise.
+	*/
+	template <typename T, typename Compare>
+	void parallel_sort(thread_pool &pool, T * data, T * buf, std::size_t n, bool into_buf, Compare const &comp) {
+		if (n <= parallel_grain) {
+			std::stable_sort(data, data + n, comp);
+			if (into_buf)
+				std::move(data, data + n, buf);
+			return;
+		}
+		std::size_t half = n / 2;
+		pool.invoke([&] { parallel_sort(pool, data, buf, half, !into_buf, comp); },
+			[&] { parallel_sort(pool, data + half, buf + half, n - half, !into_buf, comp); });
+		T * from = into_buf ? data : buf;
+		parallel_merge(pool, from, half, from + half, n - half, into_buf ? buf : data, comp);
+	}
+
+	/*
+	* Moves the first element of every run of equivalent elements of the
+	* sorted data[0, n) to out and returns how many there are: one pass
+	* counts the survivors of each chunk, a second moves them into place.
+	*/
+	template <typename T, typename Compare>
+	std::size_t parallel_unique(thread_pool &pool, T * data, std::size_t n, T * out, Compare const &comp) {
+		if (n == 0)
+			return 0;
+		std::size_t chunks = std::max<std::size_t>(1, std::min(n / parallel_grain, 4 * pool.concurrency()));
+		auto chunk_begin = [n, chunks](std::size_t c) { return c * (n / chunks) + std::min(c, n % chunks); };
+		auto keep = [data, &comp](std::size_t i) { return i == 0 || comp(data[i - 1], data[i]); };
+
+		// Survivor counts per chunk, and whether each chunk starts a new run:
+		// the second pass cannot look across a chunk boundary, as the
+		// neighbouring chunk may already have moved its elements away.
+		std::vector<std::size_t> offset(chunks + 1, 0);
+		std::vector<char> starts_run(chunks);
+		pool.parallel_for(chunks, 1, [&](std::size_t first, std::size_t last) {
+			for (std::size_t c = first; c < last; c++) {
+				starts_run[c] = keep(chunk_begin(c));
+				for (std::size_t i = chunk_begin(c); i < chunk_begin(c + 1); i++)
+					offset[c + 1] += keep(i);
+			}
+		});
+		for (std::size_t c = 0; c < chunks; c++)
+			offset[c + 1] += offset[c];
+		pool.parallel_for(chunks, 1, [&](std::size_t first, std::size_t last) {
+			for (std::size_t c = first; c < last; c++) {
+				T * to = out + offset[c];
+				std::size_t end = chunk_begin(c + 1);
+				bool kept = starts_run[c] != 0;
+				for (std::size_t i = chunk_begin(c); i < end; i++) {
+					bool next_kept = i + 1 < end && comp(data[i], data[i + 1]);
+					if (kept)
+						*to++ = std::move(data[i]);
+					kept = next_kept;
+				}
+			}
+		});
+		return offset[chunks];
+	}
+
+} // namespace myset_detail
+
+#endif // THREAD_POOL_H